@@ -0,0 +1,578 @@
+#include <chrono>
+
+#include "combinator.cpp"
+#include "binary.cpp"
+#include "optimize.cpp"
+
+/* benchmark über erzeugte eingaben. alle eingaben werden mit festem startwert erzeugt,
+ * damit läufe verschiedener versionen vergleichbar bleiben.
+ *
+ *   parser_combinator_bench [--size bytes] [--min-time ms] [--filter name]
+ *                           [--tsv] [--compare datei.tsv] [--optimize]
+ *
+ * --tsv gibt eine zeile je workload und modus aus, --compare liest eine solche ausgabe
+ * eines früheren laufs und zeigt die veränderung in prozent. --optimize läßt vorher
+ * optimize() über die grammatiken laufen. */
+
+using namespace Urq::api;
+
+/* ---------------------------------------------------------------------------------- */
+/* speicher: bump-allocator, der nach jedem parse zurückgesetzt wird und mitzählt       */
+/* ---------------------------------------------------------------------------------- */
+
+#define BENCH_CHUNK_SIZE (4*1024*1024)
+
+struct Bench_Chunk {
+    char   * mem;
+    size_t   size;
+};
+
+struct Bench_Arena {
+    Bench_Chunk * chunks;
+    size_t        num_chunks;
+    size_t        cap_chunks;
+    size_t        current;
+    size_t        used;
+
+    size_t        num_allocs;
+    size_t        bytes;
+};
+
+Bench_Arena bench_arena = {};
+
+void
+bench_arena_reset() {
+    bench_arena.current    = 0;
+    bench_arena.used       = 0;
+    bench_arena.num_allocs = 0;
+    bench_arena.bytes      = 0;
+}
+
+ALLOCATOR(bench_alloc) {
+    Bench_Arena *a = &bench_arena;
+
+    a->num_allocs += 1;
+    a->bytes      += size;
+
+    size = (size + 15) & ~(size_t)15;
+
+    for ( ;; ) {
+        if ( a->current < a->num_chunks ) {
+            Bench_Chunk *chunk = &a->chunks[a->current];
+
+            if ( a->used + size <= chunk->size ) {
+                void *result = chunk->mem + a->used;
+                a->used += size;
+
+                return result;
+            }
+
+            a->current += 1;
+            a->used     = 0;
+
+            continue;
+        }
+
+        if ( a->num_chunks >= a->cap_chunks ) {
+            a->cap_chunks = a->cap_chunks ? a->cap_chunks*2 : 16;
+            a->chunks = (Bench_Chunk *)realloc(a->chunks, sizeof(Bench_Chunk)*a->cap_chunks);
+        }
+
+        Bench_Chunk *chunk = &a->chunks[a->num_chunks++];
+        chunk->size = (size > BENCH_CHUNK_SIZE) ? size : BENCH_CHUNK_SIZE;
+        chunk->mem  = (char *)malloc(chunk->size);
+        a->current  = a->num_chunks - 1;
+        a->used     = 0;
+    }
+}
+
+DEALLOCATOR(bench_dealloc) {
+}
+
+/* ---------------------------------------------------------------------------------- */
+/* eingaben                                                                           */
+/* ---------------------------------------------------------------------------------- */
+
+struct Bench_Text {
+    char   * val;
+    size_t   len;
+    size_t   cap;
+};
+
+void
+bench_text_put(Bench_Text *text, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int size = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+
+    if ( text->len + size + 1 > text->cap ) {
+        text->cap = (text->cap*2 > text->len + size + 1) ? text->cap*2 : text->len + size + 1;
+        text->val = (char *)realloc(text->val, text->cap);
+    }
+
+    va_start(args, fmt);
+    vsnprintf(text->val + text->len, size + 1, fmt, args);
+    va_end(args);
+
+    text->len += size;
+}
+
+uint64_t bench_seed = 0x9E3779B97F4A7C15ull;
+
+uint32_t
+bench_rand(uint32_t max) {
+    bench_seed = bench_seed*6364136223846793005ull + 1442695040888963407ull;
+
+    return (uint32_t)(bench_seed >> 33) % max;
+}
+
+char *bench_words[] = {
+    "alpha", "beta", "gamma", "delta", "omega", "sigma", "lambda", "kappa",
+};
+
+char *bench_keywords[] = {
+    "if", "else", "while", "for", "return", "break", "continue", "switch",
+    "case", "default", "struct", "union",
+};
+
+void
+bench_gen_sexpr(Bench_Text *text, int depth) {
+    char ops[] = { '+', '-', '*', '/' };
+
+    bench_text_put(text, "(%c ", ops[bench_rand(4)]);
+    for ( int i = 0; i < 2; ++i ) {
+        if ( depth > 0 && bench_rand(3) != 0 ) {
+            bench_gen_sexpr(text, depth - 1);
+        } else {
+            bench_text_put(text, "%u", 1 + bench_rand(999));
+        }
+
+        bench_text_put(text, i == 0 ? " " : ")");
+    }
+}
+
+void
+bench_gen_json(Bench_Text *text, int depth) {
+    uint32_t kind = (depth > 0) ? bench_rand(7) : bench_rand(5);
+
+    switch ( kind ) {
+        case 0: bench_text_put(text, "%u", bench_rand(100000)); break;
+        case 1: bench_text_put(text, "\"%s\"", bench_words[bench_rand(8)]); break;
+        case 2: bench_text_put(text, "true"); break;
+        case 3: bench_text_put(text, "false"); break;
+        case 4: bench_text_put(text, "null"); break;
+
+        case 5: {
+            uint32_t n = bench_rand(5);
+            bench_text_put(text, "[");
+            for ( uint32_t i = 0; i < n; ++i ) {
+                bench_text_put(text, i ? ", " : "");
+                bench_gen_json(text, depth - 1);
+            }
+            bench_text_put(text, "]");
+        } break;
+
+        case 6: {
+            uint32_t n = bench_rand(5);
+            bench_text_put(text, "{");
+            for ( uint32_t i = 0; i < n; ++i ) {
+                bench_text_put(text, i ? ", " : " ");
+                bench_text_put(text, "\"%s\": ", bench_words[bench_rand(8)]);
+                bench_gen_json(text, depth - 1);
+            }
+            bench_text_put(text, " }");
+        } break;
+    }
+}
+
+char *
+bench_corpus_lisp(size_t size) {
+    Bench_Text text = {};
+    while ( text.len < size ) {
+        bench_gen_sexpr(&text, 4);
+        bench_text_put(&text, "\n");
+    }
+
+    return text.val;
+}
+
+char *
+bench_corpus_csv(size_t size) {
+    Bench_Text text = {};
+    while ( text.len < size ) {
+        for ( int i = 0; i < 8; ++i ) {
+            if ( i ) {
+                bench_text_put(&text, ",");
+            }
+
+            if ( bench_rand(2) ) {
+                bench_text_put(&text, "%u", bench_rand(1000000));
+            } else {
+                bench_text_put(&text, "%s", bench_words[bench_rand(8)]);
+            }
+        }
+
+        bench_text_put(&text, "\n");
+    }
+
+    return text.val;
+}
+
+char *
+bench_corpus_json(size_t size) {
+    Bench_Text text = {};
+    while ( text.len < size ) {
+        bench_gen_json(&text, 3);
+        bench_text_put(&text, "\n");
+    }
+
+    return text.val;
+}
+
+char *
+bench_corpus_keywords(size_t size) {
+    Bench_Text text = {};
+    while ( text.len < size ) {
+        if ( bench_rand(3) ) {
+            bench_text_put(&text, "%s", bench_keywords[bench_rand(12)]);
+        } else {
+            bench_text_put(&text, "%s", bench_words[bench_rand(8)]);
+        }
+
+        bench_text_put(&text, bench_rand(10) ? " " : "\n");
+    }
+
+    return text.val;
+}
+
+/* pakete wie in examples/bit.cpp: kennung "PK", typ (8 bit), zwei werte (16 bit) und
+ * ein vorzeichenbehafteter wert (8 bit). nullbytes kommen nicht vor, da die eingabe
+ * nullterminiert ist. */
+char *
+bench_corpus_packets(size_t size) {
+    Bench_Text text = {};
+    while ( text.len < size ) {
+        bench_text_put(&text, "PK%c%c%c%c%c%c",
+                1 + bench_rand(255), 1 + bench_rand(255), 1 + bench_rand(255),
+                1 + bench_rand(255), 1 + bench_rand(255), 1 + bench_rand(255));
+    }
+
+    return text.val;
+}
+
+/* ---------------------------------------------------------------------------------- */
+/* grammatiken                                                                        */
+/* ---------------------------------------------------------------------------------- */
+
+Parser *
+bench_grammar_lisp() {
+    auto parens = Between(Chr('('), Chr(')'));
+    auto number = Map(Digits, [](Parser_Result result, size_t index, void *user_data) {
+        int64_t num = 0;
+        for ( int i = 0; i < result.str.len; ++i ) {
+            num *= 10;
+            num += result.str.val[i] - '0';
+        }
+
+        return parser_result_s64(num);
+    });
+
+    auto op = Choice({
+        Chr('+'), Chr('-'), Chr('*'), Chr('/')
+    });
+
+    auto expr = Choice({ number, Empty });
+
+    auto program = Map(parens(Seq_Of({
+        op,
+        Whitespace,
+        expr,
+        Whitespace,
+        expr
+    })), [](Parser_Result result, size_t index, void *user_data) {
+        char op = parser_result_entry(&result.arr.val, 0).chr.val;
+        int64_t a = parser_result_entry(&result.arr.val, 2).s64.val;
+        int64_t b = parser_result_entry(&result.arr.val, 4).s64.val;
+
+        switch ( op ) {
+            case '+': return parser_result_s64(a + b);
+            case '-': return parser_result_s64(a - b);
+            case '*': return parser_result_s64(a * b);
+        }
+
+        return parser_result_s64(b ? a / b : 0);
+    });
+
+    fill_empty(expr, program);
+
+    return Many(Seq_Of({ program, Whitespace }));
+}
+
+Parser *
+bench_grammar_csv() {
+    auto field = Choice({ Digits, Letters });
+    auto row   = Seq_Of({ Sep_By(Chr(','))(field), Chr('\n') });
+
+    return Many(row);
+}
+
+Parser *
+bench_grammar_json() {
+    auto ws     = Whitespace;
+    auto comma  = Seq_Of({ ws, Chr(','), ws });
+    auto string = Between(Chr('"'), Chr('"'))(Letters);
+    auto value  = Choice({ Digits, string, Str("true"), Str("false"), Str("null"), Empty, Empty });
+
+    auto array  = Between(Seq_Of({ Chr('['), ws }), Seq_Of({ ws, Chr(']') }))(Sep_By(comma)(value));
+    auto member = Seq_Of({ string, ws, Chr(':'), ws, value });
+    auto object = Between(Seq_Of({ Chr('{'), ws }), Seq_Of({ ws, Chr('}') }))(Sep_By(comma)(member));
+
+    fill_empty(value, array);
+    fill_empty(value, object);
+
+    return Many(Seq_Of({ value, ws }));
+}
+
+Parser *
+bench_grammar_keywords() {
+    auto token = Choice({
+        Str("if"), Str("else"), Str("while"), Str("for"), Str("return"), Str("break"),
+        Str("continue"), Str("switch"), Str("case"), Str("default"), Str("struct"),
+        Str("union"), Letters
+    });
+
+    return Many(Seq_Of({ token, Whitespace }));
+}
+
+Parser *
+bench_grammar_packets() {
+    auto packet = Seq_Of({ Raw_String("PK"), Uint(8), Uint(16), Uint(16), Int(8) });
+
+    return Many(packet);
+}
+
+/* ---------------------------------------------------------------------------------- */
+/* messung                                                                            */
+/* ---------------------------------------------------------------------------------- */
+
+enum Bench_Mode {
+    BENCH_MODE_RUN,
+    BENCH_MODE_RECOGNIZE,
+};
+
+char *bench_mode_names[] = { "run", "recognize" };
+
+struct Bench_Workload {
+    char     * name;
+    char     * (*corpus)(size_t size);
+    Parser   * (*grammar)();
+    size_t     index_scale; /* bitparser zählen den index in bits */
+};
+
+Bench_Workload bench_workloads[] = {
+    { "lisp",     bench_corpus_lisp,     bench_grammar_lisp,     1 },
+    { "csv",      bench_corpus_csv,      bench_grammar_csv,      1 },
+    { "json",     bench_corpus_json,     bench_grammar_json,     1 },
+    { "keywords", bench_corpus_keywords, bench_grammar_keywords, 1 },
+    { "packets",  bench_corpus_packets,  bench_grammar_packets,  8 },
+};
+
+struct Bench_Result {
+    char   workload[32];
+    char   mode[32];
+    size_t bytes;
+    size_t iterations;
+    double ns_per_op;
+    double mb_per_s;
+    double allocs_per_op;
+    double alloc_bytes_per_op;
+};
+
+double
+bench_now_ns() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+/* führt den parser wiederholt aus, bis mindestens min_time_ms vergangen sind, und
+ * meldet die schnellste iteration. */
+bool
+bench_measure(Parser *parser, char *input, size_t index_scale, Bench_Mode mode,
+        double min_time_ms, Bench_Result *out) {
+    size_t len = strlen(input);
+
+    Urq::parser_alloc   = bench_alloc;
+    Urq::parser_dealloc = bench_dealloc;
+
+    double best = 0;
+    double start = bench_now_ns();
+    size_t iterations = 0;
+    bool success = true;
+
+    do {
+        bench_arena_reset();
+
+        double t0 = bench_now_ns();
+        Parser_State state = {};
+        switch ( mode ) {
+            case BENCH_MODE_RUN:       state = run(parser, input);       break;
+            case BENCH_MODE_RECOGNIZE: state = recognize(parser, input); break;
+        }
+        double t1 = bench_now_ns();
+
+        if ( !state.success || state.index != len*index_scale ) {
+            success = false;
+            break;
+        }
+
+        if ( iterations == 0 || t1 - t0 < best ) {
+            best = t1 - t0;
+        }
+
+        iterations += 1;
+    } while ( bench_now_ns() - start < min_time_ms*1e6 || iterations < 3 );
+
+    Urq::parser_alloc   = Urq::parser_alloc_default;
+    Urq::parser_dealloc = Urq::parser_dealloc_default;
+
+    if ( !success ) {
+        return false;
+    }
+
+    out->bytes              = len;
+    out->iterations         = iterations;
+    out->ns_per_op          = best;
+    out->mb_per_s           = (len / (1024.0*1024.0)) / (best / 1e9);
+    out->allocs_per_op      = (double)bench_arena.num_allocs;
+    out->alloc_bytes_per_op = (double)bench_arena.bytes;
+
+    return true;
+}
+
+/* liest eine frühere --tsv ausgabe und sucht die zeile zu workload und modus */
+bool
+bench_baseline(char *path, char *workload, char *mode, double *ns_per_op) {
+    FILE *in = fopen(path, "r");
+    if ( !in ) {
+        return false;
+    }
+
+    char line[512];
+    bool result = false;
+
+    while ( fgets(line, sizeof(line), in) ) {
+        char w[64], m[64];
+        double ns;
+
+        if ( sscanf(line, "%63s\t%63s\t%*s\t%*s\t%lf", w, m, &ns) != 3 ) {
+            continue;
+        }
+
+        if ( strcmp(w, workload) == 0 && strcmp(m, mode) == 0 ) {
+            *ns_per_op = ns;
+            result = true;
+            break;
+        }
+    }
+
+    fclose(in);
+
+    return result;
+}
+
+int
+main(int argc, char const* argv[]) {
+    size_t size        = 256*1024;
+    double min_time_ms = 500;
+    char  *filter      = NULL;
+    char  *compare     = NULL;
+    bool   tsv         = false;
+    bool   opt         = false;
+
+    for ( int i = 1; i < argc; ++i ) {
+        if ( strcmp(argv[i], "--size") == 0 && i + 1 < argc ) {
+            size = strtoull(argv[++i], NULL, 10);
+        } else if ( strcmp(argv[i], "--min-time") == 0 && i + 1 < argc ) {
+            min_time_ms = strtod(argv[++i], NULL);
+        } else if ( strcmp(argv[i], "--filter") == 0 && i + 1 < argc ) {
+            filter = (char *)argv[++i];
+        } else if ( strcmp(argv[i], "--compare") == 0 && i + 1 < argc ) {
+            compare = (char *)argv[++i];
+        } else if ( strcmp(argv[i], "--tsv") == 0 ) {
+            tsv = true;
+        } else if ( strcmp(argv[i], "--optimize") == 0 ) {
+            opt = true;
+        } else {
+            fprintf(stderr, "unbekannte option: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    if ( tsv ) {
+        printf("workload\tmode\tbytes\titerations\tns_per_op\tmb_per_s\tallocs_per_op\talloc_bytes_per_op\n");
+    } else {
+        printf("%-10s %-10s %10s %8s %14s %10s %12s %14s%s\n", "workload", "modus", "bytes",
+                "iter", "ns/op", "MB/s", "allocs/op", "bytes/op", compare ? "   vergleich" : "");
+    }
+
+    int exit_code = 0;
+
+    for ( size_t w = 0; w < sizeof(bench_workloads)/sizeof(bench_workloads[0]); ++w ) {
+        Bench_Workload *workload = &bench_workloads[w];
+
+        if ( filter && !strstr(workload->name, filter) ) {
+            continue;
+        }
+
+        bench_seed = 0x9E3779B97F4A7C15ull;
+        char   *input  = workload->corpus(size);
+        Parser *parser = workload->grammar();
+
+        if ( opt ) {
+            Parser_Optimize_Report report = {};
+            optimize(parser, &report);
+
+            if ( !tsv ) {
+                fprintf(stderr, "%s: ", workload->name);
+                parser_optimize_report_print(&report, stderr);
+            }
+        }
+
+        for ( int m = BENCH_MODE_RUN; m <= BENCH_MODE_RECOGNIZE; ++m ) {
+            Bench_Result result = {};
+            snprintf(result.workload, sizeof(result.workload), "%s", workload->name);
+            snprintf(result.mode, sizeof(result.mode), "%s", bench_mode_names[m]);
+
+            if ( !bench_measure(parser, input, workload->index_scale, (Bench_Mode)m, min_time_ms, &result) ) {
+                fprintf(stderr, "%s/%s: eingabe konnte nicht vollständig geparst werden\n",
+                        result.workload, result.mode);
+                exit_code = 1;
+                continue;
+            }
+
+            if ( tsv ) {
+                printf("%s\t%s\t%zu\t%zu\t%.0f\t%.2f\t%.0f\t%.0f\n", result.workload, result.mode,
+                        result.bytes, result.iterations, result.ns_per_op, result.mb_per_s,
+                        result.allocs_per_op, result.alloc_bytes_per_op);
+                continue;
+            }
+
+            printf("%-10s %-10s %10zu %8zu %14.0f %10.2f %12.0f %14.0f", result.workload,
+                    result.mode, result.bytes, result.iterations, result.ns_per_op,
+                    result.mb_per_s, result.allocs_per_op, result.alloc_bytes_per_op);
+
+            double baseline_ns = 0;
+            if ( compare && bench_baseline(compare, result.workload, result.mode, &baseline_ns) ) {
+                printf("   %+6.1f%%", 100.0*(result.ns_per_op - baseline_ns)/baseline_ns);
+            }
+
+            printf("\n");
+        }
+
+        free(input);
+    }
+
+    return exit_code;
+}
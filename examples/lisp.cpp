@@ -82,6 +82,8 @@ int evaluate(Expr *expr) {
 }
 
 void interpreter(Urq::Parser *parser, char *program) {
+    /* zu tief verschachtelte ausdrücke scheitern, statt den c-stack aufzubrauchen */
+    Urq::parser_max_depth = 1000;
     auto result = run(parser, program);
 
     if ( !result.success ) {
@@ -98,35 +100,28 @@ void interpreter(Urq::Parser *parser, char *program) {
 int main(int argc, char const* argv[]) {
     using namespace Urq::api;
 
-    auto parens = Between(Chr('('), Chr(')'));
-    auto number = Map(Digits, [](Parser_Result result, size_t index, void *user_data) {
-        int num = 0;
-        for ( int i = 0; i < result.str.len; ++i ) {
-            num *= 10;
-            num += result.str.val[i] - '0';
-        }
-
-        return parser_result_custom(expr_num(num));
-    });
+    /* Lexeme überliest den leerraum hinter jedem token, die sequenzen bleiben kurz */
+    auto parens = Between(Lexeme(Chr('(')), Lexeme(Chr(')')));
+    auto number = Lexeme(Map(Unsigned(10), [](Parser_Result result, size_t index, void *user_data) {
+        return parser_result_custom(expr_num((uint32_t)result.u64.val));
+    }));
 
-    auto op = Choice({
+    auto op = Lexeme(Choice({
         Chr('+'), Chr('-'), Chr('*'), Chr('/')
-    });
+    }));
 
     auto expr = Choice({ number, Empty });
 
     auto program = Map(parens(Seq_Of({
         op,
-        Whitespace,
         expr,
-        Whitespace,
         expr
     })), [](Parser_Result result, size_t index, void *user_data) {
-        assert(result.arr.val.num_elems == 5);
+        assert(result.arr.val.num_elems == 3);
 
         char op = parser_result_entry(&result.arr.val, 0).chr.val;
-        Expr *a = (Expr *)parser_result_entry(&result.arr.val, 2).custom.val;
-        Expr *b = (Expr *)parser_result_entry(&result.arr.val, 4).custom.val;
+        Expr *a = (Expr *)parser_result_entry(&result.arr.val, 1).custom.val;
+        Expr *b = (Expr *)parser_result_entry(&result.arr.val, 2).custom.val;
 
         return parser_result_custom(expr_bin(op, a, b));
     });
@@ -3,7 +3,7 @@
 #endif
 
 namespace Urq {
-    Parser *Bit = parser_create([](Parser *p, Parser_State state) {
+    Parser *Bit = parser_create([](Parser *p, const Parser_State &state) {
         if ( !state.success ) {
             return state;
         }
@@ -11,8 +11,9 @@ namespace Urq {
         size_t byte_offset = (state.index / 8);
         uint32_t bit_offset  = 7 - (state.index % 8);
 
-        size_t len = strlen(state.val);
-        if ( byte_offset >= len ) {
+        /* alle bytes vor byte_offset wurden bereits gelesen, die eingabe endet also
+         * genau dann vorher, wenn hier das nullbyte steht. */
+        if ( state.val[byte_offset] == '\0' ) {
             return parser_update_error(state, "Bit: unerwartet ende der eingabe erreicht");
         }
 
@@ -21,7 +22,7 @@ namespace Urq {
         return parser_update_state(state, state.index+1, parser_result_u64(value));
     });
 
-    Parser *One = parser_create([](Parser *p, Parser_State state) {
+    Parser *One = parser_create([](Parser *p, const Parser_State &state) {
         if ( !state.success ) {
             return state;
         }
@@ -29,8 +30,7 @@ namespace Urq {
         size_t byte_offset = (state.index / 8);
         uint32_t bit_offset  = 7 - (state.index % 8);
 
-        size_t len = strlen(state.val);
-        if ( byte_offset >= len ) {
+        if ( state.val[byte_offset] == '\0' ) {
             return parser_update_error(state, "Bit: unerwartet ende der eingabe erreicht");
         }
 
@@ -43,7 +43,7 @@ namespace Urq {
         return parser_update_state(state, state.index+1, parser_result_u64(value));
     });
 
-    Parser *Zero = parser_create([](Parser *p, Parser_State state) {
+    Parser *Zero = parser_create([](Parser *p, const Parser_State &state) {
         if ( !state.success ) {
             return state;
         }
@@ -51,8 +51,7 @@ namespace Urq {
         size_t byte_offset = (state.index / 8);
         uint32_t bit_offset  = 7 - (state.index % 8);
 
-        size_t len = strlen(state.val);
-        if ( byte_offset >= len ) {
+        if ( state.val[byte_offset] == '\0' ) {
             return parser_update_error(state, "Bit: unerwartet ende der eingabe erreicht");
         }
 
@@ -72,6 +71,8 @@ namespace Urq {
         }
 
         Parser_List sequence = {};
+        parser_list_reserve(&sequence, num);
+
         for ( size_t i = 0; i < num; ++i ) {
             parser_push(&sequence, Bit);
         }
@@ -97,6 +98,8 @@ namespace Urq {
         }
 
         Parser_List sequence = {};
+        parser_list_reserve(&sequence, num);
+
         for ( size_t i = 0; i < num; ++i ) {
             parser_push(&sequence, Bit);
         }
@@ -125,6 +128,8 @@ namespace Urq {
         return result;
     }
 
+    /* je zeichen ein knoten, der die nächsten acht bits am stück mit dem zeichen
+     * vergleicht. */
     Parser *
     Raw_String(char *str) {
         size_t len = strlen(str);
@@ -134,23 +139,35 @@ namespace Urq {
         }
 
         Parser_List sequence = {};
+        parser_list_reserve(&sequence, len);
+
         for ( int i = 0; i < len; ++i ) {
-            uint8_t n = (uint8_t)str[i];
+            auto parser = parser_create([](Parser *p, const Parser_State &state) {
+                if ( !state.success ) {
+                    return state;
+                }
 
-            auto parser = Chain(Uint(8), [](Parser_Result result, void *user_data) {
-                uint8_t n = *(uint8_t *)user_data;
+                size_t byte_offset = (state.index / 8);
+                uint32_t bit_offset  = (state.index % 8);
 
-                if ( result.u64.val == n ) {
-                    return Succeed(result);
-                } else {
-                    return Fail("Raw_String: erwartet %c, aber %c erhalten", n, result.u64.val);
+                /* ohne versatz genügt ein byte, sonst reicht das zeichen ins nächste */
+                if ( state.val[byte_offset] == '\0' || (bit_offset && state.val[byte_offset+1] == '\0') ) {
+                    return parser_update_error(state, "Bit: unerwartet ende der eingabe erreicht");
                 }
-            });
 
-            uint8_t *user_data = (uint8_t *)parser_alloc(sizeof(uint8_t));
-            *user_data = n;
+                uint32_t window = ((uint32_t)(uint8_t)state.val[byte_offset] << 8) |
+                                  (bit_offset ? (uint8_t)state.val[byte_offset+1] : 0);
+                uint8_t value = (uint8_t)(window >> (8 - bit_offset));
+                uint8_t n = (uint8_t)p->n[0];
+
+                if ( value != n ) {
+                    return parser_update_error(state, "Raw_String: erwartet %c, aber %c erhalten", n, value);
+                }
+
+                return parser_update_state(state, state.index + 8, parser_result_u64(value));
+            });
 
-            parser->user_data = user_data;
+            parser->n[0] = str[i];
             parser_push(&sequence, parser);
         }
 
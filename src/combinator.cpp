@@ -10,6 +10,29 @@
 #include <regex>
 
 #include <initializer_list>
+#include <atomic>
+#include <chrono>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PARSER_SSE2 1
+#else
+#define PARSER_SSE2 0
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#ifdef PARSER_PROFILE
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+#endif
 
 namespace Urq {
 
@@ -18,15 +41,22 @@ struct Parser_Value;
 struct Parser_State;
 struct Parser_Result;
 struct Parser_List;
-
+struct Parser_Context;
+struct Lexer_Token_List;
+struct Parser_Trivia;
+struct Parser_Jump_Table;
+struct Parser_Chain_Cache;
+struct Parser_Memo;
+
+Parser_Result parser_result_none();
 Parser_Result parser_result_chr(char str);
 Parser_Result parser_result_str(char *str, size_t len);
 Parser_Result parser_result_custom(void *val);
-Parser_State  parser_update_state(Parser_State in, size_t index, Parser_Result r);
-Parser_State  parser_update_result(Parser_State in, Parser_Result r);
-Parser_State  parser_update_error(Parser_State in, char *fmt, ...);
+Parser_State  parser_update_state(const Parser_State &in, size_t index, Parser_Result r);
+Parser_State  parser_update_result(const Parser_State &in, Parser_Result r);
+Parser_State  parser_update_error(const Parser_State &in, char *fmt, ...);
 
-#define PARSER_PROC(name) Parser_State name(Parser *p, Parser_State state)
+#define PARSER_PROC(name) Parser_State name(Parser *p, const Parser_State &state)
 typedef PARSER_PROC(Parser_Proc);
 
 #define PARSER_MAP_PROC(name) Parser_Result name(Parser_Result result, size_t index, void *user_data)
@@ -35,6 +65,11 @@ typedef PARSER_MAP_PROC(Parser_Map);
 #define PARSER_CHAIN_PROC(name) Parser * name(Parser_Result result, void *user_data)
 typedef PARSER_CHAIN_PROC(Parser_Chain);
 
+/* baut den knoten eines operators. bei präfixoperatoren ist lhs leer, bei
+ * postfixoperatoren rhs. */
+#define PARSER_EXPR_PROC(name) Parser_Result name(Parser_Result op, Parser_Result lhs, Parser_Result rhs, void *user_data)
+typedef PARSER_EXPR_PROC(Parser_Expr);
+
 #ifndef ALLOCATOR
 #define ALLOCATOR(name) void * name(size_t size)
 #endif
@@ -58,6 +93,166 @@ DEALLOCATOR(parser_dealloc_default) {
 Alloc   * parser_alloc   = parser_alloc_default;
 Dealloc * parser_dealloc = parser_dealloc_default;
 
+enum Parser_Alloc_Category {
+    PARSER_ALLOC_OTHER,
+    PARSER_ALLOC_RESULT_LIST,
+    PARSER_ALLOC_ERROR_MSG,
+    PARSER_ALLOC_REGEX_COPY,
+    PARSER_ALLOC_GRAMMAR,
+    PARSER_ALLOC_TOKENS,
+    PARSER_ALLOC_VALUES,
+
+    PARSER_ALLOC_NUM_CATEGORIES,
+};
+
+void * parser_alloc_tagged(size_t size, Parser_Alloc_Category category);
+
+#ifndef GRAMMAR_BLOCK_SIZE
+#define GRAMMAR_BLOCK_SIZE 4096
+#endif
+
+struct Grammar_Block {
+    Grammar_Block * next;
+    size_t          size;
+    size_t          used;
+};
+
+/* besitzt alle knoten, listen und zeichenketten, die zwischen grammar_begin und
+ * grammar_end angelegt werden. grammar_free gibt alles auf einmal frei. */
+struct Grammar {
+    Grammar_Block * blocks;
+    Grammar       * prev;
+
+    size_t          bytes;     /* an knoten, listen und zeichenketten vergeben */
+    size_t          reserved;  /* insgesamt über parser_alloc reserviert */
+    size_t          num_nodes;
+    size_t          num_allocs;
+
+    /* voreinstellung für alle Lexeme, die in dieser grammatik angelegt werden */
+    Parser_Trivia * trivia;
+};
+
+Grammar *parser_grammar = NULL;
+
+/* vor jedem speicherstück aus grammar_alloc steht, wem es gehört: der grammatik, aus
+ * deren arena es stammt, oder NULL, wenn es einzeln über parser_alloc reserviert
+ * wurde. grammar_dealloc entscheidet danach und nicht nach der gerade aktiven
+ * grammatik. 16 bytes, damit die ausrichtung erhalten bleibt. */
+#define GRAMMAR_ALLOC_HEADER 16
+
+Grammar *
+grammar_owner(void *mem) {
+    Grammar *result = *(Grammar **)((char *)mem - GRAMMAR_ALLOC_HEADER);
+
+    return result;
+}
+
+void
+grammar_begin(Grammar *g) {
+    g->prev = parser_grammar;
+    parser_grammar = g;
+}
+
+void
+grammar_end() {
+    if ( parser_grammar ) {
+        parser_grammar = parser_grammar->prev;
+    }
+}
+
+void *
+grammar_alloc(size_t size) {
+    Grammar *g = parser_grammar;
+
+    if ( !g ) {
+        char *mem = (char *)parser_alloc_tagged(GRAMMAR_ALLOC_HEADER + size, PARSER_ALLOC_GRAMMAR);
+        *(Grammar **)mem = NULL;
+
+        return mem + GRAMMAR_ALLOC_HEADER;
+    }
+
+    size_t header = (sizeof(Grammar_Block) + 15) & ~(size_t)15;
+    size = GRAMMAR_ALLOC_HEADER + ((size + 15) & ~(size_t)15);
+
+    Grammar_Block *block = g->blocks;
+    if ( !block || block->used + size > block->size ) {
+        size_t block_size = (size > GRAMMAR_BLOCK_SIZE) ? size : GRAMMAR_BLOCK_SIZE;
+
+        block = (Grammar_Block *)parser_alloc_tagged(header + block_size, PARSER_ALLOC_GRAMMAR);
+        block->next = g->blocks;
+        block->size = block_size;
+        block->used = 0;
+
+        g->blocks    = block;
+        g->reserved += header + block_size;
+    }
+
+    char *mem = (char *)block + header + block->used;
+    *(Grammar **)mem = g;
+
+    block->used   += size;
+    g->bytes      += size;
+    g->num_allocs += 1;
+
+    return mem + GRAMMAR_ALLOC_HEADER;
+}
+
+/* gibt speicher aus grammar_alloc zurück. speicher aus einem arena wird nur als ganzes
+ * mit grammar_free zurückgegeben, auch wenn er erst nach grammar_end wächst. */
+void
+grammar_dealloc(void *mem) {
+    if ( !mem || grammar_owner(mem) ) {
+        return;
+    }
+
+    parser_dealloc((char *)mem - GRAMMAR_ALLOC_HEADER);
+}
+
+/* ob mem in einem block von g liegt */
+bool
+grammar_owns(Grammar *g, void *mem) {
+    size_t header = (sizeof(Grammar_Block) + 15) & ~(size_t)15;
+
+    for ( Grammar_Block *block = g->blocks; block; block = block->next ) {
+        char *begin = (char *)block;
+
+        if ( (char *)mem >= begin && (char *)mem < begin + header + block->size ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* ob mem zu dem speicher von owner gehört, der gerade freigegeben wird */
+#define PARSER_OWNS_PROC(name) bool name(void *owner, void *mem)
+typedef PARSER_OWNS_PROC(Parser_Owns);
+
+void parser_forget_nodes(Parser_Owns *owns, void *owner);
+
+void
+grammar_free(Grammar *g) {
+    /* eine noch aktive grammatik wird aus dem stapel genommen, auch wenn eine andere
+     * über ihr liegt, sonst zeigte deren prev auf den geleerten g */
+    for ( Grammar **link = &parser_grammar; *link; link = &(*link)->prev ) {
+        if ( *link == g ) {
+            *link = g->prev;
+            break;
+        }
+    }
+
+    parser_forget_nodes([](void *owner, void *mem) { return grammar_owns((Grammar *)owner, mem); }, g);
+
+    Grammar_Block *block = g->blocks;
+    while ( block ) {
+        Grammar_Block *next = block->next;
+        parser_dealloc(block);
+        block = next;
+    }
+
+    *g = {};
+}
+
 struct Parser_List {
     Parser ** elems;
     size_t   num_elems;
@@ -76,6 +271,7 @@ enum Parser_Result_Kind {
     PARSER_RESULT_STR,
     PARSER_RESULT_U64,
     PARSER_RESULT_S64,
+    PARSER_RESULT_F64,
     PARSER_RESULT_ARR,
     PARSER_RESULT_CUSTOM,
 };
@@ -100,6 +296,10 @@ struct Parser_Result {
             int64_t val;
         } s64;
 
+        struct {
+            double val;
+        } f64;
+
         struct {
             Parser_Result_List val;
             size_t len;
@@ -111,7 +311,113 @@ struct Parser_Result {
     };
 };
 
+#ifndef PARSER_RESULT_INLINE_CAP
+#define PARSER_RESULT_INLINE_CAP 8
+#endif
+
+/* kleiner puffer auf dem stack für die ergebnisse eines kombinators. die ersten
+ * PARSER_RESULT_INLINE_CAP elemente liegen inline, erst darüber hinaus wird auf den heap
+ * ausgewichen. darf nicht kopiert werden, da list.elems auf inline_elems zeigt. */
+struct Parser_Result_Buffer {
+    Parser_Result_List list;
+    size_t             expected;  /* größe beim ersten ausweichen auf den heap */
+    Parser_Result      inline_elems[PARSER_RESULT_INLINE_CAP];
+};
+
+enum Parser_Kind {
+    PARSER_KIND_CUSTOM,
+    PARSER_KIND_WHITESPACE,
+    PARSER_KIND_DIGIT,
+    PARSER_KIND_DIGITS,
+    PARSER_KIND_LETTERS,
+    PARSER_KIND_FAIL,
+    PARSER_KIND_SUCCEED,
+    PARSER_KIND_CHR,
+    PARSER_KIND_STR,
+    PARSER_KIND_NUMBER,
+    PARSER_KIND_SEQ_OF,
+    PARSER_KIND_CHOICE,
+    PARSER_KIND_REGEX,
+    PARSER_KIND_CHAIN,
+    PARSER_KIND_MAP,
+    PARSER_KIND_ERROR_MAP,
+    PARSER_KIND_MANY,
+    PARSER_KIND_MANY1,
+    PARSER_KIND_SKIP,
+    PARSER_KIND_CAPTURE,
+    PARSER_KIND_SEP_BY,
+    PARSER_KIND_SEP_BY1,
+    PARSER_KIND_EXPRESSION,
+    PARSER_KIND_CUT,
+    PARSER_KIND_COMMIT,
+    PARSER_KIND_TOKEN,
+    PARSER_KIND_TOKEN_TEXT,
+    PARSER_KIND_UNSIGNED,
+    PARSER_KIND_INTEGER,
+    PARSER_KIND_FLOAT,
+    PARSER_KIND_LEXEME,
+    PARSER_KIND_UTF8_CHAR,
+    PARSER_KIND_UTF8_CLASS,
+    PARSER_KIND_UTF8_IDENT,
+    PARSER_KIND_CHR_SET,
+    PARSER_KIND_CHR_SPAN,
+    PARSER_KIND_CHR_SPAN1,
+    PARSER_KIND_SWITCH,
+    PARSER_KIND_MEMO,
+    PARSER_KIND_ADAPTIVE_CHOICE,
+};
+
+#ifdef PARSER_PROFILE
+struct Parser_Profile {
+    uint64_t calls;
+    uint64_t successes;
+    uint64_t failures;
+    uint64_t backtracks;
+    uint64_t bytes;
+
+    /* zeit in ticks, inklusive und exklusive der aufgerufenen unterparser */
+    uint64_t time_incl;
+    uint64_t time_excl;
+
+    uint32_t active;
+    bool     registered;
+    Parser * next;
+};
+#endif
+
+enum Parser_Op_Kind {
+    PARSER_OP_PREFIX,
+    PARSER_OP_INFIX,
+    PARSER_OP_POSTFIX,
+};
+
+enum Parser_Op_Assoc {
+    PARSER_ASSOC_LEFT,
+    PARSER_ASSOC_RIGHT,
+    PARSER_ASSOC_NONE,
+};
+
+struct Parser_Op {
+    Parser_Op_Kind    kind;
+    Parser          * p;          /* erkennt das operatorzeichen */
+    int               precedence; /* höher bindet stärker */
+    Parser_Op_Assoc   assoc;
+    Parser_Expr     * build;
+};
+
+#ifdef PARSER_ALLOC_STATS
+struct Parser_Alloc_Stats {
+    uint64_t bytes[PARSER_ALLOC_NUM_CATEGORIES];
+    uint64_t count[PARSER_ALLOC_NUM_CATEGORIES];
+
+    bool     registered;
+    Parser * next;
+};
+#endif
+
 struct Parser {
+    Parser_Kind kind;
+    char *name;
     char *str;
     char n[10];
     int num;
@@ -123,20 +429,117 @@ struct Parser {
     Parser_Chain * chain_proc;
     Parser *p;
 
+    Parser_Op * ops;
+
+    /* fortsetzungen von Switch und Chain_Cached nach dem wert des ersten parsers */
+    Parser_Jump_Table * table;
+
     Parser_List   sequence;
     Parser_Proc * proc;
+
+#ifdef PARSER_PROFILE
+    Parser_Profile profile;
+#endif
+
+#ifdef PARSER_ALLOC_STATS
+    Parser_Alloc_Stats alloc_stats;
+#endif
+
+#ifdef PARSER_TRACE
+    uint32_t trace_id;
+#endif
+};
+
+#ifdef PARSER_ALLOC_STATS
+Parser             * parser_alloc_node  = NULL; /* gerade aktiver knoten */
+Parser             * parser_alloc_nodes = NULL; /* alle knoten mit allokationen */
+Parser_Alloc_Stats   parser_alloc_unattributed = {};
+bool                 parser_alloc_stats_report = true; /* zusammenfassung am ende von run() */
+#endif
+
+enum Parser_Limit {
+    PARSER_LIMIT_NONE,
+    PARSER_LIMIT_DEPTH,
+    PARSER_LIMIT_STEPS,
+    PARSER_LIMIT_MEMORY,
+    PARSER_LIMIT_TIME,
+};
+
+/* obergrenzen für einen lauf, 0 heißt jeweils unbegrenzt. nach dem lauf stehen in
+ * steps und bytes die verbrauchten mengen und in exceeded die überschrittene grenze. */
+struct Parser_Limits {
+    size_t       max_steps;   /* aufrufe von parser_call */
+    size_t       max_bytes;   /* über parser_alloc_tagged reservierter speicher */
+    uint64_t     max_time_us; /* laufzeit in mikrosekunden */
+
+    Parser_Limit exceeded;
+    size_t       steps;
+    size_t       bytes;
+
+    size_t       next_check;  /* ab dieser schrittzahl wird genauer geprüft */
+    uint64_t     deadline;
 };
 
+/* grenzen der läufe, die auf diesem thread beginnen, NULL wenn es keine gibt. ein
+ * lauf übernimmt sie mit parser_limits_attach in seinen Parser_Context, nur
+ * parser_alloc_tagged kennt keinen zustand und rechnet hier ab. */
+thread_local Parser_Limits * parser_limits = NULL;
+
+/* reserviert speicher und ordnet ihn, wenn PARSER_ALLOC_STATS gesetzt ist, dem gerade
+ * aktiven knoten und der übergebenen kategorie zu. */
+void *
+parser_alloc_tagged(size_t size, Parser_Alloc_Category category) {
+    if ( parser_limits ) {
+        parser_limits->bytes += size;
+
+        /* der nächste parser_call prüft dann die grenzen */
+        if ( parser_limits->max_bytes && parser_limits->bytes > parser_limits->max_bytes ) {
+            parser_limits->next_check = 0;
+        }
+    }
+
+#ifdef PARSER_ALLOC_STATS
+    Parser_Alloc_Stats *stats = &parser_alloc_unattributed;
+
+    if ( parser_alloc_node ) {
+        stats = &parser_alloc_node->alloc_stats;
+
+        if ( !stats->registered ) {
+            stats->registered = true;
+            stats->next = parser_alloc_nodes;
+            parser_alloc_nodes = parser_alloc_node;
+        }
+    }
+
+    stats->bytes[category] += size;
+    stats->count[category] += 1;
+#endif
+
+    return parser_alloc(size);
+}
+
+void
+parser_list_reserve(Parser_List *list, size_t cap) {
+    if ( cap <= list->cap ) {
+        return;
+    }
+
+    void *mem = grammar_alloc(sizeof(Parser *)*cap);
+
+    /* memcpy mit NULL erlaubt dem compiler, die prüfung in grammar_dealloc zu streichen */
+    if ( list->elems ) {
+        memcpy(mem, list->elems, list->num_elems*sizeof(Parser *));
+        grammar_dealloc(list->elems);
+    }
+
+    list->elems = (Parser **)mem;
+    list->cap   = cap;
+}
+
 void
 parser_push(Parser_List *list, Parser *p) {
     if ( list->num_elems >= list->cap ) {
-        size_t new_cap = (list->cap < 16) ? 16 : list->cap*2;
-        void *mem = parser_alloc(sizeof(Parser)*new_cap);
-        memcpy(mem, list->elems, list->num_elems*sizeof(Parser));
-        parser_dealloc(list->elems);
-
-        list->elems = (Parser **)mem;
-        list->cap   = new_cap;
+        parser_list_reserve(list, (list->cap < 4) ? 4 : list->cap*2);
     }
 
     list->elems[list->num_elems++] = p;
@@ -156,15 +559,26 @@ parser_entry(Parser_List *list, size_t i) {
 }
 
 void
-parser_result_push(Parser_Result_List *list, Parser_Result p) {
-    if ( list->num_elems >= list->cap ) {
-        size_t new_cap = (list->cap < 16) ? 16 : list->cap*2;
-        void *mem = parser_alloc(sizeof(Parser_Result)*new_cap);
+parser_result_reserve(Parser_Result_List *list, size_t cap) {
+    if ( cap <= list->cap ) {
+        return;
+    }
+
+    void *mem = parser_alloc_tagged(sizeof(Parser_Result)*cap, PARSER_ALLOC_RESULT_LIST);
+
+    if ( list->elems ) {
         memcpy(mem, list->elems, list->num_elems*sizeof(Parser_Result));
         parser_dealloc(list->elems);
+    }
 
-        list->elems = (Parser_Result *)mem;
-        list->cap   = new_cap;
+    list->elems = (Parser_Result *)mem;
+    list->cap   = cap;
+}
+
+void
+parser_result_push(Parser_Result_List *list, Parser_Result p) {
+    if ( list->num_elems >= list->cap ) {
+        parser_result_reserve(list, (list->cap < 4) ? 4 : list->cap*2);
     }
 
     list->elems[list->num_elems++] = p;
@@ -183,594 +597,3417 @@ parser_result_entry(Parser_Result_List *list, size_t i) {
     return result;
 }
 
-struct Parser_State {
-    bool success;
-    char *msg;
+/* beginnt immer inline, damit ein früh scheiternder zweig nichts anfordert. expected
+ * ist die zu erwartende zahl der ergebnisse und bestimmt die größe, sobald der puffer
+ * auf den heap ausweicht. */
+void
+parser_result_buffer_init(Parser_Result_Buffer *buf, size_t expected) {
+    buf->list.num_elems = 0;
+    buf->list.elems     = buf->inline_elems;
+    buf->list.cap       = PARSER_RESULT_INLINE_CAP;
+    buf->expected       = expected;
+}
 
-    char *val;
-    Parser_Result result;
-    size_t index;
-};
+void
+parser_result_buffer_push(Parser_Result_Buffer *buf, Parser_Result r) {
+    Parser_Result_List *list = &buf->list;
 
-Parser *
-parser_create(Parser_Proc *proc) {
-    Parser *result = (Parser *)parser_alloc(sizeof(Parser));
+    if ( list->num_elems >= list->cap ) {
+        size_t new_cap = (buf->expected > list->cap*2) ? buf->expected : list->cap*2;
+        void *mem = parser_alloc_tagged(sizeof(Parser_Result)*new_cap, PARSER_ALLOC_RESULT_LIST);
+        memcpy(mem, list->elems, list->num_elems*sizeof(Parser_Result));
 
-    result->proc = proc;
+        if ( list->elems != buf->inline_elems ) {
+            parser_dealloc(list->elems);
+        }
 
-    return result;
-}
+        list->elems = (Parser_Result *)mem;
+        list->cap   = new_cap;
+    }
 
-Parser *Whitespace = parser_create(
-    [](Parser *p, Parser_State state) {
-        char *s = state.val+state.index;
-        while ( *s == ' ' || *s == '\t' || *s == '\r' || *s == '\v' || *s == '\n' ) {
-            s++;
-        }
+    list->elems[list->num_elems++] = r;
+}
 
-        return parser_update_state(state, s-state.val, parser_result_str(state.val+state.index, s-(state.val+state.index)));
+void
+parser_result_buffer_free(Parser_Result_Buffer *buf) {
+    if ( buf->list.elems != buf->inline_elems ) {
+        parser_dealloc(buf->list.elems);
     }
-);
 
-Parser *Digit = parser_create(
-    [](Parser *p, Parser_State state) {
-        char *s = state.val+state.index;
+    buf->list = {};
+}
 
-        if ( !s || !strlen(s) ) {
-            return parser_update_error(state, "Digit: ende der eingabe erreicht");
-        }
+/* liefert die gesammelten ergebnisse als liste mit genau passender größe. leere listen
+ * kommen ganz ohne speicher aus, inline-ergebnisse werden einmalig auf den heap kopiert. */
+Parser_Result_List
+parser_result_buffer_list(Parser_Result_Buffer *buf) {
+    Parser_Result_List result = {};
 
-        if ( s[0] < '0' || s[0] > '9' ) {
-            return parser_update_error(state, "Digit: keine ziffer gefunden");
-        }
+    if ( buf->list.num_elems == 0 ) {
+        parser_result_buffer_free(buf);
 
-        return parser_update_state(state, state.index + 1, parser_result_str(s, 1));
+        return result;
     }
-);
 
-Parser *Digits = parser_create(
-    [](Parser *p, Parser_State state) {
-        char *s = state.val+state.index;
+    if ( buf->list.elems != buf->inline_elems ) {
+        result = buf->list;
+        buf->list = {};
 
-        if ( !s || !strlen(s) ) {
-            return parser_update_error(state, "digits: ende der eingabe erreicht");
-        }
+        return result;
+    }
 
-        while ( *s >= '0' && *s <= '9' ) {
-            s++;
-        }
+    size_t size = sizeof(Parser_Result)*buf->list.num_elems;
+    result.elems     = (Parser_Result *)parser_alloc_tagged(size, PARSER_ALLOC_RESULT_LIST);
+    result.num_elems = buf->list.num_elems;
+    result.cap       = buf->list.num_elems;
+    memcpy(result.elems, buf->list.elems, size);
 
-        if (s == (state.val+state.index)) {
-            return parser_update_error(state, "digits: keine ziffern gefunden");
-        }
+    buf->list = {};
 
-        return parser_update_state(state, s-state.val, parser_result_str(state.val+state.index, s-(state.val+state.index)));
-    }
-);
+    return result;
+}
 
-Parser *Letters = parser_create(
-    [](Parser *p, Parser_State state) {
-        char *s = state.val+state.index;
+enum Parser_Flags {
+    PARSER_FLAG_NONE        = 0,
+    PARSER_FLAG_NO_CAPTURE  = 1 << 0, /* kombinatoren bauen keine ergebnisse auf */
+    PARSER_FLAG_NO_MESSAGES = 1 << 1, /* fehlermeldungen werden nicht formatiert */
+    PARSER_FLAG_NO_EVENTS   = 1 << 2, /* es werden keine ereignisse gemeldet */
+    PARSER_FLAG_CUT         = 1 << 3, /* der innerste zweig ist festgelegt */
+    PARSER_FLAG_FATAL       = 1 << 4, /* der lauf wird ohne weitere versuche abgebrochen */
+    PARSER_FLAG_LIMIT       = 1 << 5, /* abbruch wegen einer grenze, siehe Parser_Limits */
+};
 
-        if ( !s || !strlen(s) ) {
-            return parser_update_error(state, "letters: ende der eingabe erreicht");
-        }
+/* wird von jedem knoten gelesen und neu geliefert. procs bekommen den zustand als
+ * referenz und liefern den neuen über den rückgabewert, den der aufrufer an ort und
+ * stelle anlegt. die felder sind so geordnet, daß nur am ende füllbytes entstehen. bei
+ * 64 bit sind das 80 bytes: index, das ergebnis mit 40, drei zeiger, flags und
+ * success. */
+struct Parser_State {
+    size_t index;
+    Parser_Result result;
 
-        while ( *s >= 'A' && *s <= 'Z' || *s >= 'a' && *s <= 'z' ) {
-            s++;
-        }
+    char *val;
+    char *msg;
+    Parser_Context *ctx;
 
-        if (s == state.val) {
-            return parser_update_error(state, "letters: keine buchstaben gefunden");
-        }
+    uint32_t flags;
+    bool success;
+};
 
-        return parser_update_state(state, s-state.val,
-                parser_result_str(state.val+state.index, s-(state.val+state.index)));
-    }
-);
+static_assert(sizeof(void *) != 8 || sizeof(Parser_State) == 80,
+        "Parser_State: neues feld, größe und kommentar prüfen");
 
-Parser_Result
-parser_result_chr(char c) {
-    Parser_Result result = {};
+#define PARSER_BEGIN_NODE_PROC(name) void name(Parser *node, Parser_Kind kind, void *user_data)
+typedef PARSER_BEGIN_NODE_PROC(Parser_Begin_Node);
 
-    result.kind = PARSER_RESULT_CHR;
-    result.chr.val = c;
+#define PARSER_VALUE_PROC(name) void name(Parser_Result result, void *user_data)
+typedef PARSER_VALUE_PROC(Parser_Value_Event);
 
-    return result;
-}
+#define PARSER_END_NODE_PROC(name) void name(Parser *node, Parser_Kind kind, void *user_data)
+typedef PARSER_END_NODE_PROC(Parser_End_Node);
 
-Parser_Result
-parser_result_str(char *str, size_t len) {
-    Parser_Result result = {};
+/* jedes begin_node wird von einem end_node geschlossen, auch wenn der knoten scheitert.
+ * die ereignisse gescheiterter zweige eines Choice oder einer wiederholung werden
+ * verworfen, bevor sie ankommen. */
+struct Parser_Event_Handler {
+    Parser_Begin_Node  * begin_node;
+    Parser_Value_Event * value;
+    Parser_End_Node    * end_node;
+    void               * user_data;
+};
 
-    result.kind = PARSER_RESULT_STR;
-    result.str.val = str;
-    result.str.len = len;
+enum Parser_Event_Kind {
+    PARSER_EVENT_BEGIN_NODE,
+    PARSER_EVENT_VALUE,
+    PARSER_EVENT_END_NODE,
+};
+struct Parser_Event {
+    Parser_Event_Kind kind;
+    Parser *node;
+    Parser_Result result;
+};
 
-    return result;
-}
+struct Parser_Event_List {
+    Parser_Event * elems;
+    size_t         num_elems;
+    size_t         cap;
+};
 
-Parser_Result
-parser_result_u64(uint64_t val) {
-    Parser_Result result = {};
+/* zustand, der für die gesamte dauer eines laufs gilt. */
+struct Parser_Context {
+    Parser_Event_Handler * handler;
 
-    result.kind = PARSER_RESULT_U64;
-    result.u64.val = val;
+    /* ereignisse innerhalb zurücknehmbarer zweige werden hier gepuffert, solange
+     * try_depth > 0 ist. */
+    Parser_Event_List      events;
+    size_t                 try_depth;
 
-    return result;
-}
+    /* beim parsen über tokens (run_tokens) die ausgabe des lexers. index zählt dann
+     * tokens statt bytes. */
+    Lexer_Token_List     * tokens;
 
-Parser_Result
-parser_result_s64(int64_t val) {
-    Parser_Result result = {};
+    /* bei incremental_begin/incremental_edit die ergebnisse aller Memo-knoten */
+    Parser_Memo          * memo;
 
-    result.kind = PARSER_RESULT_S64;
-    result.s64.val = val;
+    /* position hinter dem letzten byte, das ein parser angesehen hat, ob er nun
+     * erfolgreich war oder nicht. Memo macht daran fest, welche änderungen ein
+     * ergebnis ungültig machen. */
+    size_t                 examined;
 
-    return result;
+    /* grenzen dieses laufs, siehe parser_limits_attach */
+    Parser_Limits        * limits;
+};
+
+/* meldet, daß der text bis vor end gelesen wurde. blätter, die über ihr ergebnis
+ * hinaus lesen oder nach mehreren bytes an ihrem anfang scheitern, rufen das selbst
+ * auf, alles andere erledigt parser_call. */
+void
+parser_examined(const Parser_State &state, size_t end) {
+    if ( state.ctx && state.ctx->examined < end ) {
+        state.ctx->examined = end;
+    }
+}
+
+void
+parser_event_deliver(Parser_Event_Handler *handler, Parser_Event *event) {
+    switch ( event->kind ) {
+        case PARSER_EVENT_BEGIN_NODE: {
+            if ( handler->begin_node ) {
+                handler->begin_node(event->node, event->node->kind, handler->user_data);
+            }
+        } break;
+
+        case PARSER_EVENT_VALUE: {
+            if ( handler->value ) {
+                handler->value(event->result, handler->user_data);
+            }
+        } break;
+
+        case PARSER_EVENT_END_NODE: {
+            if ( handler->end_node ) {
+                handler->end_node(event->node, event->node->kind, handler->user_data);
+            }
+        } break;
+    }
+}
+
+bool
+parser_event_active(const Parser_State *state) {
+    bool result = state->ctx && state->ctx->handler && !(state->flags & PARSER_FLAG_NO_EVENTS);
+
+    return result;
+}
+
+void
+parser_event_emit(const Parser_State *state, Parser_Event_Kind kind, Parser *node, Parser_Result r) {
+    if ( !parser_event_active(state) ) {
+        return;
+    }
+
+    Parser_Context *ctx = state->ctx;
+    Parser_Event event = {};
+
+    event.kind   = kind;
+    event.node   = node;
+    event.result = r;
+
+    if ( ctx->try_depth == 0 ) {
+        parser_event_deliver(ctx->handler, &event);
+        return;
+    }
+
+    Parser_Event_List *list = &ctx->events;
+    if ( list->num_elems >= list->cap ) {
+        size_t new_cap = (list->cap < 16) ? 16 : list->cap*2;
+        void *mem = parser_alloc_tagged(sizeof(Parser_Event)*new_cap, PARSER_ALLOC_OTHER);
+        memcpy(mem, list->elems, list->num_elems*sizeof(Parser_Event));
+        parser_dealloc(list->elems);
+
+        list->elems = (Parser_Event *)mem;
+        list->cap   = new_cap;
+    }
+
+    list->elems[list->num_elems++] = event;
+}
+
+/* beginnt einen zweig, der noch verworfen werden kann (alternative eines Choice,
+ * wiederholung eines Many). bis zum abschluß werden alle ereignisse gepuffert. */
+size_t
+parser_event_try(const Parser_State *state) {
+    if ( !parser_event_active(state) ) {
+        return 0;
+    }
+
+    state->ctx->try_depth += 1;
+
+    return state->ctx->events.num_elems;
+}
+
+/* schließt den zweig ab. gescheiterte zweige verwerfen ihre ereignisse, erfolgreiche
+ * werden ausgeliefert, sobald kein umgebender zweig mehr offen ist. */
+void
+parser_event_end_try(const Parser_State *state, size_t mark, bool success) {
+    if ( !parser_event_active(state) ) {
+        return;
+    }
+
+    Parser_Context *ctx = state->ctx;
+    ctx->try_depth -= 1;
+
+    if ( mark > ctx->events.num_elems ) {
+        mark = ctx->events.num_elems;
+    }
+
+    if ( !success ) {
+        ctx->events.num_elems = mark;
+        return;
+    }
+
+    if ( ctx->try_depth > 0 ) {
+        return;
+    }
+
+    for ( size_t i = mark; i < ctx->events.num_elems; ++i ) {
+        parser_event_deliver(ctx->handler, &ctx->events.elems[i]);
+    }
+
+    ctx->events.num_elems = mark;
+}
+
+/* stellt die nach innen gereichten flags wieder her, ein cut oder abbruch bleibt dabei
+ * erhalten. */
+void
+parser_restore_flags(Parser_State *state, uint32_t flags) {
+    state->flags = flags | (state->flags & (PARSER_FLAG_CUT | PARSER_FLAG_FATAL | PARSER_FLAG_LIMIT));
+}
+
+/* nach einem cut oder abbruch dürfen keine weiteren zweige versucht werden. */
+bool
+parser_committed(const Parser_State *state) {
+    bool result = (state->flags & (PARSER_FLAG_CUT | PARSER_FLAG_FATAL)) != 0;
+
+    return result;
+}
+
+/* beginnt einen neuen bereich für cuts (alternative, wiederholung) und liefert den cut
+ * des umgebenden bereichs zurück. */
+uint32_t
+parser_cut_enter(Parser_State *state) {
+    uint32_t result = state->flags & PARSER_FLAG_CUT;
+    state->flags &= ~PARSER_FLAG_CUT;
+
+    return result;
+}
+
+void
+parser_cut_leave(Parser_State *state, uint32_t outer) {
+    state->flags = (state->flags & ~PARSER_FLAG_CUT) | outer;
+}
+
+/* legt den innersten zweig fest. ist er der einzige offene, können seine gepufferten
+ * ereignisse sofort ausgeliefert und freigegeben werden. */
+void
+parser_commit(Parser_State *state) {
+    state->flags |= PARSER_FLAG_CUT;
+
+    Parser_Context *ctx = state->ctx;
+    if ( !ctx ) {
+        return;
+    }
+
+    if ( parser_event_active(state) && ctx->try_depth == 1 ) {
+        for ( size_t i = 0; i < ctx->events.num_elems; ++i ) {
+            parser_event_deliver(ctx->handler, &ctx->events.elems[i]);
+        }
+
+        ctx->events.num_elems = 0;
+    }
+}
+
+Parser *
+parser_create(Parser_Proc *proc, Parser_Kind kind = PARSER_KIND_CUSTOM) {
+    Parser *result = (Parser *)grammar_alloc(sizeof(Parser));
+    memset(result, 0, sizeof(Parser));
+
+    if ( parser_grammar ) {
+        parser_grammar->num_nodes += 1;
+    }
+
+    result->kind = kind;
+    result->proc = proc;
+
+    return result;
+}
+
+/* vergibt einen namen, unter dem der knoten in auswertungen erscheint. */
+Parser *
+parser_name(Parser *p, char *name) {
+    p->name = name;
+
+    return p;
+}
+
+char *
+parser_kind_name(Parser_Kind kind) {
+    switch ( kind ) {
+        case PARSER_KIND_CUSTOM:     return "Custom";
+        case PARSER_KIND_WHITESPACE: return "Whitespace";
+        case PARSER_KIND_DIGIT:      return "Digit";
+        case PARSER_KIND_DIGITS:     return "Digits";
+        case PARSER_KIND_LETTERS:    return "Letters";
+        case PARSER_KIND_FAIL:       return "Fail";
+        case PARSER_KIND_SUCCEED:    return "Succeed";
+        case PARSER_KIND_CHR:        return "Chr";
+        case PARSER_KIND_STR:        return "Str";
+        case PARSER_KIND_NUMBER:     return "Number";
+        case PARSER_KIND_SEQ_OF:     return "Seq_Of";
+        case PARSER_KIND_CHOICE:     return "Choice";
+        case PARSER_KIND_REGEX:      return "Regex";
+        case PARSER_KIND_CHAIN:      return "Chain";
+        case PARSER_KIND_MAP:        return "Map";
+        case PARSER_KIND_ERROR_MAP:  return "Error_Map";
+        case PARSER_KIND_MANY:       return "Many";
+        case PARSER_KIND_MANY1:      return "Many1";
+        case PARSER_KIND_SKIP:       return "Skip";
+        case PARSER_KIND_CAPTURE:    return "Capture";
+        case PARSER_KIND_SEP_BY:     return "Sep_By";
+        case PARSER_KIND_SEP_BY1:    return "Sep_By1";
+        case PARSER_KIND_EXPRESSION: return "Expression";
+        case PARSER_KIND_CUT:        return "Cut";
+        case PARSER_KIND_COMMIT:     return "Commit";
+        case PARSER_KIND_TOKEN:      return "Token";
+        case PARSER_KIND_TOKEN_TEXT: return "Token_Text";
+        case PARSER_KIND_UNSIGNED:   return "Unsigned";
+        case PARSER_KIND_INTEGER:    return "Integer";
+        case PARSER_KIND_FLOAT:      return "Float";
+        case PARSER_KIND_LEXEME:     return "Lexeme";
+        case PARSER_KIND_UTF8_CHAR:  return "Utf8_Char";
+        case PARSER_KIND_UTF8_CLASS: return "Utf8_Class";
+        case PARSER_KIND_UTF8_IDENT: return "Utf8_Ident";
+        case PARSER_KIND_CHR_SET:    return "Chr_Set";
+        case PARSER_KIND_CHR_SPAN:   return "Chr_Span";
+        case PARSER_KIND_CHR_SPAN1:  return "Chr_Span1";
+        case PARSER_KIND_SWITCH:     return "Switch";
+        case PARSER_KIND_MEMO:       return "Memo";
+        case PARSER_KIND_ADAPTIVE_CHOICE: return "Adaptive_Choice";
+    }
+
+    return "?";
+}
+
+/* arten, die den text selbst lesen. über tokens (run_tokens) zählt index tokens statt
+ * bytes, sie würden dort rohen text an der falschen stelle lesen. */
+bool
+parser_kind_reads_text(Parser_Kind kind) {
+    switch ( kind ) {
+        case PARSER_KIND_WHITESPACE:
+        case PARSER_KIND_DIGIT:
+        case PARSER_KIND_DIGITS:
+        case PARSER_KIND_LETTERS:
+        case PARSER_KIND_CHR:
+        case PARSER_KIND_STR:
+        case PARSER_KIND_NUMBER:
+        case PARSER_KIND_REGEX:
+        case PARSER_KIND_CAPTURE:
+        case PARSER_KIND_UNSIGNED:
+        case PARSER_KIND_INTEGER:
+        case PARSER_KIND_FLOAT:
+        case PARSER_KIND_LEXEME:
+        case PARSER_KIND_UTF8_CHAR:
+        case PARSER_KIND_UTF8_CLASS:
+        case PARSER_KIND_UTF8_IDENT:
+        case PARSER_KIND_CHR_SET:
+        case PARSER_KIND_CHR_SPAN:
+        case PARSER_KIND_CHR_SPAN1: {
+            return true;
+        }
+
+        default: {
+            return false;
+        }
+    }
+}
+
+#ifdef PARSER_PROFILE
+Parser   * parser_profile_nodes = NULL;
+uint64_t   parser_profile_child = 0;
+
+uint64_t
+parser_profile_now() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec*1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+#define parser_profile_backtrack(p) ((p)->profile.backtracks += 1)
+#else
+#define parser_profile_backtrack(p)
+#endif
+
+#ifdef PARSER_TRACE
+enum Parser_Trace_Flags {
+    PARSER_TRACE_SUCCESS   = 1 << 0,
+    PARSER_TRACE_DISCARDED = 1 << 1, /* aufruf oder ein umgebender aufruf ist gescheitert */
+};
+
+struct Parser_Trace_Record {
+    uint32_t pos;
+    uint32_t end;
+    uint32_t node;
+    uint32_t flags;
+};
+
+/* zeichnet jeden aufruf mit startposition auf. scheitert ein aufruf, werden er und
+ * alle darin gestarteten aufrufe als verworfen markiert. */
+struct Parser_Trace {
+    Parser_Trace_Record * records;
+    size_t                num_records;
+    size_t                cap;
+};
+
+Parser_Trace * parser_trace = NULL;
+
+/* knoten nach ihrer trace_id, die beim ersten aufzeichnen vergeben wird */
+Parser      ** parser_trace_nodes     = NULL;
+uint32_t       parser_trace_num_nodes = 0;
+uint32_t       parser_trace_cap_nodes = 0;
+
+void
+parser_trace_begin(Parser_Trace *trace) {
+    parser_trace = trace;
+}
+
+void
+parser_trace_end() {
+    parser_trace = NULL;
+}
+
+void
+parser_trace_free(Parser_Trace *trace) {
+    if ( parser_trace == trace ) {
+        parser_trace_end();
+    }
+
+    parser_dealloc(trace->records);
+    *trace = {};
+}
+
+uint32_t
+parser_trace_node_id(Parser *p) {
+    if ( p->trace_id ) {
+        return p->trace_id;
+    }
+
+    if ( parser_trace_num_nodes >= parser_trace_cap_nodes ) {
+        uint32_t new_cap = (parser_trace_cap_nodes < 64) ? 64 : parser_trace_cap_nodes*2;
+        void *mem = parser_alloc_tagged(sizeof(Parser *)*new_cap, PARSER_ALLOC_OTHER);
+        memcpy(mem, parser_trace_nodes, sizeof(Parser *)*parser_trace_num_nodes);
+        parser_dealloc(parser_trace_nodes);
+
+        parser_trace_nodes     = (Parser **)mem;
+        parser_trace_cap_nodes = new_cap;
+    }
+
+    parser_trace_nodes[parser_trace_num_nodes++] = p;
+    p->trace_id = parser_trace_num_nodes;
+
+    return p->trace_id;
+}
+
+size_t
+parser_trace_enter(Parser *p, size_t pos) {
+    Parser_Trace *trace = parser_trace;
+
+    if ( trace->num_records >= trace->cap ) {
+        size_t new_cap = (trace->cap < 1024) ? 1024 : trace->cap*2;
+        void *mem = parser_alloc_tagged(sizeof(Parser_Trace_Record)*new_cap, PARSER_ALLOC_OTHER);
+        memcpy(mem, trace->records, sizeof(Parser_Trace_Record)*trace->num_records);
+        parser_dealloc(trace->records);
+
+        trace->records = (Parser_Trace_Record *)mem;
+        trace->cap     = new_cap;
+    }
+
+    Parser_Trace_Record *rec = &trace->records[trace->num_records];
+    rec->pos   = (uint32_t)pos;
+    rec->end   = (uint32_t)pos;
+    rec->node  = parser_trace_node_id(p);
+    rec->flags = 0;
+
+    return trace->num_records++;
+}
+
+void
+parser_trace_leave(size_t mark, Parser_State *result) {
+    Parser_Trace *trace = parser_trace;
+    Parser_Trace_Record *rec = &trace->records[mark];
+
+    if ( result->success ) {
+        rec->end    = (uint32_t)result->index;
+        rec->flags |= PARSER_TRACE_SUCCESS;
+
+        return;
+    }
+
+    for ( size_t i = mark; i < trace->num_records; ++i ) {
+        trace->records[i].flags |= PARSER_TRACE_DISCARDED;
+    }
+}
+
+char *
+parser_trace_label(uint32_t node, char *buf, size_t size) {
+    Parser *p = (node && node <= parser_trace_num_nodes) ? parser_trace_nodes[node-1] : NULL;
+
+    if ( !p ) {
+        snprintf(buf, size, "#%u", node);
+    } else if ( p->name ) {
+        snprintf(buf, size, "%s", p->name);
+    } else {
+        snprintf(buf, size, "%s#%u", parser_kind_name(p->kind), node);
+    }
+
+    return buf;
+}
+
+/* binäres format: "URQT", version, anzahl knoten, anzahl aufzeichnungen, je knoten
+ * art und namenslänge mit namen, danach die aufzeichnungen als Parser_Trace_Record.
+ * bereits freigegebene knoten haben die art 0xffffffff und keinen namen. */
+bool
+parser_trace_write_binary(Parser_Trace *trace, char *path) {
+    FILE *out = fopen(path, "wb");
+    if ( !out ) {
+        return false;
+    }
+
+    uint32_t header[4] = { 0x54515255 /* URQT */, 1, parser_trace_num_nodes, (uint32_t)trace->num_records };
+    fwrite(header, sizeof(header), 1, out);
+
+    for ( uint32_t i = 0; i < parser_trace_num_nodes; ++i ) {
+        Parser *p = parser_trace_nodes[i];
+        uint32_t node[2] = { UINT32_MAX, 0 };
+
+        if ( p ) {
+            node[0] = (uint32_t)p->kind;
+            node[1] = p->name ? (uint32_t)strlen(p->name) : 0;
+        }
+
+        fwrite(node, sizeof(node), 1, out);
+        if ( node[1] ) {
+            fwrite(p->name, node[1], 1, out);
+        }
+    }
+
+    fwrite(trace->records, sizeof(Parser_Trace_Record), trace->num_records, out);
+
+    bool result = !ferror(out);
+    fclose(out);
+
+    return result;
+}
+
+struct Parser_Trace_Entry {
+    uint32_t pos;
+    uint32_t node;
+    uint32_t calls;
+    uint32_t discarded;
+};
+
+/* fasst die aufzeichnungen je (position, knoten) zusammen und gibt die paare mit den
+ * meisten verworfenen aufrufen als csv aus. */
+void
+parser_trace_write_csv(Parser_Trace *trace, FILE *out, size_t max_rows = 50) {
+    fprintf(out, "pos,parser,aufrufe,verworfen\n");
+
+    if ( !trace->num_records ) {
+        return;
+    }
+
+    Parser_Trace_Record *sorted = (Parser_Trace_Record *)parser_alloc_tagged(
+            sizeof(Parser_Trace_Record)*trace->num_records, PARSER_ALLOC_OTHER);
+    memcpy(sorted, trace->records, sizeof(Parser_Trace_Record)*trace->num_records);
+
+    qsort(sorted, trace->num_records, sizeof(Parser_Trace_Record), [](const void *a, const void *b) {
+        Parser_Trace_Record *ra = (Parser_Trace_Record *)a;
+        Parser_Trace_Record *rb = (Parser_Trace_Record *)b;
+
+        if ( ra->pos != rb->pos ) {
+            return (ra->pos < rb->pos) ? -1 : 1;
+        }
+
+        return (ra->node < rb->node) ? -1 : (ra->node > rb->node) ? 1 : 0;
+    });
+
+    Parser_Trace_Entry *entries = (Parser_Trace_Entry *)parser_alloc_tagged(
+            sizeof(Parser_Trace_Entry)*trace->num_records, PARSER_ALLOC_OTHER);
+    size_t num_entries = 0;
+
+    for ( size_t i = 0; i < trace->num_records; ++i ) {
+        Parser_Trace_Record *rec = &sorted[i];
+        Parser_Trace_Entry  *entry = num_entries ? &entries[num_entries-1] : NULL;
+
+        if ( !entry || entry->pos != rec->pos || entry->node != rec->node ) {
+            entry = &entries[num_entries++];
+            *entry = {};
+            entry->pos  = rec->pos;
+            entry->node = rec->node;
+        }
+
+        entry->calls += 1;
+        if ( rec->flags & PARSER_TRACE_DISCARDED ) {
+            entry->discarded += 1;
+        }
+    }
+
+    qsort(entries, num_entries, sizeof(Parser_Trace_Entry), [](const void *a, const void *b) {
+        uint32_t da = ((Parser_Trace_Entry *)a)->discarded;
+        uint32_t db = ((Parser_Trace_Entry *)b)->discarded;
+
+        return (da < db) ? 1 : (da > db) ? -1 : 0;
+    });
+
+    for ( size_t i = 0; i < num_entries && i < max_rows; ++i ) {
+        if ( !entries[i].discarded ) {
+            break;
+        }
+
+        char label[64];
+        fprintf(out, "%u,%s,%u,%u\n", entries[i].pos,
+                parser_trace_label(entries[i].node, label, sizeof(label)),
+                entries[i].calls, entries[i].discarded);
+    }
+
+    parser_dealloc(entries);
+    parser_dealloc(sorted);
+}
+
+/* heatmap je eingabeposition: gestartete und verworfene aufrufe. */
+void
+parser_trace_write_heatmap(Parser_Trace *trace, FILE *out) {
+    fprintf(out, "pos,aufrufe,verworfen\n");
+
+    uint32_t max_pos = 0;
+    for ( size_t i = 0; i < trace->num_records; ++i ) {
+        if ( trace->records[i].pos > max_pos ) {
+            max_pos = trace->records[i].pos;
+        }
+    }
+
+    if ( !trace->num_records ) {
+        return;
+    }
+
+    uint32_t *counts = (uint32_t *)parser_alloc_tagged(sizeof(uint32_t)*2*(max_pos + 1), PARSER_ALLOC_OTHER);
+    memset(counts, 0, sizeof(uint32_t)*2*(max_pos + 1));
+
+    for ( size_t i = 0; i < trace->num_records; ++i ) {
+        Parser_Trace_Record *rec = &trace->records[i];
+
+        counts[2*rec->pos] += 1;
+        if ( rec->flags & PARSER_TRACE_DISCARDED ) {
+            counts[2*rec->pos + 1] += 1;
+        }
+    }
+
+    for ( uint32_t pos = 0; pos <= max_pos; ++pos ) {
+        if ( counts[2*pos] ) {
+            fprintf(out, "%u,%u,%u\n", pos, counts[2*pos], counts[2*pos + 1]);
+        }
+    }
+
+    parser_dealloc(counts);
+}
+#endif
+
+/* voreinstellung für parser_max_depth. eine ebene von parser_call belegt je nach
+ * kombinator und build etwa 0,8 bis 1,2 kb stack, 2048 ebenen bleiben damit unter
+ * 2,5 mb und passen in die üblichen 8 mb eines threads. */
+#ifndef PARSER_DEFAULT_MAX_DEPTH
+#define PARSER_DEFAULT_MAX_DEPTH 2048
+#endif
+
+/* höchste verschachtelungstiefe von parser_call, 0 für unbegrenzt. wird sie
+ * überschritten, scheitert der lauf mit PARSER_FLAG_FATAL, statt den stack zu
+ * sprengen. die tiefe gehört zum stack und wird deshalb je thread gezählt, und
+ * nur solange eine grenze gesetzt ist. */
+size_t parser_max_depth = PARSER_DEFAULT_MAX_DEPTH;
+thread_local size_t parser_depth = 0;
+
+Parser_State
+parser_depth_exceeded(const Parser_State &state) {
+    Parser_State result = parser_update_error(state,
+            "parser: maximale verschachtelungstiefe von %zd überschritten", parser_max_depth);
+    result.flags |= PARSER_FLAG_FATAL | PARSER_FLAG_LIMIT;
+
+    if ( state.ctx && state.ctx->limits ) {
+        state.ctx->limits->exceeded = PARSER_LIMIT_DEPTH;
+    }
+
+    return result;
+}
+
+/* die uhr wird nur alle PARSER_LIMIT_CLOCK_PERIOD schritte gelesen */
+#ifndef PARSER_LIMIT_CLOCK_PERIOD
+#define PARSER_LIMIT_CLOCK_PERIOD 1024
+#endif
+
+uint64_t
+parser_limit_now_us() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    uint64_t result = std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+
+    return result;
+}
+
+/* legt fest, bei welcher schrittzahl parser_call die grenzen das nächste mal prüft */
+void
+parser_limits_schedule(Parser_Limits *limits) {
+    size_t next = SIZE_MAX;
+
+    if ( limits->max_steps ) {
+        next = limits->max_steps + 1;
+    }
+
+    if ( limits->deadline && limits->steps + PARSER_LIMIT_CLOCK_PERIOD < next ) {
+        next = limits->steps + PARSER_LIMIT_CLOCK_PERIOD;
+    }
+
+    limits->next_check = next;
+}
+
+/* setzt die zähler zurück und macht limits zu den grenzen der folgenden aufrufe.
+ * liefert die bisherigen grenzen für parser_limits_end. */
+Parser_Limits *
+parser_limits_begin(Parser_Limits *limits) {
+    Parser_Limits *result = parser_limits;
+
+    if ( limits ) {
+        limits->exceeded = PARSER_LIMIT_NONE;
+        limits->steps    = 0;
+        limits->bytes    = 0;
+        limits->deadline = limits->max_time_us ? parser_limit_now_us() + limits->max_time_us : 0;
+        parser_limits_schedule(limits);
+    }
+
+    parser_limits = limits;
+
+    return result;
+}
+
+void
+parser_limits_end(Parser_Limits *prev) {
+    parser_limits = prev;
+}
+
+/* gibt einem lauf die grenzen des threads mit. läufe ohne grenzen behalten ihren
+ * kontext, sonst bekommt state ctx als kontext. */
+void
+parser_limits_attach(Parser_State *state, Parser_Context *ctx) {
+    if ( !parser_limits ) {
+        return;
+    }
+
+    ctx->limits = parser_limits;
+    state->ctx  = ctx;
+}
+
+/* wird nur aufgerufen, wenn die schrittzahl next_check erreicht hat. liefert die
+ * überschrittene grenze oder PARSER_LIMIT_NONE. eine einmal überschrittene grenze
+ * läßt auch alle weiteren aufrufe scheitern. */
+Parser_Limit
+parser_limits_check(Parser_Limits *limits) {
+    if ( limits->exceeded ) {
+        return limits->exceeded;
+    }
+
+    Parser_Limit result = PARSER_LIMIT_NONE;
+
+    if ( limits->max_steps && limits->steps > limits->max_steps ) {
+        result = PARSER_LIMIT_STEPS;
+    } else if ( limits->max_bytes && limits->bytes > limits->max_bytes ) {
+        result = PARSER_LIMIT_MEMORY;
+    } else if ( limits->deadline && parser_limit_now_us() >= limits->deadline ) {
+        result = PARSER_LIMIT_TIME;
+    }
+
+    if ( result ) {
+        limits->exceeded   = result;
+        limits->next_check = 0;
+    } else {
+        parser_limits_schedule(limits);
+    }
+
+    return result;
+}
+
+Parser_State
+parser_limit_exceeded(const Parser_State &state, Parser_Limits *limits) {
+    Parser_State result;
+
+    switch ( limits->exceeded ) {
+        case PARSER_LIMIT_STEPS: {
+            result = parser_update_error(state,
+                    "parser: höchstzahl von %zd schritten überschritten", limits->max_steps);
+        } break;
+
+        case PARSER_LIMIT_MEMORY: {
+            result = parser_update_error(state,
+                    "parser: speichergrenze von %zd bytes überschritten", limits->max_bytes);
+        } break;
+
+        case PARSER_LIMIT_TIME: {
+            result = parser_update_error(state,
+                    "parser: zeitgrenze von %llu mikrosekunden überschritten",
+                    (unsigned long long)limits->max_time_us);
+        } break;
+
+        default: {
+            result = parser_depth_exceeded(state);
+        } break;
+    }
+
+    result.flags |= PARSER_FLAG_FATAL | PARSER_FLAG_LIMIT;
+
+    return result;
+}
+
+/* alle kombinatoren rufen ihre unterparser über diese funktion auf. */
+Parser_State
+parser_call(Parser *p, const Parser_State &state) {
+    size_t max_depth = parser_max_depth;
+    if ( max_depth && parser_depth >= max_depth ) {
+        return parser_depth_exceeded(state);
+    }
+
+    Parser_Limits *limits = NULL;
+
+    if ( state.ctx ) {
+        if ( state.ctx->tokens && parser_kind_reads_text(p->kind) ) {
+            Parser_State result = parser_update_error(state,
+                    "%s: liest zeichen und läßt sich nicht auf tokens anwenden", parser_kind_name(p->kind));
+            result.flags |= PARSER_FLAG_FATAL;
+
+            return result;
+        }
+
+        limits = state.ctx->limits;
+    }
+
+    /* im normalfall kostet das nur einen zähler und einen vergleich */
+    if ( limits && ++limits->steps >= limits->next_check ) {
+        if ( parser_limits_check(limits) ) {
+            return parser_limit_exceeded(state, limits);
+        }
+    }
+
+    if ( max_depth ) {
+        parser_depth += 1;
+    }
+
+#ifdef PARSER_ALLOC_STATS
+    Parser *saved_node = parser_alloc_node;
+    parser_alloc_node = p;
+#endif
+
+#ifdef PARSER_TRACE
+    size_t trace_mark = parser_trace ? parser_trace_enter(p, state.index) : 0;
+#endif
+
+#ifdef PARSER_PROFILE
+    Parser_Profile *prof = &p->profile;
+
+    if ( !prof->registered ) {
+        prof->registered = true;
+        prof->next = parser_profile_nodes;
+        parser_profile_nodes = p;
+    }
+
+    uint64_t saved_child = parser_profile_child;
+    parser_profile_child = 0;
+    prof->active += 1;
+
+    uint64_t start = parser_profile_now();
+    Parser_State result = p->proc(p, state);
+    uint64_t elapsed = parser_profile_now() - start;
+
+    prof->active -= 1;
+    prof->calls  += 1;
+    prof->time_excl += elapsed - parser_profile_child;
+
+    /* bei rekursion zählt nur der äußerste aufruf zur inklusiven zeit */
+    if ( prof->active == 0 ) {
+        prof->time_incl += elapsed;
+    }
+
+    if ( result.success ) {
+        prof->successes += 1;
+        prof->bytes     += result.index - state.index;
+    } else {
+        prof->failures  += 1;
+    }
+
+    parser_profile_child = saved_child + elapsed;
+#else
+    Parser_State result = p->proc(p, state);
+#endif
+
+#ifdef PARSER_ALLOC_STATS
+    parser_alloc_node = saved_node;
+#endif
+
+#ifdef PARSER_TRACE
+    if ( parser_trace ) {
+        parser_trace_leave(trace_mark, &result);
+    }
+#endif
+
+    /* wer an index endet, hat das byte dort angesehen */
+    if ( state.ctx ) {
+        parser_examined(state, result.index + 1);
+    }
+
+    if ( max_depth ) {
+        parser_depth -= 1;
+    }
+
+    return result;
+}
+
+#ifdef PARSER_PROFILE
+void
+parser_profile_reset() {
+    Parser *p = parser_profile_nodes;
+    while ( p ) {
+        Parser *next = p->profile.next;
+        p->profile = {};
+        p = next;
+    }
+
+    parser_profile_nodes = NULL;
+}
+
+/* gibt die aufgerufenen knoten absteigend nach ihrer exklusiven zeit aus. */
+void
+parser_profile_dump(FILE *out = stdout, size_t max_rows = 20) {
+    size_t num_nodes = 0;
+    for ( Parser *p = parser_profile_nodes; p; p = p->profile.next ) {
+        num_nodes++;
+    }
+
+    if ( !num_nodes ) {
+        return;
+    }
+
+    Parser **nodes = (Parser **)parser_alloc(sizeof(Parser *)*num_nodes);
+    size_t i = 0;
+    for ( Parser *p = parser_profile_nodes; p; p = p->profile.next ) {
+        nodes[i++] = p;
+    }
+
+    qsort(nodes, num_nodes, sizeof(Parser *), [](const void *a, const void *b) {
+        uint64_t ta = (*(Parser **)a)->profile.time_excl;
+        uint64_t tb = (*(Parser **)b)->profile.time_excl;
+
+        return (ta < tb) ? 1 : (ta > tb) ? -1 : 0;
+    });
+
+    fprintf(out, "%-24s %10s %10s %10s %10s %12s %14s %14s\n",
+            "parser", "aufrufe", "erfolge", "fehler", "backtracks", "bytes", "zeit inkl", "zeit exkl");
+
+    for ( i = 0; i < num_nodes && i < max_rows; ++i ) {
+        Parser *p = nodes[i];
+        Parser_Profile *prof = &p->profile;
+
+        char label[64];
+        if ( p->name ) {
+            snprintf(label, sizeof(label), "%s", p->name);
+        } else {
+            snprintf(label, sizeof(label), "%s@%p", parser_kind_name(p->kind), (void *)p);
+        }
+
+        fprintf(out, "%-24s %10llu %10llu %10llu %10llu %12llu %14llu %14llu\n", label,
+                (unsigned long long)prof->calls, (unsigned long long)prof->successes,
+                (unsigned long long)prof->failures, (unsigned long long)prof->backtracks,
+                (unsigned long long)prof->bytes, (unsigned long long)prof->time_incl,
+                (unsigned long long)prof->time_excl);
+    }
+
+    parser_dealloc(nodes);
+}
+#endif
+
+#ifdef PARSER_ALLOC_STATS
+char *
+parser_alloc_category_name(Parser_Alloc_Category category) {
+    switch ( category ) {
+        case PARSER_ALLOC_OTHER:       return "sonstiges";
+        case PARSER_ALLOC_RESULT_LIST: return "ergebnisliste";
+        case PARSER_ALLOC_ERROR_MSG:   return "fehlermeldung";
+        case PARSER_ALLOC_REGEX_COPY:  return "regex-kopie";
+        case PARSER_ALLOC_GRAMMAR:     return "grammatik";
+        case PARSER_ALLOC_TOKENS:      return "tokenliste";
+        case PARSER_ALLOC_VALUES:      return "werte";
+        default: break;
+    }
+
+    return "?";
+}
+
+uint64_t
+parser_alloc_stats_total(Parser_Alloc_Stats *stats) {
+    uint64_t result = 0;
+
+    for ( int i = 0; i < PARSER_ALLOC_NUM_CATEGORIES; ++i ) {
+        result += stats->bytes[i];
+    }
+
+    return result;
+}
+
+void
+parser_alloc_stats_reset() {
+    Parser *p = parser_alloc_nodes;
+    while ( p ) {
+        Parser *next = p->alloc_stats.next;
+        p->alloc_stats = {};
+        p = next;
+    }
+
+    parser_alloc_nodes = NULL;
+    parser_alloc_unattributed = {};
+}
+
+void
+parser_alloc_stats_print_row(FILE *out, char *label, Parser_Alloc_Stats *stats) {
+    for ( int i = 0; i < PARSER_ALLOC_NUM_CATEGORIES; ++i ) {
+        if ( !stats->count[i] ) {
+            continue;
+        }
+
+        fprintf(out, "%-24s %-14s %10llu %12llu\n", label,
+                parser_alloc_category_name((Parser_Alloc_Category)i),
+                (unsigned long long)stats->count[i], (unsigned long long)stats->bytes[i]);
+    }
+}
+
+/* gibt die allokationen je knoten und kategorie aus, absteigend nach bytes. */
+void
+parser_alloc_stats_dump(FILE *out = stdout) {
+    size_t num_nodes = 0;
+    for ( Parser *p = parser_alloc_nodes; p; p = p->alloc_stats.next ) {
+        num_nodes++;
+    }
+
+    fprintf(out, "%-24s %-14s %10s %12s\n", "parser", "kategorie", "anzahl", "bytes");
+
+    if ( num_nodes ) {
+        Parser **nodes = (Parser **)parser_alloc(sizeof(Parser *)*num_nodes);
+        size_t i = 0;
+        for ( Parser *p = parser_alloc_nodes; p; p = p->alloc_stats.next ) {
+            nodes[i++] = p;
+        }
+
+        qsort(nodes, num_nodes, sizeof(Parser *), [](const void *a, const void *b) {
+            uint64_t ba = parser_alloc_stats_total(&(*(Parser **)a)->alloc_stats);
+            uint64_t bb = parser_alloc_stats_total(&(*(Parser **)b)->alloc_stats);
+
+            return (ba < bb) ? 1 : (ba > bb) ? -1 : 0;
+        });
+
+        for ( i = 0; i < num_nodes; ++i ) {
+            Parser *p = nodes[i];
+
+            char label[64];
+            if ( p->name ) {
+                snprintf(label, sizeof(label), "%s", p->name);
+            } else {
+                snprintf(label, sizeof(label), "%s@%p", parser_kind_name(p->kind), (void *)p);
+            }
+
+            parser_alloc_stats_print_row(out, label, &p->alloc_stats);
+        }
+
+        parser_dealloc(nodes);
+    }
+
+    parser_alloc_stats_print_row(out, "(ohne knoten)", &parser_alloc_unattributed);
+}
+#endif
+
+/* entfernt die knoten, für die owns zutrifft, aus den listen der instrumentierung,
+ * bevor grammar_free oder grammar_unload sie freigibt. */
+void
+parser_forget_nodes(Parser_Owns *owns, void *owner) {
+#ifdef PARSER_PROFILE
+    Parser **link = &parser_profile_nodes;
+    while ( *link ) {
+        if ( owns(owner, *link) ) {
+            *link = (*link)->profile.next;
+        } else {
+            link = &(*link)->profile.next;
+        }
+    }
+#endif
+
+#ifdef PARSER_ALLOC_STATS
+    Parser **alloc_link = &parser_alloc_nodes;
+    while ( *alloc_link ) {
+        if ( owns(owner, *alloc_link) ) {
+            *alloc_link = (*alloc_link)->alloc_stats.next;
+        } else {
+            alloc_link = &(*alloc_link)->alloc_stats.next;
+        }
+    }
+#endif
+
+#ifdef PARSER_TRACE
+    /* die ids bleiben gültig, aufzeichnungen nennen den knoten dann nur noch mit id */
+    for ( uint32_t i = 0; i < parser_trace_num_nodes; ++i ) {
+        if ( parser_trace_nodes[i] && owns(owner, parser_trace_nodes[i]) ) {
+            parser_trace_nodes[i] = NULL;
+        }
+    }
+#endif
+}
+
+Parser *Whitespace = parser_create(
+    [](Parser *p, const Parser_State &state) {
+        char *s = state.val+state.index;
+        while ( *s == ' ' || *s == '\t' || *s == '\r' || *s == '\v' || *s == '\n' ) {
+            s++;
+        }
+
+        return parser_update_state(state, s-state.val, parser_result_str(state.val+state.index, s-(state.val+state.index)));
+    },
+    PARSER_KIND_WHITESPACE
+);
+
+Parser *Digit = parser_create(
+    [](Parser *p, const Parser_State &state) {
+        char *s = state.val+state.index;
+
+        if ( !s || !*s ) {
+            return parser_update_error(state, "Digit: ende der eingabe erreicht");
+        }
+
+        if ( s[0] < '0' || s[0] > '9' ) {
+            return parser_update_error(state, "Digit: keine ziffer gefunden");
+        }
+
+        return parser_update_state(state, state.index + 1, parser_result_str(s, 1));
+    },
+    PARSER_KIND_DIGIT
+);
+
+Parser *Digits = parser_create(
+    [](Parser *p, const Parser_State &state) {
+        char *s = state.val+state.index;
+
+        if ( !s || !*s ) {
+            return parser_update_error(state, "digits: ende der eingabe erreicht");
+        }
+
+        while ( *s >= '0' && *s <= '9' ) {
+            s++;
+        }
+
+        if (s == (state.val+state.index)) {
+            return parser_update_error(state, "digits: keine ziffern gefunden");
+        }
+
+        return parser_update_state(state, s-state.val, parser_result_str(state.val+state.index, s-(state.val+state.index)));
+    },
+    PARSER_KIND_DIGITS
+);
+
+Parser *Letters = parser_create(
+    [](Parser *p, const Parser_State &state) {
+        char *s = state.val+state.index;
+
+        if ( !s || !*s ) {
+            return parser_update_error(state, "letters: ende der eingabe erreicht");
+        }
+
+        while ( *s >= 'A' && *s <= 'Z' || *s >= 'a' && *s <= 'z' ) {
+            s++;
+        }
+
+        if (s == state.val+state.index) {
+            return parser_update_error(state, "letters: keine buchstaben gefunden");
+        }
+
+        return parser_update_state(state, s-state.val,
+                parser_result_str(state.val+state.index, s-(state.val+state.index)));
+    },
+    PARSER_KIND_LETTERS
+);
+
+Parser_Result
+parser_result_none() {
+    Parser_Result result = {};
+
+    result.kind = PARSER_RESULT_NONE;
+
+    return result;
+}
+
+Parser_Result
+parser_result_chr(char c) {
+    Parser_Result result = {};
+
+    result.kind = PARSER_RESULT_CHR;
+    result.chr.val = c;
+
+    return result;
+}
+
+Parser_Result
+parser_result_str(char *str, size_t len) {
+    Parser_Result result = {};
+
+    result.kind = PARSER_RESULT_STR;
+    result.str.val = str;
+    result.str.len = len;
+
+    return result;
+}
+
+Parser_Result
+parser_result_u64(uint64_t val) {
+    Parser_Result result = {};
+
+    result.kind = PARSER_RESULT_U64;
+    result.u64.val = val;
+
+    return result;
+}
+
+Parser_Result
+parser_result_s64(int64_t val) {
+    Parser_Result result = {};
+
+    result.kind = PARSER_RESULT_S64;
+    result.s64.val = val;
+
+    return result;
+}
+
+Parser_Result
+parser_result_f64(double val) {
+    Parser_Result result = {};
+
+    result.kind = PARSER_RESULT_F64;
+    result.f64.val = val;
+
+    return result;
+}
+
+Parser_Result
+parser_result_arr(Parser_Result_List arr) {
+    Parser_Result result = {};
+
+    result.kind = PARSER_RESULT_ARR;
+    result.arr.val = arr;
+    result.arr.len = arr.num_elems;
+
+    return result;
+}
+
+Parser_Result
+parser_result_custom(void *val) {
+    Parser_Result result = {};
+
+    result.kind = PARSER_RESULT_CUSTOM;
+    result.custom.val = val;
+
+    return result;
+}
+
+Parser_State
+parser_update_state(const Parser_State &in, size_t index, Parser_Result r) {
+    Parser_State result;
+
+    result.index   = index;
+    result.result  = r;
+    result.val     = in.val;
+    result.msg     = NULL;
+    result.ctx     = in.ctx;
+    result.flags   = in.flags;
+    result.success = true;
+
+    parser_event_emit(&result, PARSER_EVENT_VALUE, NULL, r);
+
+    return result;
+}
+
+Parser_State
+parser_update_result(const Parser_State &in, Parser_Result r) {
+    Parser_State result;
+
+    result.index   = in.index;
+    result.result  = r;
+    result.val     = in.val;
+    result.msg     = NULL;
+    result.ctx     = in.ctx;
+    result.flags   = in.flags;
+    result.success = true;
+
+    return result;
+}
+
+Parser_State
+parser_update_error(const Parser_State &in, char *fmt, ...) {
+    Parser_State result = {};
+
+    result.success = false;
+    result.val     = in.val;
+    result.index   = in.index;
+    result.result  = in.result;
+    result.flags   = in.flags;
+    result.ctx     = in.ctx;
+
+    /* im erkennungsmodus interessiert nur ob geparst werden konnte, die unformatierte
+     * meldung genügt dann und es wird kein speicher reserviert. */
+    if ( in.flags & PARSER_FLAG_NO_MESSAGES ) {
+        result.msg = fmt;
+
+        return result;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    int size = 1 + vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+
+    char *msg = (char *)parser_alloc_tagged(size, PARSER_ALLOC_ERROR_MSG);
+
+    va_start(args, fmt);
+    vsnprintf(msg, size, fmt, args);
+    va_end(args);
+
+    result.msg     = msg;
+
+    return result;
+}
+
+Parser *
+Fail(char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int size = 1 + vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+
+    char *msg = (char *)grammar_alloc(size);
+
+    va_start(args, fmt);
+    vsnprintf(msg, size, fmt, args);
+    va_end(args);
+
+    auto result = parser_create([](Parser *p, const Parser_State &state) {
+        return parser_update_error(state, p->msg);
+    }, PARSER_KIND_FAIL);
+
+    result->msg = msg;
+
+    return result;
+}
+
+Parser *
+Succeed(Parser_Result val) {
+    auto result = parser_create([](Parser *p, const Parser_State &state) {
+        return parser_update_result(state, p->val);
+    }, PARSER_KIND_SUCCEED);
+
+    result->val = val;
+
+    return result;
+}
+
+Parser *
+Chr(char c) {
+    Parser *p = parser_create([](Parser *p, const Parser_State &state) {
+        if ( !state.success ) {
+            return state;
+        }
+
+        Parser_State result = {};
+
+        if ( state.val[state.index] == p->str[0] ) {
+            return parser_update_state(state, state.index + 1, parser_result_chr(p->str[0]));
+        }
+
+        return parser_update_error(state, "chr: das gesuchte zeichen wurde nicht gefunden");
+    }, PARSER_KIND_CHR);
+
+    p->n[0] = c;
+    p->str  = p->n;
+
+    return p;
+}
+
+Parser *
+Str(char *str) {
+    Parser *p = parser_create([](Parser *p, const Parser_State &state) {
+        if ( !state.success ) {
+            return state;
+        }
+
+        size_t len = p->num;
+        char *s = state.val+state.index;
+
+        bool string_found = true;
+        for ( int i = 0; i < len; ++i ) {
+            if ( s[i] == '\0' ) {
+                parser_examined(state, state.index + i + 1);
+                return parser_update_error(state, "str: unerwartet das ende erreicht");
+            }
+
+            if ( s[i] != p->str[i] ) {
+                parser_examined(state, state.index + i + 1);
+                string_found = false;
+                break;
+            }
+        }
+
+        if ( string_found ) {
+            return parser_update_state(state, state.index + len,
+                    parser_result_str(state.val+state.index, len));
+        }
+
+        return parser_update_error(state, "str: die gesuchte zeichenkette wurde nicht gefunden");
+    }, PARSER_KIND_STR);
+
+    p->str  = str;
+    p->num  = (int)strlen(str);
+
+    return p;
+}
+
+Parser *
+Number(int n) {
+    Parser *p = parser_create([](Parser *p, const Parser_State &state) {
+        if ( !state.success ) {
+            return state;
+        }
+
+        size_t len = strlen(p->n);
+
+        for ( int i = 0; i < len; ++i ) {
+            if ( (state.val+state.index)[i] == '\0' ) {
+                parser_examined(state, state.index + i + 1);
+                return parser_update_error(state, "number: unerwartet das ende erreicht");
+            }
+
+            if ( p->n[i] != (state.val+state.index)[i] ) {
+                parser_examined(state, state.index + i + 1);
+                return parser_update_error(state, "number: nummer wurde nicht erkannt");
+            }
+        }
+
+        return parser_update_state(state, state.index+len, parser_result_str(p->n, len));
+    }, PARSER_KIND_NUMBER);
+
+    int count = 0;
+    int cnd = 0;
+    int temp = 0;
+    int i;
+
+    if ( n >> 31 ) {
+        n = ~n + 1;
+        for(temp = n; temp != 0; temp /= 10, count++);
+        p->n[0] = 0x2D;
+        count++;
+        cnd = 1;
+    } else {
+        for(temp = n; temp != 0; temp /= 10, count++);
+    }
+
+    for(i = count-1, temp = n; i >= cnd; i--) {
+        p->n[i] = (temp % 10) + 0x30;
+        temp /= 10;
+    }
+
+    return p;
+}
+
+/* wert einer ziffer zur basis 36, 36 für alles andere */
+uint32_t
+parser_digit_value(char c) {
+    if ( c >= '0' && c <= '9' ) return c - '0';
+    if ( c >= 'a' && c <= 'z' ) return c - 'a' + 10;
+    if ( c >= 'A' && c <= 'Z' ) return c - 'A' + 10;
+
+    return 36;
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define PARSER_SWAR 0
+#else
+#define PARSER_SWAR 1
+#endif
+
+/* das lesen über das nullbyte hinaus ist beabsichtigt und bleibt auf der seite */
+#if defined(__GNUC__) || defined(__clang__)
+#define PARSER_NO_SANITIZE __attribute__((no_sanitize_address))
+#else
+#define PARSER_NO_SANITIZE
+#endif
+
+/* prüft ob die acht bytes ab s ziffern sind und liefert sie in *out als zahl. die bytes
+ * werden nur am stück gelesen, wenn sie auf derselben speicherseite wie s liegen, sonst
+ * könnte das lesen hinter dem nullbyte fehlschlagen. */
+PARSER_NO_SANITIZE bool
+parser_eight_digits(char *s, uint32_t *out) {
+#if PARSER_SWAR
+    if ( ((uintptr_t)s & 4095) > 4096 - 8 ) {
+        return false;
+    }
+
+    uint64_t val;
+    memcpy(&val, s, 8);
+
+    if ( (((val & 0xF0F0F0F0F0F0F0F0ull) |
+           (((val + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) != 0x3333333333333333ull) )
+    {
+        return false;
+    }
+
+    val -= 0x3030303030303030ull;
+    val  = (val * 10) + (val >> 8);
+    val  = (((val & 0x000000FF000000FFull) * 0x000F424000000064ull) +
+            (((val >> 16) & 0x000000FF000000FFull) * 0x0000271000000001ull)) >> 32;
+
+    *out = (uint32_t)val;
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+/* liest eine vorzeichenlose zahl zur basis base ab s. liefert die zahl der gelesenen
+ * zeichen, 0 wenn keine ziffer gefunden wurde. bei überlauf wird *overflow gesetzt. */
+size_t
+parser_scan_unsigned(char *s, uint32_t base, uint64_t *out, bool *overflow) {
+    char *start = s;
+    uint64_t result = 0;
+    *overflow = false;
+
+    if ( base == 10 ) {
+        uint32_t chunk;
+
+        while ( parser_eight_digits(s, &chunk) ) {
+            if ( result > (UINT64_MAX - chunk) / 100000000ull ) {
+                *overflow = true;
+            }
+
+            result = result*100000000ull + chunk;
+            s += 8;
+        }
+    }
+
+    for ( ;; ) {
+        uint32_t digit = parser_digit_value(*s);
+        if ( digit >= base ) {
+            break;
+        }
+
+        if ( result > (UINT64_MAX - digit) / base ) {
+            *overflow = true;
+        }
+
+        result = result*base + digit;
+        s += 1;
+    }
+
+    *out = result;
+
+    return s - start;
+}
+
+/* vorzeichenlose ganzzahl zur basis base (2 bis 36), ergebnis als u64. */
+Parser *
+Unsigned(int base = 10) {
+    if ( base < 2 || base > 36 ) {
+        return Fail("Unsigned: die basis muß zwischen 2 und 36 liegen");
+    }
+
+    Parser *p = parser_create([](Parser *p, const Parser_State &state) {
+        if ( !state.success ) {
+            return state;
+        }
+
+        uint64_t val = 0;
+        bool overflow = false;
+        size_t len = parser_scan_unsigned(state.val + state.index, p->num, &val, &overflow);
+
+        if ( len == 0 ) {
+            return parser_update_error(state, "Unsigned: keine ziffern gefunden");
+        }
+
+        if ( overflow ) {
+            parser_examined(state, state.index + len + 1);
+            return parser_update_error(state, "Unsigned: die zahl ist zu groß für 64 bit");
+        }
+
+        return parser_update_state(state, state.index + len, parser_result_u64(val));
+    }, PARSER_KIND_UNSIGNED);
+
+    p->num = base;
+
+    return p;
+}
+
+/* ganzzahl mit optionalem vorzeichen zur basis base (2 bis 36), ergebnis als s64. */
+Parser *
+Integer(int base = 10) {
+    if ( base < 2 || base > 36 ) {
+        return Fail("Integer: die basis muß zwischen 2 und 36 liegen");
+    }
+
+    Parser *p = parser_create([](Parser *p, const Parser_State &state) {
+        if ( !state.success ) {
+            return state;
+        }
+
+        char *s = state.val + state.index;
+        bool negative = false;
+
+        if ( *s == '-' || *s == '+' ) {
+            negative = (*s == '-');
+            s += 1;
+        }
+
+        uint64_t val = 0;
+        bool overflow = false;
+        size_t len = parser_scan_unsigned(s, p->num, &val, &overflow);
+        parser_examined(state, (s + len + 1) - state.val);
+
+        if ( len == 0 ) {
+            return parser_update_error(state, "Integer: keine ziffern gefunden");
+        }
+
+        uint64_t limit = negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
+        if ( overflow || val > limit ) {
+            return parser_update_error(state, "Integer: die zahl paßt nicht in 64 bit");
+        }
+
+        int64_t result = negative ? (int64_t)(0 - val) : (int64_t)val;
+
+        return parser_update_state(state, (s + len) - state.val, parser_result_s64(result));
+    }, PARSER_KIND_INTEGER);
+
+    p->num = base;
+
+    return p;
+}
+
+/* exakt darstellbare zehnerpotenzen für den schnellen weg nach clinger */
+double parser_pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+/* gleitkommazahl der form [+-]ziffern[.ziffern][(e|E)[+-]ziffern], ergebnis als f64.
+ * solange die mantisse in 53 bit und der exponent in 10^22 paßt, ist eine einzige
+ * multiplikation oder division korrekt gerundet. alle anderen zahlen gehen an strtod. */
+Parser *
+Float() {
+    Parser *p = parser_create([](Parser *p, const Parser_State &state) {
+        if ( !state.success ) {
+            return state;
+        }
+
+        char *start = state.val + state.index;
+        char *s = start;
+        bool negative = false;
+
+        if ( *s == '-' || *s == '+' ) {
+            negative = (*s == '-');
+            s += 1;
+        }
+
+        uint64_t mantissa = 0;
+        int64_t  exponent = 0;
+        size_t   num_digits = 0;
+        bool     truncated = false;
+
+        while ( *s >= '0' && *s <= '9' ) {
+            if ( mantissa < 1000000000000000000ull ) {
+                mantissa = mantissa*10 + (*s - '0');
+            } else {
+                exponent += 1;
+                truncated |= (*s != '0');
+            }
+
+            num_digits += 1;
+            s += 1;
+        }
+
+        if ( *s == '.' && s[1] >= '0' && s[1] <= '9' ) {
+            s += 1;
+
+            while ( *s >= '0' && *s <= '9' ) {
+                if ( mantissa < 1000000000000000000ull ) {
+                    mantissa = mantissa*10 + (*s - '0');
+                    exponent -= 1;
+                } else {
+                    truncated |= (*s != '0');
+                }
+
+                num_digits += 1;
+                s += 1;
+            }
+        }
+
+        /* hinter den ziffern wurde noch auf '.' und die ziffer danach geschaut */
+        parser_examined(state, (s + 2) - state.val);
+
+        if ( num_digits == 0 ) {
+            return parser_update_error(state, "Float: keine ziffern gefunden");
+        }
+
+        if ( *s == 'e' || *s == 'E' ) {
+            char *e = s + 1;
+            bool exp_negative = false;
+
+            if ( *e == '-' || *e == '+' ) {
+                exp_negative = (*e == '-');
+                e += 1;
+            }
+
+            if ( *e >= '0' && *e <= '9' ) {
+                int64_t exp_value = 0;
+
+                while ( *e >= '0' && *e <= '9' ) {
+                    if ( exp_value < 100000 ) {
+                        exp_value = exp_value*10 + (*e - '0');
+                    }
+
+                    e += 1;
+                }
+
+                exponent += exp_negative ? -exp_value : exp_value;
+                s = e;
+            }
+
+            parser_examined(state, (e + 1) - state.val);
+        }
+
+        size_t len = s - start;
+
+        /* die umwandlung entfällt nur, wenn weder ergebnis noch ereignis den wert braucht */
+        if ( (state.flags & PARSER_FLAG_NO_CAPTURE) && !parser_event_active(&state) ) {
+            return parser_update_state(state, state.index + len, parser_result_none());
+        }
+
+        double result;
+
+        if ( !truncated && mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22 ) {
+            result = (double)mantissa;
+            result = (exponent < 0) ? result / parser_pow10[-exponent] : result * parser_pow10[exponent];
+            result = negative ? -result : result;
+        } else {
+            /* strtod würde auch hexzahlen und inf lesen, daher nur den erkannten text */
+            char buf[64];
+            char *copy = (len < sizeof(buf)) ? buf : (char *)parser_alloc(len + 1);
+            memcpy(copy, start, len);
+            copy[len] = '\0';
+
+            result = strtod(copy, NULL);
+
+            if ( copy != buf ) {
+                parser_dealloc(copy);
+            }
+        }
+
+        return parser_update_state(state, state.index + len, parser_result_f64(result));
+    }, PARSER_KIND_FLOAT);
+
+    return p;
+}
+
+Parser *
+Seq_Of(Parser_List sequence) {
+    Parser *p = parser_create([](Parser *p, const Parser_State &state) {
+        if ( !state.success ) {
+            return state;
+        }
+
+        bool capture = !(state.flags & PARSER_FLAG_NO_CAPTURE);
+
+        /* ohne capture bleibt der puffer leer und damit ohne speicher */
+        Parser_State new_state = state;
+        Parser_Result_Buffer results;
+        parser_result_buffer_init(&results, capture ? p->sequence.num_elems : 0);
+        parser_event_emit(&state, PARSER_EVENT_BEGIN_NODE, p, parser_result_none());
+
+        for ( int i = 0; i < p->sequence.num_elems; ++i ) {
+            Parser *seq_p = parser_entry(&p->sequence, i);
+            new_state = parser_call(seq_p, new_state);
+
+            if ( !new_state.success ) {
+                parser_result_buffer_free(&results);
+                parser_event_emit(&state, PARSER_EVENT_END_NODE, p, parser_result_none());
+                return new_state;
+            }
+
+            if ( capture ) {
+                parser_result_buffer_push(&results, new_state.result);
+            }
+        }
+
+        parser_event_emit(&state, PARSER_EVENT_END_NODE, p, parser_result_none());
+
+        if ( !capture ) {
+            return parser_update_result(new_state, parser_result_none());
+        }
+
+        return parser_update_result(new_state, parser_result_arr(parser_result_buffer_list(&results)));
+    }, PARSER_KIND_SEQ_OF);
+
+    p->sequence  = sequence;
+
+    return p;
+}
+
+Parser *
+Seq_Of(std::initializer_list<Parser *> s) {
+    Parser_List sequence = {};
+    parser_list_reserve(&sequence, s.size());
+
+    for ( Parser *i : s ) {
+        parser_push(&sequence, i);
+    }
+
+    return Seq_Of(sequence);
+}
+
+Parser *
+Choice(std::initializer_list<Parser *> s) {
+    Parser_List sequence = {};
+    parser_list_reserve(&sequence, s.size());
+
+    for ( Parser *i : s ) {
+        parser_push(&sequence, i);
+    }
+
+    Parser *p = parser_create([](Parser *p, const Parser_State &state) {
+        if ( !state.success ) {
+            return state;
+        }
+
+        Parser_State result = state;
+        Parser_State alt_state = state;
+        uint32_t outer_cut = parser_cut_enter(&alt_state);
+
+        for ( int i = 0; i < p->sequence.num_elems; ++i ) {
+            Parser *seq_p = parser_entry(&p->sequence, i);
+
+            size_t mark = parser_event_try(&state);
+            Parser_State new_state = parser_call(seq_p, alt_state);
+            parser_event_end_try(&state, mark, new_state.success);
+
+            if ( new_state.success ) {
+                parser_cut_leave(&new_state, outer_cut);
+                return new_state;
+            }
+
+            parser_profile_backtrack(seq_p);
+
+            result = new_state;
+
+            /* nach einem cut oder abbruch kommen die übrigen alternativen nicht mehr in
+             * frage */
+            if ( parser_committed(&new_state) ) {
+                break;
+            }
+        }
+
+        parser_cut_leave(&result, outer_cut);
+
+        return result;
+    }, PARSER_KIND_CHOICE);
+
+    p->sequence  = sequence;
+
+    return p;
+}
+
+/* 256 bit, ein bit je byte */
+struct Parser_Chr_Set {
+    uint32_t bits[8];
+    bool     result_str;  /* Digit liefert str statt chr */
+};
+
+bool
+parser_chr_set_has(Parser_Chr_Set *set, uint8_t c) {
+    bool result = (set->bits[c >> 5] >> (c & 31)) & 1;
+
+    return result;
+}
+
+void
+parser_chr_set_add(Parser_Chr_Set *set, uint8_t c) {
+    set->bits[c >> 5] |= 1u << (c & 31);
+}
+
+void
+parser_chr_set_add_range(Parser_Chr_Set *set, uint8_t from, uint8_t to) {
+    for ( uint32_t c = from; c <= to; ++c ) {
+        parser_chr_set_add(set, (uint8_t)c);
+    }
+}
+
+/* die bytes, mit denen ein treffer von p beginnen kann. false, wenn p auch leer passen
+ * kann oder sich das nicht feststellen läßt. */
+bool
+parser_first_set(Parser *p, Parser_Chr_Set *out, int depth = 0) {
+    if ( !p || depth > 32 ) {
+        return false;
+    }
+
+    switch ( p->kind ) {
+        case PARSER_KIND_CHR: {
+            if ( !p->str[0] ) {
+                return false;
+            }
+
+            parser_chr_set_add(out, (uint8_t)p->str[0]);
+        } break;
+
+        case PARSER_KIND_STR: {
+            if ( p->num < 1 ) {
+                return false;
+            }
+
+            parser_chr_set_add(out, (uint8_t)p->str[0]);
+        } break;
+
+        case PARSER_KIND_DIGIT:
+        case PARSER_KIND_DIGITS: {
+            parser_chr_set_add_range(out, '0', '9');
+        } break;
+
+        case PARSER_KIND_LETTERS: {
+            parser_chr_set_add_range(out, 'a', 'z');
+            parser_chr_set_add_range(out, 'A', 'Z');
+        } break;
+
+        case PARSER_KIND_UNSIGNED:
+        case PARSER_KIND_INTEGER: {
+            for ( int c = 1; c < 256; ++c ) {
+                if ( parser_digit_value((char)c) < (uint32_t)p->num ) {
+                    parser_chr_set_add(out, (uint8_t)c);
+                }
+            }
+
+            if ( p->kind == PARSER_KIND_INTEGER ) {
+                parser_chr_set_add(out, '+');
+                parser_chr_set_add(out, '-');
+            }
+        } break;
+
+        case PARSER_KIND_CHR_SET:
+        case PARSER_KIND_CHR_SPAN1: {
+            Parser_Chr_Set *set = (Parser_Chr_Set *)p->user_data;
+
+            for ( int i = 0; i < 8; ++i ) {
+                out->bits[i] |= set->bits[i];
+            }
+        } break;
+
+        case PARSER_KIND_SEQ_OF: {
+            return p->sequence.num_elems > 0 && parser_first_set(p->sequence.elems[0], out, depth + 1);
+        } break;
+
+        case PARSER_KIND_CHOICE:
+        case PARSER_KIND_ADAPTIVE_CHOICE: {
+            if ( !p->sequence.num_elems ) {
+                return false;
+            }
+
+            for ( size_t i = 0; i < p->sequence.num_elems; ++i ) {
+                if ( !parser_first_set(p->sequence.elems[i], out, depth + 1) ) {
+                    return false;
+                }
+            }
+        } break;
+
+        case PARSER_KIND_MAP:
+        case PARSER_KIND_ERROR_MAP:
+        case PARSER_KIND_SKIP:
+        case PARSER_KIND_CAPTURE:
+        case PARSER_KIND_COMMIT:
+        case PARSER_KIND_LEXEME:
+        case PARSER_KIND_MEMO:
+        case PARSER_KIND_MANY1: {
+            return parser_first_set(p->p, out, depth + 1);
+        } break;
+
+        default: {
+            return false;
+        } break;
+    }
+
+    return true;
+}
+
+/* fester anfang eines treffers von p, höchstens cap bytes. complete ist gesetzt, wenn
+ * p genau diesen text liest. */
+size_t
+parser_literal_prefix(Parser *p, char *buf, size_t cap, bool *complete, int depth = 0) {
+    *complete = false;
+
+    if ( !p || depth > 32 || cap == 0 ) {
+        return 0;
+    }
+
+    switch ( p->kind ) {
+        case PARSER_KIND_CHR: {
+            if ( !p->str[0] ) {
+                return 0;
+            }
+
+            buf[0] = p->str[0];
+            *complete = true;
+
+            return 1;
+        } break;
+
+        case PARSER_KIND_STR: {
+            size_t len = ((size_t)p->num < cap) ? (size_t)p->num : cap;
+            memcpy(buf, p->str, len);
+            *complete = (len == (size_t)p->num);
+
+            return len;
+        } break;
+
+        case PARSER_KIND_SEQ_OF: {
+            size_t len = 0;
+
+            for ( size_t i = 0; i < p->sequence.num_elems; ++i ) {
+                bool child_complete = false;
+                len += parser_literal_prefix(p->sequence.elems[i], buf + len, cap - len, &child_complete, depth + 1);
+
+                if ( !child_complete ) {
+                    return len;
+                }
+            }
+
+            *complete = true;
+
+            return len;
+        } break;
+
+        case PARSER_KIND_MAP:
+        case PARSER_KIND_SKIP:
+        case PARSER_KIND_CAPTURE:
+        case PARSER_KIND_MEMO: {
+            return parser_literal_prefix(p->p, buf, cap, complete, depth + 1);
+        } break;
+
+        case PARSER_KIND_LEXEME: {
+            bool child_complete = false;
+
+            return parser_literal_prefix(p->p, buf, cap, &child_complete, depth + 1);
+        } break;
+
+        default: {
+            return 0;
+        } break;
+    }
+}
+
+/* ob höchstens eine der beiden alternativen an einer stelle passen kann: ihre ersten
+ * bytes sind verschieden oder ihr fester anfang unterscheidet sich. */
+bool
+parser_mutually_exclusive(Parser *a, Parser *b) {
+    Parser_Chr_Set first_a = {};
+    Parser_Chr_Set first_b = {};
+
+    if ( parser_first_set(a, &first_a) && parser_first_set(b, &first_b) ) {
+        bool overlap = false;
+
+        for ( int i = 0; i < 8; ++i ) {
+            overlap = overlap || (first_a.bits[i] & first_b.bits[i]);
+        }
+
+        if ( !overlap ) {
+            return true;
+        }
+    }
+
+    char prefix_a[64];
+    char prefix_b[64];
+    bool complete = false;
+    size_t len_a = parser_literal_prefix(a, prefix_a, sizeof(prefix_a), &complete);
+    size_t len_b = parser_literal_prefix(b, prefix_b, sizeof(prefix_b), &complete);
+    size_t len = (len_a < len_b) ? len_a : len_b;
+
+    for ( size_t i = 0; i < len; ++i ) {
+        if ( prefix_a[i] != prefix_b[i] ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#ifndef PARSER_ADAPTIVE_PERIOD
+#define PARSER_ADAPTIVE_PERIOD 1024
+#endif
+
+#define PARSER_ADAPTIVE_MAX 16
+
+/* reihenfolge und trefferzahlen eines Adaptive_Choice. die reihenfolge steht mit 4 bit
+ * je alternative in einem wort und wird als ganzes gelesen und ersetzt, so sieht jeder
+ * aufruf eine vollständige reihenfolge, auch wenn mehrere threads dieselbe grammatik
+ * benutzen. die zähler sind nur ungefähr, verlorene erhöhungen schaden nicht. */
+struct Parser_Adaptive {
+    std::atomic<uint64_t> order;
+    std::atomic<uint32_t> hits_total;
+    std::atomic<uint32_t> hits[PARSER_ADAPTIVE_MAX];
+};
+
+uint32_t
+parser_adaptive_at(uint64_t order, size_t i) {
+    uint32_t result = (uint32_t)(order >> (4*i)) & 15;
+
+    return result;
+}
+
+/* sortiert die alternativen nach ihren treffern und halbiert die zähler, damit sich
+ * die reihenfolge an veränderten verkehr anpaßt. */
+void
+parser_adaptive_reorder(Parser *p) {
+    Parser_Adaptive *a = (Parser_Adaptive *)p->user_data;
+    size_t n = p->sequence.num_elems;
+
+    uint32_t hits[PARSER_ADAPTIVE_MAX];
+    uint32_t index[PARSER_ADAPTIVE_MAX];
+
+    for ( size_t i = 0; i < n; ++i ) {
+        hits[i]  = a->hits[i].load(std::memory_order_relaxed);
+        index[i] = (uint32_t)i;
+
+        a->hits[i].fetch_sub(hits[i] / 2, std::memory_order_relaxed);
+    }
+
+    for ( size_t i = 1; i < n; ++i ) {
+        uint32_t current = index[i];
+        size_t j = i;
+
+        while ( j > 0 && hits[index[j - 1]] < hits[current] ) {
+            index[j] = index[j - 1];
+            j -= 1;
+        }
+
+        index[j] = current;
+    }
+
+    uint64_t order = 0;
+    for ( size_t i = 0; i < n; ++i ) {
+        order |= (uint64_t)index[i] << (4*i);
+    }
+
+    a->order.store(order, std::memory_order_release);
+}
+
+void
+parser_adaptive_hit(Parser *p, uint32_t alternative) {
+    Parser_Adaptive *a = (Parser_Adaptive *)p->user_data;
+
+    a->hits[alternative].fetch_add(1, std::memory_order_relaxed);
+
+    if ( (a->hits_total.fetch_add(1, std::memory_order_relaxed) + 1) % PARSER_ADAPTIVE_PERIOD == 0 ) {
+        parser_adaptive_reorder(p);
+    }
+}
+
+/* wie Choice für alternativen, von denen an jeder stelle höchstens eine passen kann.
+ * die alternativen werden in der reihenfolge ihrer bisherigen treffer versucht, alle
+ * PARSER_ADAPTIVE_PERIOD treffer wird neu sortiert. scheitern alle, liefert
+ * Adaptive_Choice die meldung der zuletzt angegebenen alternative wie Choice. läßt
+ * sich die ausschließlichkeit nicht zeigen oder sind es mehr als 16 alternativen,
+ * wird ein gewöhnliches Choice angelegt. */
+Parser *
+Adaptive_Choice(std::initializer_list<Parser *> s) {
+    Parser *p = Choice(s);
+    size_t n = p->sequence.num_elems;
+
+    if ( n < 2 || n > PARSER_ADAPTIVE_MAX ) {
+        return p;
+    }
+
+    for ( size_t i = 0; i < n; ++i ) {
+        for ( size_t j = i + 1; j < n; ++j ) {
+            if ( !parser_mutually_exclusive(p->sequence.elems[i], p->sequence.elems[j]) ) {
+                return p;
+            }
+        }
+    }
+
+    Parser_Adaptive *a = new (grammar_alloc(sizeof(Parser_Adaptive))) Parser_Adaptive();
+
+    uint64_t order = 0;
+    for ( size_t i = 0; i < n; ++i ) {
+        order |= (uint64_t)i << (4*i);
+    }
+    a->order.store(order, std::memory_order_relaxed);
+
+    p->kind      = PARSER_KIND_ADAPTIVE_CHOICE;
+    p->user_data = a;
+    p->proc      = [](Parser *p, const Parser_State &state) {
+        if ( !state.success ) {
+            return state;
+        }
+
+        Parser_Adaptive *a = (Parser_Adaptive *)p->user_data;
+        uint64_t order = a->order.load(std::memory_order_acquire);
+
+        Parser_State result = state;
+        uint32_t result_alternative = 0;
+        Parser_State alt_state = state;
+        uint32_t outer_cut = parser_cut_enter(&alt_state);
+
+        for ( size_t i = 0; i < p->sequence.num_elems; ++i ) {
+            uint32_t alternative = parser_adaptive_at(order, i);
+            Parser *seq_p = parser_entry(&p->sequence, alternative);
+
+            size_t mark = parser_event_try(&state);
+            Parser_State new_state = parser_call(seq_p, alt_state);
+            parser_event_end_try(&state, mark, new_state.success);
+
+            if ( new_state.success ) {
+                parser_adaptive_hit(p, alternative);
+                parser_cut_leave(&new_state, outer_cut);
+
+                return new_state;
+            }
+
+            parser_profile_backtrack(seq_p);
+
+            if ( parser_committed(&new_state) ) {
+                result = new_state;
+                break;
+            }
+
+            /* wie bei Choice zählt die meldung der zuletzt angegebenen alternative */
+            if ( i == 0 || alternative >= result_alternative ) {
+                result = new_state;
+                result_alternative = alternative;
+            }
+        }
+
+        parser_cut_leave(&result, outer_cut);
+
+        return result;
+    };
+
+    return p;
+}
+
+Parser *
+Regex(char *rgx) {
+    Parser *p = parser_create([](Parser *p, const Parser_State &state) {
+        if ( !state.success ) {
+            return state;
+        }
+
+        /* regex_match liest den ganzen rest */
+        if ( state.ctx ) {
+            parser_examined(state, state.index + strlen(state.val + state.index) + 1);
+        }
+
+        std::cmatch meta;
+        if ( !std::regex_match(state.val + state.index, meta, std::regex(p->str)) ) {
+            return parser_update_error(state,
+                    "Regex: konnte keine übereinstimmung des ausdrucks '%s' in '%s' finden",
+                    p->str, state.val + state.index);
+        }
+
+        size_t len = meta.length(0);
+
+        if ( state.flags & PARSER_FLAG_NO_CAPTURE ) {
+            return parser_update_state(state, state.index + len,
+                    parser_result_str(state.val + state.index, len));
+        }
+
+        char *str = (char *)parser_alloc_tagged(len + 1, PARSER_ALLOC_REGEX_COPY);
+        for ( int i = 0; i < len; ++i ) {
+            str[i] = meta.str(0)[i];
+        }
+        str[len] = '\0';
+
+        return parser_update_state(state, state.index + len,
+                parser_result_str(str, len));;
+    }, PARSER_KIND_REGEX);
+
+    p->str = rgx;
+
+    return p;
+}
+
+/* schlüssel eines ergebnisses für Switch und Chain_Cached. zeichen und zahlen werden
+ * direkt verwendet, zeichenketten über ihren inhalt. andere ergebnisse haben keinen
+ * schlüssel. */
+bool
+parser_result_key(Parser_Result r, uint64_t *key, char **str, size_t *len) {
+    *str = NULL;
+    *len = 0;
+
+    switch ( r.kind ) {
+        case PARSER_RESULT_CHR: {
+            *key = (uint64_t)(int64_t)r.chr.val;
+        } break;
+
+        case PARSER_RESULT_U64: {
+            *key = r.u64.val;
+        } break;
+
+        case PARSER_RESULT_S64: {
+            *key = (uint64_t)r.s64.val;
+        } break;
+
+        case PARSER_RESULT_STR: {
+            /* fnv-1a */
+            uint64_t h = 0xCBF29CE484222325ull;
+            for ( size_t i = 0; i < r.str.len; ++i ) {
+                h = (h ^ (uint8_t)r.str.val[i]) * 0x100000001B3ull;
+            }
+
+            *key = h;
+            *str = r.str.val;
+            *len = r.str.len;
+        } break;
+
+        default: {
+            return false;
+        } break;
+    }
+
+    return true;
+}
+
+struct Parser_Jump_Entry {
+    uint64_t   key;
+    char     * str;  /* NULL bei zahlen */
+    size_t     len;
+    Parser   * p;    /* NULL ist frei */
+};
+
+/* kleine, dicht liegende zahlenschlüssel werden direkt nachgeschlagen, alle anderen
+ * über eine hashtabelle mit offener adressierung. */
+struct Parser_Jump_Table {
+    Parser            ** dense;
+    uint64_t             dense_min;
+    size_t               dense_len;
+
+    Parser_Jump_Entry  * entries;
+    size_t               cap;
+    size_t               num;
+
+    Parser             * otherwise;  /* Switch ohne passenden fall */
+
+    Parser_Chain_Cache * cache;      /* nur bei Chain_Cached */
+};
+
+/* einträge und bytes für zeichenketten je eintrag, die Chain_Cached vorhält */
+#ifndef PARSER_CHAIN_CACHE_LIMIT
+#define PARSER_CHAIN_CACHE_LIMIT 256
+#endif
+
+#ifndef PARSER_CHAIN_CACHE_KEY_BYTES
+#define PARSER_CHAIN_CACHE_KEY_BYTES 16
+#endif
+
+enum Parser_Chain_Slot_State : uint32_t {
+    PARSER_CHAIN_SLOT_FREE,
+    PARSER_CHAIN_SLOT_WRITING,
+    PARSER_CHAIN_SLOT_READY,
+};
+
+/* ein platz im cache von Chain_Cached. state wird als letztes mit release auf
+ * PARSER_CHAIN_SLOT_READY gesetzt, wer das mit acquire liest, sieht auch entry. */
+struct Parser_Chain_Slot {
+    std::atomic<uint32_t> state;
+    Parser_Jump_Entry     entry;
+};
+
+/* der cache von Chain_Cached hat feste größe: höchstens limit einträge, deren
+ * zeichenketten in keys liegen. beides wird beim anlegen reserviert, beim parsen wird
+ * nichts mehr angefordert. einträge und bytes werden per CAS vergeben, so dürfen
+ * mehrere threads zugleich nachschlagen und eintragen. */
+struct Parser_Chain_Cache {
+    Parser_Chain_Slot   * slots;
+    size_t                cap;
+    size_t                limit;
+    char                * keys;
+    size_t                keys_cap;
+
+    std::atomic<size_t>   num;
+    std::atomic<size_t>   keys_used;
+};
+
+size_t
+parser_jump_hash(uint64_t key, size_t cap) {
+    size_t result = (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & (cap - 1);
+
+    return result;
+}
+
+size_t
+parser_jump_slot(Parser_Jump_Table *t, uint64_t key) {
+    size_t result = parser_jump_hash(key, t->cap);
+
+    return result;
+}
+
+Parser *
+parser_jump_find(Parser_Jump_Table *t, uint64_t key, char *str, size_t len) {
+    if ( t->dense ) {
+        uint64_t i = key - t->dense_min;
+
+        return (!str && i < t->dense_len) ? t->dense[i] : NULL;
+    }
+
+    if ( !t->cap ) {
+        return NULL;
+    }
+
+    for ( size_t i = parser_jump_slot(t, key); t->entries[i].p; i = (i + 1) & (t->cap - 1) ) {
+        Parser_Jump_Entry *e = &t->entries[i];
+
+        if ( e->key != key || (e->str == NULL) != (str == NULL) ) {
+            continue;
+        }
+
+        if ( !str || (e->len == len && memcmp(e->str, str, len) == 0) ) {
+            return e->p;
+        }
+    }
+
+    return NULL;
+}
+
+/* zeichenketten werden kopiert, die eingabe lebt nicht so lange wie die grammatik. */
+void
+parser_jump_insert(Parser_Jump_Table *t, uint64_t key, char *str, size_t len, Parser *p) {
+    if ( (t->num + 1)*2 > t->cap ) {
+        Parser_Jump_Entry *old = t->entries;
+        size_t old_cap = t->cap;
+
+        t->cap = (old_cap < 16) ? 16 : old_cap*2;
+        t->entries = (Parser_Jump_Entry *)grammar_alloc(sizeof(Parser_Jump_Entry)*t->cap);
+        memset(t->entries, 0, sizeof(Parser_Jump_Entry)*t->cap);
+
+        for ( size_t i = 0; i < old_cap; ++i ) {
+            if ( !old[i].p ) {
+                continue;
+            }
+
+            size_t j = parser_jump_slot(t, old[i].key);
+            while ( t->entries[j].p ) {
+                j = (j + 1) & (t->cap - 1);
+            }
+
+            t->entries[j] = old[i];
+        }
+
+        grammar_dealloc(old);
+    }
+
+    if ( str ) {
+        char *copy = (char *)grammar_alloc(len + 1);
+        memcpy(copy, str, len);
+        copy[len] = '\0';
+        str = copy;
+    }
+
+    size_t i = parser_jump_slot(t, key);
+    while ( t->entries[i].p ) {
+        i = (i + 1) & (t->cap - 1);
+    }
+
+    t->entries[i] = { key, str, len, p };
+    t->num += 1;
+}
+
+/* plätze, die gerade beschrieben werden, zählen als fremder schlüssel. ein solcher
+ * fehlgriff kostet nur einen weiteren aufruf von chain_proc. */
+Parser *
+parser_chain_cache_find(Parser_Chain_Cache *c, uint64_t key, char *str, size_t len) {
+    for ( size_t i = parser_jump_hash(key, c->cap); ; i = (i + 1) & (c->cap - 1) ) {
+        Parser_Chain_Slot *slot = &c->slots[i];
+        uint32_t state = slot->state.load(std::memory_order_acquire);
+
+        if ( state == PARSER_CHAIN_SLOT_FREE ) {
+            return NULL;
+        }
+
+        Parser_Jump_Entry *e = &slot->entry;
+        if ( state != PARSER_CHAIN_SLOT_READY || e->key != key || (e->str == NULL) != (str == NULL) ) {
+            continue;
+        }
+
+        if ( !str || (e->len == len && memcmp(e->str, str, len) == 0) ) {
+            return e->p;
+        }
+    }
+}
+
+/* erhöht *counter um amount, solange das ergebnis max nicht übersteigt */
+bool
+parser_chain_cache_take(std::atomic<size_t> *counter, size_t amount, size_t max, size_t *at) {
+    size_t current = counter->load(std::memory_order_relaxed);
+
+    do {
+        if ( amount > max - current ) {
+            return false;
+        }
+    } while ( !counter->compare_exchange_weak(current, current + amount, std::memory_order_relaxed) );
+
+    *at = current;
+
+    return true;
+}
+
+/* ist der feste speicher voll, bleibt der eintrag weg. schreiben zwei threads denselben
+ * schlüssel, steht er zweimal im cache, gefunden wird der erste. */
+void
+parser_chain_cache_insert(Parser_Chain_Cache *c, uint64_t key, char *str, size_t len, Parser *p) {
+    size_t at = 0;
+
+    if ( !parser_chain_cache_take(&c->num, 1, c->limit, &at) ) {
+        return;
+    }
+
+    if ( str ) {
+        if ( !parser_chain_cache_take(&c->keys_used, len, c->keys_cap, &at) ) {
+            return;
+        }
+
+        memcpy(c->keys + at, str, len);
+        str = c->keys + at;
+    }
+
+    /* cap ist mindestens doppelt so groß wie limit, es findet sich immer ein platz */
+    for ( size_t i = parser_jump_hash(key, c->cap); ; i = (i + 1) & (c->cap - 1) ) {
+        Parser_Chain_Slot *slot = &c->slots[i];
+        uint32_t expected = PARSER_CHAIN_SLOT_FREE;
+
+        if ( slot->state.compare_exchange_strong(expected, PARSER_CHAIN_SLOT_WRITING, std::memory_order_relaxed) ) {
+            slot->entry = { key, str, len, p };
+            slot->state.store(PARSER_CHAIN_SLOT_READY, std::memory_order_release);
+
+            return;
+        }
+    }
+}
+
+/* liefert den parser, mit dem nach dem wert result weitergemacht wird, NULL wenn es
+ * keinen gibt. */
+Parser *
+parser_chain_next(Parser *p, Parser_Result result) {
+    uint64_t key = 0;
+    char *str = NULL;
+    size_t len = 0;
+    bool keyed = p->table && parser_result_key(result, &key, &str, &len);
+
+    if ( keyed ) {
+        Parser_Chain_Cache *cache = p->table->cache;
+        Parser *cached = cache ? parser_chain_cache_find(cache, key, str, len)
+                               : parser_jump_find(p->table, key, str, len);
+
+        if ( cached ) {
+            return cached;
+        }
+    }
+
+    if ( p->kind == PARSER_KIND_SWITCH ) {
+        return p->table->otherwise;
+    }
+
+    Parser *next = p->chain_proc(result, p->user_data);
+
+    if ( keyed && next ) {
+        parser_chain_cache_insert(p->table->cache, key, str, len, next);
+    }
+
+    return next;
 }
 
-Parser_Result
-parser_result_arr(Parser_Result_List arr) {
-    Parser_Result result = {};
+Parser_State
+parser_chain_missing(const Parser_State &state) {
+    Parser_State result = parser_update_error(state, "Switch: kein fall für den gelesenen wert");
+
+    return result;
+}
+
+PARSER_PROC(parser_chain_proc) {
+    /* die fortsetzung hängt vom wert ab, der erste parser muß daher immer
+     * ein ergebnis liefern. */
+    Parser_State chain_state = state;
+    chain_state.flags &= ~PARSER_FLAG_NO_CAPTURE;
+    chain_state.flags |= PARSER_FLAG_NO_EVENTS;
+
+    Parser_State new_state = parser_call(p->p, chain_state);
+    parser_restore_flags(&new_state, state.flags);
+
+    if ( !new_state.success ) {
+        return new_state;
+    }
+
+    Parser *new_parser = parser_chain_next(p, new_state.result);
+
+    if ( !new_parser ) {
+        return parser_chain_missing(state);
+    }
+
+    return parser_call(new_parser, new_state);
+}
+
+Parser *
+Chain(Parser *p, Parser_Chain *chain_proc) {
+    Parser *result = parser_create(parser_chain_proc, PARSER_KIND_CHAIN);
+
+    result->p = p;
+    result->chain_proc = chain_proc;
+
+    return result;
+}
+
+/* wie Chain, merkt sich aber die fortsetzung je wert des ersten parsers. chain_proc
+ * wird für jeden wert nur einmal aufgerufen und darf daher nur von diesem und von
+ * user_data abhängen. werte ohne schlüssel (listen, eigene werte) werden nicht
+ * zwischengespeichert, ebenso alle werte, sobald limit einträge oder
+ * PARSER_CHAIN_CACHE_KEY_BYTES je eintrag für zeichenketten belegt sind. limit 0
+ * schaltet den cache ab. mehrere threads dürfen die grammatik zugleich benutzen.
+ * chain_proc kann dann für einen wert auch mehrmals aufgerufen werden. */
+Parser *
+Chain_Cached(Parser *p, Parser_Chain *chain_proc, size_t limit = PARSER_CHAIN_CACHE_LIMIT) {
+    Parser *result = Chain(p, chain_proc);
+
+    if ( !limit ) {
+        return result;
+    }
+
+    Parser_Chain_Cache *c = new (grammar_alloc(sizeof(Parser_Chain_Cache))) Parser_Chain_Cache();
+
+    c->limit = limit;
+    c->cap   = 16;
+    while ( c->cap < limit*2 ) {
+        c->cap *= 2;
+    }
+
+    c->slots = (Parser_Chain_Slot *)grammar_alloc(sizeof(Parser_Chain_Slot)*c->cap);
+    for ( size_t i = 0; i < c->cap; ++i ) {
+        new (c->slots + i) Parser_Chain_Slot();
+    }
+
+    c->keys_cap = limit*PARSER_CHAIN_CACHE_KEY_BYTES;
+    c->keys     = (char *)grammar_alloc(c->keys_cap);
 
-    result.kind = PARSER_RESULT_ARR;
-    result.arr.val = arr;
-    result.arr.len = arr.num_elems;
+    Parser_Jump_Table *t = (Parser_Jump_Table *)grammar_alloc(sizeof(Parser_Jump_Table));
+    *t = {};
+    t->cache = c;
+
+    result->table = t;
 
     return result;
 }
 
-Parser_Result
-parser_result_custom(void *val) {
-    Parser_Result result = {};
+/* ein fall von Switch, schlüssel ist ein zeichen, eine zahl oder eine zeichenkette */
+struct Parser_Case {
+    uint64_t   key;
+    char     * str;
+    Parser   * p;
 
-    result.kind = PARSER_RESULT_CUSTOM;
-    result.custom.val = val;
+    Parser_Case(int key, Parser *p)      : key((uint64_t)(int64_t)key), str(NULL), p(p) {}
+    Parser_Case(uint64_t key, Parser *p) : key(key), str(NULL), p(p) {}
+    Parser_Case(char *str, Parser *p)    : key(0), str(str), p(p) {}
+};
 
-    return result;
-}
+/* liest mit tag einen wert und macht mit dem parser des passenden falls weiter, ohne
+ * passenden fall mit otherwise. ohne otherwise scheitert Switch an der stelle des
+ * werts. die fälle werden beim anlegen in eine sprungtabelle übertragen. */
+Parser *
+Switch(Parser *tag, std::initializer_list<Parser_Case> cases, Parser *otherwise = NULL) {
+    Parser *result = parser_create(parser_chain_proc, PARSER_KIND_SWITCH);
 
-Parser_State
-parser_update_state(Parser_State in, size_t index, Parser_Result r) {
-    Parser_State result = {};
+    Parser_Jump_Table *t = (Parser_Jump_Table *)grammar_alloc(sizeof(Parser_Jump_Table));
+    *t = {};
+    t->otherwise = otherwise;
 
-    result.success = true;
-    result.val     = in.val;
-    result.result  = r;
-    result.index   = index;
+    bool numeric = cases.size() > 0;
+    uint64_t min = UINT64_MAX;
+    uint64_t max = 0;
 
-    return result;
-}
+    for ( const Parser_Case &c : cases ) {
+        numeric = numeric && !c.str;
+        min = (c.key < min) ? c.key : min;
+        max = (c.key > max) ? c.key : max;
+    }
 
-Parser_State
-parser_update_result(Parser_State in, Parser_Result r) {
-    Parser_State result = {};
+    if ( numeric && max - min < 256 ) {
+        t->dense_min = min;
+        t->dense_len = (size_t)(max - min) + 1;
+        t->dense = (Parser **)grammar_alloc(sizeof(Parser *)*t->dense_len);
+        memset(t->dense, 0, sizeof(Parser *)*t->dense_len);
+    }
 
-    result.success = true;
-    result.val     = in.val;
-    result.index   = in.index;
-    result.result  = r;
+    parser_list_reserve(&result->sequence, cases.size());
 
-    return result;
-}
+    for ( const Parser_Case &c : cases ) {
+        /* die fälle stehen auch in sequence, damit optimize und co. sie finden */
+        parser_push(&result->sequence, c.p);
 
-Parser_State
-parser_update_error(Parser_State in, char *fmt, ...) {
-    Parser_State result = {};
+        if ( t->dense ) {
+            if ( !t->dense[c.key - min] ) {
+                t->dense[c.key - min] = c.p;
+            }
 
-    va_list args;
-    va_start(args, fmt);
-    int size = 1 + vsnprintf(NULL, 0, fmt, args);
-    va_end(args);
+            continue;
+        }
 
-    char *msg = (char *)parser_alloc(size);
+        uint64_t key = c.key;
+        char *str = NULL;
+        size_t len = 0;
 
-    va_start(args, fmt);
-    vsnprintf(msg, size, fmt, args);
-    va_end(args);
+        if ( c.str ) {
+            parser_result_key(parser_result_str(c.str, strlen(c.str)), &key, &str, &len);
+        }
 
-    result.success = false;
-    result.val     = in.val;
-    result.index   = in.index;
-    result.result  = in.result;
-    result.msg     = msg;
+        if ( !parser_jump_find(t, key, str, len) ) {
+            parser_jump_insert(t, key, str, len, c.p);
+        }
+    }
+
+    result->p = tag;
+    result->table = t;
 
     return result;
 }
 
 Parser *
-Fail(char *fmt, ...) {
-    va_list args;
-    va_start(args, fmt);
-    int size = 1 + vsnprintf(NULL, 0, fmt, args);
-    va_end(args);
+Map(Parser *p, Parser_Map *map_proc) {
 
-    char *msg = (char *)parser_alloc(size);
+    Parser *result = parser_create([](Parser *p, const Parser_State &state) {
+        Parser_State new_state = parser_call(p->p, state);
 
-    va_start(args, fmt);
-    vsnprintf(msg, size, fmt, args);
-    va_end(args);
+        if ( !new_state.success ) {
+            return new_state;
+        }
 
-    auto result = parser_create([](Parser *p, Parser_State state) {
-        return parser_update_error(state, p->msg);
-    });
+        /* map-funktionen wandeln nur werte um und entfallen, wenn keine ergebnisse
+         * gebraucht werden. */
+        if ( state.flags & PARSER_FLAG_NO_CAPTURE ) {
+            return new_state;
+        }
 
-    result->msg = msg;
+        return parser_update_result(new_state,
+                p->map_proc(new_state.result, new_state.index, p->user_data));
+    }, PARSER_KIND_MAP);
+
+    result->p = p;
+    result->map_proc = map_proc;
 
     return result;
 }
 
 Parser *
-Succeed(Parser_Result val) {
-    auto result = parser_create([](Parser *p, Parser_State state) {
-        return parser_update_result(state, p->val);
-    });
+Error_Map(Parser *p, Parser_Map *map_proc) {
 
-    result->val = val;
+    Parser *result = parser_create([](Parser *p, const Parser_State &state) {
+        Parser_State new_state = parser_call(p->p, state);
+
+        if ( new_state.success ) {
+            return new_state;
+        }
+
+        Parser_Result map_proc_result = p->map_proc(new_state.result,
+                new_state.index, p->user_data);
+
+        return parser_update_error(new_state, map_proc_result.str.val);
+    }, PARSER_KIND_ERROR_MAP);
+
+    result->p = p;
+    result->map_proc = map_proc;
 
     return result;
 }
 
 Parser *
-Chr(char c) {
-    Parser *p = parser_create([](Parser *p, Parser_State state) {
-        if ( !state.success ) {
-            return state;
-        }
+Many(Parser *p) {
 
-        Parser_State result = {};
+    Parser *result = parser_create([](Parser *p, const Parser_State &state) {
+        Parser_Result_Buffer results;
+        parser_result_buffer_init(&results, 0);
+        Parser_State new_state = state;
+        size_t num_results = 0;
+        uint32_t outer_cut = parser_cut_enter(&new_state);
 
-        if ( state.val[state.index] == p->str[0] ) {
-            return parser_update_state(state, state.index + 1, parser_result_chr(p->str[0]));
-        }
+        parser_event_emit(&state, PARSER_EVENT_BEGIN_NODE, p, parser_result_none());
 
-        return parser_update_error(state, "chr: das gesuchte zeichen wurde nicht gefunden");
-    });
+        for ( ;; ) {
+            size_t mark = parser_event_try(&state);
+            Parser_State next_state = parser_call(p->p, new_state);
+            parser_event_end_try(&state, mark, next_state.success);
 
-    p->str  = (char *)parser_alloc(1);
-    p->str[0] = c;
+            if ( next_state.success ) {
+                bool progress = next_state.index != new_state.index;
 
-    return p;
-}
+                new_state = next_state;
+                new_state.flags &= ~PARSER_FLAG_CUT;
+                num_results += 1;
 
-Parser *
-Str(char *str) {
-    Parser *p = parser_create([](Parser *p, Parser_State state) {
-        if ( !state.success ) {
-            return state;
-        }
+                if ( !(state.flags & PARSER_FLAG_NO_CAPTURE) ) {
+                    parser_result_buffer_push(&results, new_state.result);
+                }
 
-        Parser_State result = {};
+                /* ohne fortschritt käme jede weitere wiederholung an dieselbe stelle */
+                if ( !progress ) {
+                    break;
+                }
 
-        size_t len = strlen(p->str);
-        if ( strlen(state.val+state.index) < len ) {
-            return result;
-        }
+                continue;
+            }
 
-        bool string_found = true;
-        for ( int i = 0; i < len; ++i ) {
-            if ( (state.val+state.index)[i] != p->str[i] ) {
-                string_found = false;
-                break;
+            parser_profile_backtrack(p->p);
+
+            /* eine wiederholung, die nach einem cut scheitert, läßt das ganze Many
+             * scheitern */
+            if ( parser_committed(&next_state) ) {
+                parser_result_buffer_free(&results);
+                parser_event_emit(&state, PARSER_EVENT_END_NODE, p, parser_result_none());
+                parser_cut_leave(&next_state, outer_cut);
+
+                return next_state;
             }
+
+            /* die gescheiterte wiederholung verbraucht nichts, es geht hinter der letzten
+             * erfolgreichen weiter */
+            break;
         }
 
-        if ( string_found ) {
-            return parser_update_state(state, state.index + len,
-                    parser_result_str(state.val+state.index, len));
+        parser_cut_leave(&new_state, outer_cut);
+
+        parser_event_emit(&state, PARSER_EVENT_END_NODE, p, parser_result_none());
+
+        if ( state.flags & PARSER_FLAG_NO_CAPTURE ) {
+            return parser_update_result(new_state, parser_result_none());
         }
 
-        return parser_update_error(state, "str: die gesuchte zeichenkette wurde nicht gefunden");
-    });
+        return parser_update_result(new_state, parser_result_arr(parser_result_buffer_list(&results)));
+    }, PARSER_KIND_MANY);
 
-    p->str  = str;
+    result->p = p;
 
-    return p;
+    return result;
 }
 
 Parser *
-Number(int n) {
-    Parser *p = parser_create([](Parser *p, Parser_State state) {
-        if ( !state.success ) {
-            return state;
-        }
+Many1(Parser *parser) {
+    Parser *result = parser_create([](Parser *p, const Parser_State &state) {
+        Parser_Result_Buffer results;
+        parser_result_buffer_init(&results, 0);
+        Parser_State new_state = state;
+        size_t num_results = 0;
+        uint32_t outer_cut = parser_cut_enter(&new_state);
 
-        size_t len = strlen(p->n);
+        parser_event_emit(&state, PARSER_EVENT_BEGIN_NODE, p, parser_result_none());
 
-        if (strlen(state.val+state.index) < len) {
-            return parser_update_error(state, "number: unerwartet das ende erreicht");
-        }
+        for ( ;; ) {
+            size_t mark = parser_event_try(&state);
+            Parser_State next_state = parser_call(p->p, new_state);
+            parser_event_end_try(&state, mark, next_state.success);
 
-        for ( int i = 0; i < len; ++i ) {
-            if ( p->n[i] != (state.val+state.index)[i] ) {
-                return parser_update_error(state, "number: nummer wurde nicht erkannt");
+            if ( next_state.success ) {
+                bool progress = next_state.index != new_state.index;
+
+                new_state = next_state;
+                new_state.flags &= ~PARSER_FLAG_CUT;
+                num_results += 1;
+
+                if ( !(state.flags & PARSER_FLAG_NO_CAPTURE) ) {
+                    parser_result_buffer_push(&results, new_state.result);
+                }
+
+                /* ohne fortschritt käme jede weitere wiederholung an dieselbe stelle */
+                if ( !progress ) {
+                    break;
+                }
+
+                continue;
             }
+
+            parser_profile_backtrack(p->p);
+
+            /* eine wiederholung, die nach einem cut scheitert, läßt das ganze Many
+             * scheitern */
+            if ( parser_committed(&next_state) ) {
+                parser_result_buffer_free(&results);
+                parser_event_emit(&state, PARSER_EVENT_END_NODE, p, parser_result_none());
+                parser_cut_leave(&next_state, outer_cut);
+
+                return next_state;
+            }
+
+            /* die gescheiterte wiederholung verbraucht nichts, es geht hinter der letzten
+             * erfolgreichen weiter */
+            break;
         }
 
-        return parser_update_state(state, state.index+len, parser_result_str(p->n, len));
-    });
+        parser_cut_leave(&new_state, outer_cut);
 
-    int count = 0;
-    int cnd = 0;
-    int temp = 0;
-    int i;
+        if ( num_results == 0 ) {
+            parser_result_buffer_free(&results);
+            parser_event_emit(&state, PARSER_EVENT_END_NODE, p, parser_result_none());
+            return parser_update_error(state, "many1: konnte keinen treffer erzielen");
+        }
 
-    if ( n >> 31 ) {
-        n = ~n + 1;
-        for(temp = n; temp != 0; temp /= 10, count++);
-        p->n[0] = 0x2D;
-        count++;
-        cnd = 1;
-    } else {
-        for(temp = n; temp != 0; temp /= 10, count++);
-    }
+        parser_event_emit(&state, PARSER_EVENT_END_NODE, p, parser_result_none());
 
-    for(i = count-1, temp = n; i >= cnd; i--) {
-        p->n[i] = (temp % 10) + 0x30;
-        temp /= 10;
-    }
+        if ( state.flags & PARSER_FLAG_NO_CAPTURE ) {
+            return parser_update_result(new_state, parser_result_none());
+        }
 
-    return p;
+        return parser_update_result(new_state, parser_result_arr(parser_result_buffer_list(&results)));
+    }, PARSER_KIND_MANY1);
+
+    result->p = parser;
+
+    return result;
 }
 
+/* legt die innerste umgebende alternative (Choice) bzw. wiederholung (Many, Sep_By)
+ * fest. scheitert sie danach, werden keine weiteren zweige mehr versucht. */
 Parser *
-Seq_Of(Parser_List sequence) {
-    Parser *p = parser_create([](Parser *p, Parser_State state) {
+Cut() {
+    Parser *result = parser_create([](Parser *p, const Parser_State &state) {
         if ( !state.success ) {
             return state;
         }
 
-        Parser_State result = {};
-
-        Parser_State new_state = state;
-        Parser_Result_List results = {};
+        Parser_State new_state = parser_update_result(state, parser_result_none());
+        parser_commit(&new_state);
 
-        for ( int i = 0; i < p->sequence.num_elems; ++i ) {
-            Parser *seq_p = parser_entry(&p->sequence, i);
-            new_state = seq_p->proc(seq_p, new_state);
+        return new_state;
+    }, PARSER_KIND_CUT);
 
-            if ( !new_state.success ) {
-                return new_state;
-            }
+    return result;
+}
 
-            parser_result_push(&results, new_state.result);
-        }
+/* wie p, legt nach erfolg aber den umgebenden zweig fest. */
+Parser *
+Commit(Parser *parser) {
+    Parser *result = parser_create([](Parser *p, const Parser_State &state) {
+        Parser_State new_state = parser_call(p->p, state);
 
-        if ( !new_state.success ) {
-            return new_state;
+        if ( new_state.success ) {
+            parser_commit(&new_state);
         }
 
-        return parser_update_result(new_state, parser_result_arr(results));
-    });
+        return new_state;
+    }, PARSER_KIND_COMMIT);
 
-    p->sequence  = sequence;
+    result->p = parser;
 
-    return p;
+    return result;
 }
 
-Parser *
-Seq_Of(std::initializer_list<Parser *> s) {
-    Parser_List sequence = {};
-    for ( Parser *i : s ) {
-        parser_push(&sequence, i);
-    }
-
-    return Seq_Of(sequence);
-}
+/* alles, was zwischen zwei tokens überlesen wird. leerraum wird immer überlesen, die
+ * kommentare nur, wenn die jeweiligen zeichenketten gesetzt sind, blockkommentare also
+ * nur mit anfang und ende. */
+struct Parser_Trivia {
+    char *line_comment;  /* bis zum zeilenende, z.b. ";" oder "//" */
+    char *block_begin;   /* z.b. "#|" */
+    char *block_end;     /* z.b. "|#" */
+};
 
-Parser *
-Choice(std::initializer_list<Parser *> s) {
-    Parser_List sequence = {};
-    for ( Parser *i : s ) {
-        parser_push(&sequence, i);
-    }
+bool
+parser_trivia_has_block(Parser_Trivia *trivia) {
+    bool result = trivia && trivia->block_begin && *trivia->block_begin &&
+                  trivia->block_end && *trivia->block_end;
 
-    Parser *p = parser_create([](Parser *p, Parser_State state) {
-        if ( !state.success ) {
-            return state;
-        }
+    return result;
+}
 
-        Parser_State result = {};
-        for ( int i = 0; i < p->sequence.num_elems; ++i ) {
-            Parser *seq_p = parser_entry(&p->sequence, i);
-            Parser_State new_state = seq_p->proc(seq_p, state);
+uint32_t
+parser_ctz32(uint32_t val) {
+#if defined(_MSC_VER)
+    unsigned long result;
+    _BitScanForward(&result, val);
 
-            if ( new_state.success ) {
-                return new_state;
-            }
+    return (uint32_t)result;
+#else
+    return (uint32_t)__builtin_ctz(val);
+#endif
+}
 
-            result = new_state;
+/* überliest leerraum wie Whitespace. mit SSE2 werden je 16 bytes auf einmal geprüft.
+ * die blöcke sind ausgerichtet und überschreiten daher nie eine speicherseite, auch
+ * wenn sie vor s beginnen oder hinter dem nullbyte enden. */
+PARSER_NO_SANITIZE char *
+parser_skip_whitespace(char *s) {
+#if PARSER_SSE2
+    uintptr_t offset = (uintptr_t)s & 15;
+    char *block = s - offset;
+
+    /* bytes vor s zählen als leerraum */
+    uint32_t before = (1u << offset) - 1;
+
+    __m128i space = _mm_set1_epi8(' ');
+    __m128i tab   = _mm_set1_epi8('\t');
+    __m128i cr    = _mm_set1_epi8('\r');
+    __m128i vt    = _mm_set1_epi8('\v');
+    __m128i lf    = _mm_set1_epi8('\n');
+
+    for ( ;; ) {
+        __m128i v = _mm_load_si128((__m128i *)block);
+        __m128i ws = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)),
+                _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, vt)),
+                    _mm_cmpeq_epi8(v, lf)));
+
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(ws) | before;
+        if ( mask != 0xFFFF ) {
+            return block + parser_ctz32(~mask);
         }
 
-        return result;
-    });
-
-    p->sequence  = sequence;
+        block += 16;
+        before = 0;
+    }
+#else
+    while ( *s == ' ' || *s == '\t' || *s == '\r' || *s == '\v' || *s == '\n' ) {
+        s++;
+    }
 
-    return p;
+    return s;
+#endif
 }
 
-Parser *
-Regex(char *rgx) {
-    Parser *p = parser_create([](Parser *p, Parser_State state) {
-        if ( !state.success ) {
-            return state;
+bool
+parser_starts_with(char *s, char *prefix) {
+    while ( *prefix ) {
+        if ( *s++ != *prefix++ ) {
+            return false;
         }
+    }
 
-        std::cmatch meta;
-        if ( !std::regex_match(state.val + state.index, meta, std::regex(p->str)) ) {
-            return parser_update_error(state,
-                    "Regex: konnte keine übereinstimmung des ausdrucks '%s' in '%s' finden",
-                    p->str, state.val + state.index);
+    return true;
+}
+
+/* überliest leerraum und kommentare ab s. ein nicht abgeschlossener blockkommentar
+ * bleibt stehen, damit der nächste parser an dieser stelle scheitert. */
+char *
+parser_skip_trivia(Parser_Trivia *trivia, char *s) {
+    for ( ;; ) {
+        s = parser_skip_whitespace(s);
+
+        if ( !trivia ) {
+            return s;
         }
 
-        size_t len = meta.str(0).length();
-        char *str = (char *)parser_alloc(len + 1);
-        for ( int i = 0; i < len; ++i ) {
-            str[i] = meta.str(0)[i];
+        if ( trivia->line_comment && *trivia->line_comment && parser_starts_with(s, trivia->line_comment) ) {
+            char *end = strchr(s, '\n');
+            s = end ? end : s + strlen(s);
+
+            continue;
         }
-        str[len] = '\0';
 
-        return parser_update_state(state, state.index + len,
-                parser_result_str(str, len));;
-    });
+        if ( parser_trivia_has_block(trivia) && parser_starts_with(s, trivia->block_begin) ) {
+            char *end = strstr(s + strlen(trivia->block_begin), trivia->block_end);
+            if ( !end ) {
+                return s;
+            }
 
-    p->str = rgx;
+            s = end + strlen(trivia->block_end);
 
-    return p;
+            continue;
+        }
+
+        return s;
+    }
 }
 
+/* wie p, überliest danach aber leerraum und kommentare, ohne dafür ein ergebnis
+ * anzulegen. ohne trivia gilt die einstellung der aktiven grammatik, ohne diese nur
+ * leerraum. */
 Parser *
-Chain(Parser *p, Parser_Chain *chain_proc) {
-    Parser *result = parser_create([](Parser *p, Parser_State state) {
-        Parser_State new_state = p->p->proc(p->p, state);
+Lexeme(Parser *parser, Parser_Trivia *trivia = NULL) {
+    Parser *result = parser_create([](Parser *p, const Parser_State &state) {
+        Parser_State new_state = parser_call(p->p, state);
 
         if ( !new_state.success ) {
             return new_state;
         }
 
-        Parser *new_parser = p->chain_proc(new_state.result, p->user_data);
+        Parser_Trivia *trivia = (Parser_Trivia *)p->user_data;
+        char *s = parser_skip_trivia(trivia, new_state.val + new_state.index);
+        new_state.index = s - new_state.val;
 
-        return new_parser->proc(new_parser, new_state);
-    });
+        /* ein nicht geschlossener kommentar wurde bis zum ende gelesen */
+        if ( state.ctx && parser_trivia_has_block(trivia) && parser_starts_with(s, trivia->block_begin) ) {
+            parser_examined(state, new_state.index + strlen(s) + 1);
+        }
 
-    result->p = p;
-    result->chain_proc = chain_proc;
+        return new_state;
+    }, PARSER_KIND_LEXEME);
+
+    if ( !trivia && parser_grammar ) {
+        trivia = parser_grammar->trivia;
+    }
+
+    if ( trivia ) {
+        Parser_Trivia *copy = (Parser_Trivia *)grammar_alloc(sizeof(Parser_Trivia));
+        *copy = *trivia;
+        result->user_data = copy;
+    }
+
+    result->p = parser;
 
     return result;
 }
 
 Parser *
-Map(Parser *p, Parser_Map *map_proc) {
+Skip(Parser *parser) {
+    Parser *result = parser_create([](Parser *p, const Parser_State &state) {
+        Parser_State skip_state = state;
+        skip_state.flags |= PARSER_FLAG_NO_CAPTURE | PARSER_FLAG_NO_EVENTS;
 
-    Parser *result = parser_create([](Parser *p, Parser_State state) {
-        Parser_State new_state = p->p->proc(p->p, state);
+        Parser_State new_state = parser_call(p->p, skip_state);
+        parser_restore_flags(&new_state, state.flags);
 
         if ( !new_state.success ) {
             return new_state;
         }
 
-        return parser_update_state(new_state, new_state.index,
-                p->map_proc(new_state.result, new_state.index, p->user_data));
-    });
+        return parser_update_result(new_state, parser_result_none());
+    }, PARSER_KIND_SKIP);
 
-    result->p = p;
-    result->map_proc = map_proc;
+    result->p = parser;
 
     return result;
 }
 
+/* liefert den von p verbrauchten ausschnitt der eingabe als zeichenkette, ohne die
+ * ergebnisse von p aufzubauen. */
 Parser *
-Error_Map(Parser *p, Parser_Map *map_proc) {
+Capture(Parser *parser) {
+    Parser *result = parser_create([](Parser *p, const Parser_State &state) {
+        Parser_State capture_state = state;
+        capture_state.flags |= PARSER_FLAG_NO_CAPTURE | PARSER_FLAG_NO_EVENTS;
 
-    Parser *result = parser_create([](Parser *p, Parser_State state) {
-        Parser_State new_state = p->p->proc(p->p, state);
+        Parser_State new_state = parser_call(p->p, capture_state);
+        parser_restore_flags(&new_state, state.flags);
 
-        if ( new_state.success ) {
+        if ( !new_state.success ) {
             return new_state;
         }
 
-        Parser_Result map_proc_result = p->map_proc(new_state.result,
-                new_state.index, p->user_data);
-
-        return parser_update_error(new_state, map_proc_result.str.val);
-    });
+        return parser_update_state(new_state, new_state.index,
+                parser_result_str(state.val + state.index, new_state.index - state.index));
+    }, PARSER_KIND_CAPTURE);
 
-    result->p = p;
-    result->map_proc = map_proc;
+    result->p = parser;
 
     return result;
 }
 
-Parser *
-Many(Parser *p) {
+auto
+Sep_By(Parser *separator_parser) {
+    auto result = [separator_parser](Parser *content_parser) -> Parser* {
+        Parser *parser = parser_create([](Parser *p, const Parser_State &state) {
+            Parser_Result_Buffer results;
+            parser_result_buffer_init(&results, 0);
+            Parser_State new_state = state;
+            size_t num_results = 0;
+            uint32_t outer_cut = parser_cut_enter(&new_state);
 
-    Parser *result = parser_create([](Parser *p, Parser_State state) {
-        Parser_Result_List results = {};
-        Parser_State new_state = state;
+            auto content_parser   = parser_entry(&p->sequence, 0);
+            auto separator_parser = parser_entry(&p->sequence, 1);
 
-        for ( ;; ) {
-            new_state = p->p->proc(p->p, new_state);
+            parser_event_emit(&state, PARSER_EVENT_BEGIN_NODE, p, parser_result_none());
 
-            if ( new_state.success ) {
-                parser_result_push(&results, new_state.result);
-                continue;
-            }
+            /* new_state steht hinter dem letzten inhalt, next_state vor dem nächsten */
+            Parser_State next_state = new_state;
 
-            break;
-        }
+            for ( ;; ) {
+                size_t mark = parser_event_try(&state);
+                Parser_State content_state = parser_call(content_parser, next_state);
+                parser_event_end_try(&state, mark, content_state.success);
 
-        return parser_update_result(new_state, parser_result_arr(results));
-    });
+                if ( !content_state.success ) {
+                    parser_profile_backtrack(content_parser);
 
-    result->p = p;
+                    if ( parser_committed(&content_state) ) {
+                        parser_result_buffer_free(&results);
+                        parser_event_emit(&state, PARSER_EVENT_END_NODE, p, parser_result_none());
+                        parser_cut_leave(&content_state, outer_cut);
 
-    return result;
-}
+                        return content_state;
+                    }
 
-Parser *
-Many1(Parser *parser) {
-    Parser *result = parser_create([](Parser *p, Parser_State state) {
-        Parser_Result_List results = {};
-        Parser_State new_state = state;
+                    break;
+                }
 
-        for ( ;; ) {
-            new_state = p->p->proc(p->p, new_state);
+                new_state = content_state;
+                new_state.flags &= ~PARSER_FLAG_CUT;
+                num_results += 1;
 
-            if ( new_state.success ) {
-                parser_result_push(&results, new_state.result);
-                continue;
+                if ( !(state.flags & PARSER_FLAG_NO_CAPTURE) ) {
+                    parser_result_buffer_push(&results, new_state.result);
+                }
+
+                /* trenner tauchen im ergebnis nicht auf und melden daher auch keine
+                 * ereignisse. */
+                Parser_State separator_state = new_state;
+                separator_state.flags |= PARSER_FLAG_NO_EVENTS;
+                separator_state = parser_call(separator_parser, separator_state);
+                parser_restore_flags(&separator_state, new_state.flags);
+
+                /* ein abbruch im trenner (tiefe, grenzen) beendet auch das Sep_By */
+                if ( separator_state.flags & PARSER_FLAG_FATAL ) {
+                    parser_result_buffer_free(&results);
+                    parser_event_emit(&state, PARSER_EVENT_END_NODE, p, parser_result_none());
+                    parser_cut_leave(&separator_state, outer_cut);
+
+                    return separator_state;
+                }
+
+                /* ohne fortschritt käme jede weitere wiederholung an dieselbe stelle */
+                if ( !separator_state.success || separator_state.index == next_state.index ) {
+                    break;
+                }
+
+                next_state = separator_state;
             }
 
-            break;
-        }
+            parser_cut_leave(&new_state, outer_cut);
 
-        if ( results.num_elems == 0 ) {
-            return parser_update_error(state, "many1: konnte keinen treffer erzielen");
-        }
+            parser_event_emit(&state, PARSER_EVENT_END_NODE, p, parser_result_none());
 
-        return parser_update_result(new_state, parser_result_arr(results));
-    });
+            if ( state.flags & PARSER_FLAG_NO_CAPTURE ) {
+                return parser_update_result(new_state, parser_result_none());
+            }
 
-    result->p = parser;
+            return parser_update_result(new_state, parser_result_arr(parser_result_buffer_list(&results)));
+        }, PARSER_KIND_SEP_BY);
+
+        /* der trenner wird am knoten selbst abgelegt, content_parser bleibt unverändert
+         * und kann in mehreren Sep_By verwendet werden. */
+        parser_list_reserve(&parser->sequence, 2);
+        parser_push(&parser->sequence, content_parser);
+        parser_push(&parser->sequence, separator_parser);
+
+        return parser;
+    };
 
     return result;
 }
 
 auto
-Sep_By(Parser *separator_parser) {
+Sep_By1(Parser *separator_parser) {
     auto result = [separator_parser](Parser *content_parser) -> Parser* {
-        Parser *parser = parser_create([](Parser *p, Parser_State state) {
-            Parser_Result_List results = {};
+        Parser *parser = parser_create([](Parser *p, const Parser_State &state) {
+            Parser_Result_Buffer results;
+            parser_result_buffer_init(&results, 0);
             Parser_State new_state = state;
+            size_t num_results = 0;
+            uint32_t outer_cut = parser_cut_enter(&new_state);
 
-            auto content_parser = p->p;
-            auto separator_parser = content_parser->p;
+            auto content_parser   = parser_entry(&p->sequence, 0);
+            auto separator_parser = parser_entry(&p->sequence, 1);
+
+            parser_event_emit(&state, PARSER_EVENT_BEGIN_NODE, p, parser_result_none());
+
+            /* new_state steht hinter dem letzten inhalt, next_state vor dem nächsten */
+            Parser_State next_state = new_state;
 
             for ( ;; ) {
-                new_state = content_parser->proc(content_parser, new_state);
+                size_t mark = parser_event_try(&state);
+                Parser_State content_state = parser_call(content_parser, next_state);
+                parser_event_end_try(&state, mark, content_state.success);
+
+                if ( !content_state.success ) {
+                    parser_profile_backtrack(content_parser);
+
+                    if ( parser_committed(&content_state) ) {
+                        parser_result_buffer_free(&results);
+                        parser_event_emit(&state, PARSER_EVENT_END_NODE, p, parser_result_none());
+                        parser_cut_leave(&content_state, outer_cut);
+
+                        return content_state;
+                    }
+
+                    /* sep_by1 meldet den fehler am gescheiterten inhalt */
+                    if ( num_results == 0 ) {
+                        new_state = content_state;
+                    }
 
-                if ( !new_state.success ) {
                     break;
                 }
 
-                parser_result_push(&results, new_state.result);
+                new_state = content_state;
+                new_state.flags &= ~PARSER_FLAG_CUT;
+                num_results += 1;
+
+                if ( !(state.flags & PARSER_FLAG_NO_CAPTURE) ) {
+                    parser_result_buffer_push(&results, new_state.result);
+                }
+
+                /* trenner tauchen im ergebnis nicht auf und melden daher auch keine
+                 * ereignisse. */
+                Parser_State separator_state = new_state;
+                separator_state.flags |= PARSER_FLAG_NO_EVENTS;
+                separator_state = parser_call(separator_parser, separator_state);
+                parser_restore_flags(&separator_state, new_state.flags);
+
+                /* ein abbruch im trenner (tiefe, grenzen) beendet auch das Sep_By */
+                if ( separator_state.flags & PARSER_FLAG_FATAL ) {
+                    parser_result_buffer_free(&results);
+                    parser_event_emit(&state, PARSER_EVENT_END_NODE, p, parser_result_none());
+                    parser_cut_leave(&separator_state, outer_cut);
 
-                Parser_State separator_state = separator_parser->proc(separator_parser, new_state);
+                    return separator_state;
+                }
 
-                if ( !separator_state.success ) {
+                /* ohne fortschritt käme jede weitere wiederholung an dieselbe stelle */
+                if ( !separator_state.success || separator_state.index == next_state.index ) {
                     break;
                 }
 
-                new_state = separator_state;
+                next_state = separator_state;
             }
 
-            return parser_update_result(new_state, parser_result_arr(results));
-        });
+            parser_cut_leave(&new_state, outer_cut);
 
-        content_parser->p = separator_parser;
-        parser->p = content_parser;
+            if ( num_results == 0 ) {
+                parser_result_buffer_free(&results);
+                parser_event_emit(&state, PARSER_EVENT_END_NODE, p, parser_result_none());
+                return parser_update_error(new_state, "sep_by1: kein treffer konnte erzielt werden");
+            }
+
+            parser_event_emit(&state, PARSER_EVENT_END_NODE, p, parser_result_none());
+
+            if ( state.flags & PARSER_FLAG_NO_CAPTURE ) {
+                return parser_update_result(new_state, parser_result_none());
+            }
+
+            return parser_update_result(new_state, parser_result_arr(parser_result_buffer_list(&results)));
+        }, PARSER_KIND_SEP_BY1);
+
+        /* der trenner wird am knoten selbst abgelegt, content_parser bleibt unverändert
+         * und kann in mehreren Sep_By verwendet werden. */
+        parser_list_reserve(&parser->sequence, 2);
+        parser_push(&parser->sequence, content_parser);
+        parser_push(&parser->sequence, separator_parser);
 
         return parser;
     };
@@ -778,48 +4015,248 @@ Sep_By(Parser *separator_parser) {
     return result;
 }
 
-auto
-Sep_By1(Parser *separator_parser) {
-    auto result = [separator_parser](Parser *content_parser) -> Parser* {
-        Parser *parser = parser_create([](Parser *p, Parser_State state) {
-            Parser_Result_List results = {};
-            Parser_State new_state = state;
+struct Parser_Op_Entry {
+    Parser_Op     * op;
+    Parser_Result   token;
+};
 
-            auto content_parser = p->p;
-            auto separator_parser = content_parser->p;
+#define PARSER_OP_INLINE_CAP 16
 
-            for ( ;; ) {
-                new_state = content_parser->proc(content_parser, new_state);
+struct Parser_Op_Stack {
+    Parser_Op_Entry * elems;
+    size_t            num_elems;
+    size_t            cap;
+    Parser_Op_Entry   inline_elems[PARSER_OP_INLINE_CAP];
+};
+
+void
+parser_op_stack_push(Parser_Op_Stack *stack, Parser_Op *op, Parser_Result token) {
+    if ( !stack->elems ) {
+        stack->elems = stack->inline_elems;
+        stack->cap   = PARSER_OP_INLINE_CAP;
+    }
+
+    if ( stack->num_elems >= stack->cap ) {
+        size_t new_cap = stack->cap*2;
+        void *mem = parser_alloc_tagged(sizeof(Parser_Op_Entry)*new_cap, PARSER_ALLOC_OTHER);
+        memcpy(mem, stack->elems, stack->num_elems*sizeof(Parser_Op_Entry));
+
+        if ( stack->elems != stack->inline_elems ) {
+            parser_dealloc(stack->elems);
+        }
+
+        stack->elems = (Parser_Op_Entry *)mem;
+        stack->cap   = new_cap;
+    }
+
+    Parser_Op_Entry *entry = &stack->elems[stack->num_elems++];
+    entry->op    = op;
+    entry->token = token;
+}
+
+void
+parser_op_stack_free(Parser_Op_Stack *stack) {
+    if ( stack->elems && stack->elems != stack->inline_elems ) {
+        parser_dealloc(stack->elems);
+    }
+}
+
+/* versucht die operatoren der gegebenen art der reihe nach an der aktuellen position. */
+Parser_State
+parser_expr_try_op(Parser *p, Parser_Op_Kind kind, const Parser_State &state, Parser_Op **out) {
+    *out = NULL;
+
+    Parser_State op_input = state;
+    uint32_t outer_cut = parser_cut_enter(&op_input);
+
+    for ( int i = 0; i < p->num; ++i ) {
+        Parser_Op *op = &p->ops[i];
+
+        if ( op->kind != kind ) {
+            continue;
+        }
+
+        size_t mark = parser_event_try(&state);
+        Parser_State op_state = parser_call(op->p, op_input);
+
+        /* ein prä- oder postfixoperator, der nichts liest, würde sich endlos
+         * wiederholen und gilt deshalb als nicht vorhanden */
+        bool found = op_state.success && (kind == PARSER_OP_INFIX || op_state.index != state.index);
+        parser_event_end_try(&state, mark, found);
+
+        if ( found ) {
+            parser_cut_leave(&op_state, outer_cut);
+            *out = op;
+            return op_state;
+        }
+
+        /* nach einem cut oder abbruch ist das kein fehlender operator, sondern ein
+         * fehler des ganzen ausdrucks */
+        if ( !op_state.success && parser_committed(&op_state) ) {
+            parser_cut_leave(&op_state, outer_cut);
+            return op_state;
+        }
+    }
+
+    return state;
+}
+
+/* wendet den obersten operator auf die obersten werte an. ohne capture liegen keine
+ * werte auf dem stapel. */
+void
+parser_expr_reduce(Parser *p, Parser_Result_Buffer *values, Parser_Op_Entry *entry, bool capture) {
+    if ( !capture ) {
+        return;
+    }
+
+    Parser_Result_List *list = &values->list;
+    Parser_Result lhs = {};
+    Parser_Result rhs = {};
+
+    if ( entry->op->kind == PARSER_OP_INFIX ) {
+        rhs = list->elems[--list->num_elems];
+        lhs = list->elems[--list->num_elems];
+    } else if ( entry->op->kind == PARSER_OP_PREFIX ) {
+        rhs = list->elems[--list->num_elems];
+    } else {
+        lhs = list->elems[--list->num_elems];
+    }
+
+    Parser_Result r = {};
+    if ( capture && entry->op->build ) {
+        r = entry->op->build(entry->token, lhs, rhs, p->user_data);
+    }
+
+    parser_result_buffer_push(values, r);
+}
+
+/* operatorausdrücke per precedence climbing. operanden und operatoren liegen auf
+ * eigenen stapeln, der ausdruck wird in einem durchgang ohne rekursion je
+ * vorrangstufe gelesen. */
+Parser *
+Expression(Parser *operand, std::initializer_list<Parser_Op> ops) {
+    Parser *p = parser_create([](Parser *p, const Parser_State &state) {
+        if ( !state.success ) {
+            return state;
+        }
+
+        bool capture = !(state.flags & PARSER_FLAG_NO_CAPTURE);
+
+        Parser_Result_Buffer values;
+        parser_result_buffer_init(&values, 0);
+        Parser_Op_Stack stack = {};
+
+        Parser_State new_state = state;
+        Parser_Op *op = NULL;
+
+        for ( ;; ) {
+            Parser_State op_state = parser_expr_try_op(p, PARSER_OP_PREFIX, new_state, &op);
+            if ( !op_state.success ) {
+                parser_result_buffer_free(&values);
+                parser_op_stack_free(&stack);
+
+                return op_state;
+            }
+
+            if ( op ) {
+                parser_op_stack_push(&stack, op, op_state.result);
+                new_state = op_state;
+                continue;
+            }
+
+            new_state = parser_call(p->p, new_state);
+            if ( !new_state.success ) {
+                parser_result_buffer_free(&values);
+                parser_op_stack_free(&stack);
 
-                if ( !new_state.success ) {
+                return new_state;
+            }
+
+            if ( capture ) {
+                parser_result_buffer_push(&values, new_state.result);
+            }
+
+            for ( ;; ) {
+                op_state = parser_expr_try_op(p, PARSER_OP_POSTFIX, new_state, &op);
+                if ( !op ) {
                     break;
                 }
 
-                parser_result_push(&results, new_state.result);
+                while ( stack.num_elems && stack.elems[stack.num_elems-1].op->precedence > op->precedence ) {
+                    parser_expr_reduce(p, &values, &stack.elems[--stack.num_elems], capture);
+                }
+
+                Parser_Op_Entry entry = { op, op_state.result };
+                parser_expr_reduce(p, &values, &entry, capture);
+                new_state = op_state;
+            }
+
+            if ( !op_state.success ) {
+                parser_result_buffer_free(&values);
+                parser_op_stack_free(&stack);
+
+                return op_state;
+            }
+
+            op_state = parser_expr_try_op(p, PARSER_OP_INFIX, new_state, &op);
+            if ( !op_state.success ) {
+                parser_result_buffer_free(&values);
+                parser_op_stack_free(&stack);
+
+                return op_state;
+            }
+
+            if ( !op ) {
+                break;
+            }
+
+            while ( stack.num_elems ) {
+                Parser_Op *top = stack.elems[stack.num_elems-1].op;
+
+                if ( top->precedence == op->precedence && op->assoc == PARSER_ASSOC_NONE &&
+                     top->kind == PARSER_OP_INFIX )
+                {
+                    parser_result_buffer_free(&values);
+                    parser_op_stack_free(&stack);
 
-                Parser_State separator_state = separator_parser->proc(separator_parser, new_state);
+                    return parser_update_error(op_state, "expression: der operator ist nicht assoziativ");
+                }
 
-                if ( !separator_state.success ) {
+                if ( top->precedence < op->precedence ||
+                     top->precedence == op->precedence && op->assoc == PARSER_ASSOC_RIGHT )
+                {
                     break;
                 }
 
-                new_state = separator_state;
+                parser_expr_reduce(p, &values, &stack.elems[--stack.num_elems], capture);
             }
 
-            if ( results.num_elems == 0 ) {
-                return parser_update_error(new_state, "sep_by1: kein treffer konnte erzielt werden");
-            }
+            parser_op_stack_push(&stack, op, op_state.result);
+            new_state = op_state;
+        }
 
-            return parser_update_result(new_state, parser_result_arr(results));
-        });
+        while ( stack.num_elems ) {
+            parser_expr_reduce(p, &values, &stack.elems[--stack.num_elems], capture);
+        }
 
-        content_parser->p = separator_parser;
-        parser->p = content_parser;
+        Parser_Result result = capture ? values.list.elems[0] : parser_result_none();
 
-        return parser;
-    };
+        parser_result_buffer_free(&values);
+        parser_op_stack_free(&stack);
 
-    return result;
+        return parser_update_result(new_state, result);
+    }, PARSER_KIND_EXPRESSION);
+
+    p->p   = operand;
+    p->num = (int)ops.size();
+    p->ops = (Parser_Op *)grammar_alloc(sizeof(Parser_Op)*ops.size());
+
+    int i = 0;
+    for ( Parser_Op op : ops ) {
+        p->ops[i++] = op;
+    }
+
+    return p;
 }
 
 auto
@@ -855,43 +4292,158 @@ fill_empty(Parser *dest, Parser *src) {
 
 Parser_State
 run(Parser *p, char *str) {
+    Parser_Context ctx = {};
     Parser_State state = {};
 
     state.success = true;
     state.val     = str;
     state.index   = 0;
+    parser_limits_attach(&state, &ctx);
 
-    Parser_State result = p->proc(p, state);
+#ifdef PARSER_ALLOC_STATS
+    parser_alloc_stats_reset();
+#endif
+
+    Parser_State result = parser_call(p, state);
+    result.ctx = NULL;
+
+#ifdef PARSER_ALLOC_STATS
+    if ( parser_alloc_stats_report ) {
+        parser_alloc_stats_dump(stdout);
+    }
+#endif
+
+    return result;
+}
+
+/* wie run, aber mit grenzen für schritte, speicher und laufzeit. wird eine davon
+ * überschritten, scheitert der lauf mit PARSER_FLAG_FATAL | PARSER_FLAG_LIMIT und
+ * limits->exceeded nennt die grenze. */
+Parser_State
+run(Parser *p, char *str, Parser_Limits *limits) {
+    Parser_Limits *prev = parser_limits_begin(limits);
+    Parser_State result = run(p, str);
+    parser_limits_end(prev);
+
+    return result;
+}
+
+/* prüft nur ob die eingabe passt und wieviel davon verbraucht wurde. es werden weder
+ * ergebnisse aufgebaut noch fehlermeldungen formatiert. */
+Parser_State
+recognize(Parser *p, char *str) {
+    Parser_Context ctx = {};
+    Parser_State state = {};
+
+    state.success = true;
+    state.val     = str;
+    state.index   = 0;
+    state.flags   = PARSER_FLAG_NO_CAPTURE | PARSER_FLAG_NO_MESSAGES;
+    parser_limits_attach(&state, &ctx);
+
+    Parser_State result = parser_call(p, state);
+    result.ctx = NULL;
+
+    return result;
+}
+
+/* ereignismodus: statt eines ergebnisbaums werden begin_node/value/end_node an den
+ * handler gemeldet, sobald ein zweig feststeht. ereignisse innerhalb von Choice-
+ * alternativen und Many/Sep_By-wiederholungen werden gepuffert, bis der zweig
+ * erfolgreich war, und bei einem fehlschlag verworfen. außerhalb solcher zweige
+ * werden sie sofort ausgeliefert; scheitert der lauf dort, ist er insgesamt
+ * gescheitert. Map-funktionen werden übergangen, trenner und der kopf eines Chain
+ * melden keine ereignisse. der speicherbedarf richtet sich nach dem größten offenen
+ * zweig, nicht nach der länge der eingabe. */
+Parser_State
+run_events(Parser *p, char *str, Parser_Event_Handler *handler) {
+    Parser_Context ctx = {};
+    ctx.handler = handler;
+
+    Parser_State state = {};
+
+    state.success = true;
+    state.val     = str;
+    state.index   = 0;
+    state.flags   = PARSER_FLAG_NO_CAPTURE;
+    state.ctx     = &ctx;
+    parser_limits_attach(&state, &ctx);
+
+    Parser_State result = parser_call(p, state);
+    result.ctx = NULL;
+
+    parser_dealloc(ctx.events.elems);
 
     return result;
 }
 
 namespace api {
     using Urq::Between;
+    using Urq::Adaptive_Choice;
+    using Urq::Capture;
+    using Urq::Chain;
+    using Urq::Chain_Cached;
     using Urq::Choice;
     using Urq::Chr;
+    using Urq::Commit;
+    using Urq::Cut;
     using Urq::Digit;
     using Urq::Digits;
     using Urq::Empty;
+    using Urq::Expression;
     using Urq::Fail;
+    using Urq::Float;
+    using Urq::Integer;
     using Urq::Letters;
+    using Urq::Lexeme;
     using Urq::Many1;
     using Urq::Many;
     using Urq::Number;
     using Urq::Regex;
     using Urq::Sep_By1;
+    using Urq::Skip;
     using Urq::Sep_By;
     using Urq::Seq_Of;
     using Urq::Str;
     using Urq::Succeed;
+    using Urq::Switch;
+    using Urq::Unsigned;
     using Urq::Whitespace;
 
     using Urq::fill_empty;
+    using Urq::parser_max_depth;
+    using Urq::parser_limits_begin;
+    using Urq::parser_limits_end;
+    using Urq::parser_name;
+#ifdef PARSER_ALLOC_STATS
+    using Urq::parser_alloc_stats_dump;
+    using Urq::parser_alloc_stats_reset;
+#endif
+#ifdef PARSER_TRACE
+    using Urq::Parser_Trace;
+    using Urq::parser_trace_begin;
+    using Urq::parser_trace_end;
+    using Urq::parser_trace_free;
+    using Urq::parser_trace_write_binary;
+    using Urq::parser_trace_write_csv;
+    using Urq::parser_trace_write_heatmap;
+#endif
+#ifdef PARSER_PROFILE
+    using Urq::parser_profile_dump;
+    using Urq::parser_profile_reset;
+#endif
+    using Urq::grammar_begin;
+    using Urq::grammar_end;
+    using Urq::grammar_free;
+    using Urq::recognize;
+    using Urq::run_events;
     using Urq::run;
 
     using Urq::parser_result_arr;
     using Urq::parser_result_chr;
     using Urq::parser_result_custom;
+    using Urq::parser_result_none;
+    using Urq::parser_result_f64;
     using Urq::parser_result_s64;
     using Urq::parser_result_str;
     using Urq::parser_result_u64;
@@ -900,9 +4452,29 @@ namespace api {
     using Urq::parser_update_result;
     using Urq::parser_update_state;
 
+    using Urq::Grammar;
     using Urq::Parser;
     using Urq::Parser_State;
     using Urq::Parser_Result;
+    using Urq::Parser_Event_Handler;
+    using Urq::Parser_Kind;
+    using Urq::Parser_Op;
+    using Urq::Parser_Trivia;
+    using Urq::Parser_Case;
+    using Urq::Parser_Limits;
+    using Urq::Parser_Limit;
+
+    using Urq::PARSER_FLAG_NONE;
+    using Urq::PARSER_FLAG_NO_CAPTURE;
+    using Urq::PARSER_FLAG_NO_MESSAGES;
+    using Urq::PARSER_FLAG_FATAL;
+    using Urq::PARSER_FLAG_LIMIT;
+
+    using Urq::PARSER_LIMIT_NONE;
+    using Urq::PARSER_LIMIT_DEPTH;
+    using Urq::PARSER_LIMIT_STEPS;
+    using Urq::PARSER_LIMIT_MEMORY;
+    using Urq::PARSER_LIMIT_TIME;
 };
 
 };
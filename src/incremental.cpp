@@ -0,0 +1,425 @@
+#ifndef __PARSER_COMBINATOR_BASE__
+#include "combinator.cpp"
+#endif
+
+/* erneutes parsen nach änderungen. Memo(p) merkt sich je position das ergebnis von p
+ * samt verbrauchtem bereich. incremental_edit ändert den text, verwirft nur die
+ * einträge, deren bereich die änderung berührt, verschiebt die dahinter liegenden und
+ * parst dann von vorn. an jeder position, an der sich nichts geändert hat, liefert
+ * Memo das alte ergebnis ohne p erneut aufzurufen. neu geparst wird also nur, was die
+ * änderung überdeckt, und die Memo-knoten, die sie umschließen.
+ *
+ * ein eintrag gilt, solange sich nichts vor der stelle ändert, bis zu der p den text
+ * angesehen hat (Parser_Context.examined), bei fehlern ebenso wie bei treffern.
+ * eigene parser, die weiter lesen, als sie über parser_examined melden, brauchen
+ * einen entsprechend größeren lookahead. zeichenketten im ergebnis werden auf den neuen
+ * text umgesetzt, eigene werte und was Map aus dem index berechnet, bleiben wie sie
+ * sind. die ergebnisse früherer läufe werden weiterverwendet und dürfen daher nicht
+ * freigegeben werden, solange das Incremental besteht. */
+
+namespace Urq {
+    struct Parser_Memo_Entry {
+        Parser        * node;
+        size_t          start;
+        size_t          end;       /* index danach, bei fehlern die fehlerstelle */
+        size_t          examined;  /* hinter dem letzten gelesenen byte */
+        bool            success;
+        bool            captured;
+        uint32_t        flags;     /* im knoten gesetzter cut */
+        char          * msg;
+        Parser_Result   result;
+    };
+
+    struct Parser_Memo {
+        Parser_Memo_Entry * entries;
+        size_t              num_entries;
+        size_t              cap;
+
+        uint32_t          * slots;  /* eintrag + 1, 0 ist frei */
+        size_t              num_slots;
+
+        /* einträge liegen in der reihenfolge, in der sie angelegt wurden. ein neuer
+         * lauf fragt sie meist in derselben reihenfolge ab, daher wird zuerst der
+         * nachfolger des letzten treffers geprüft. */
+        size_t              hint;
+
+        /* zähler des letzten laufs */
+        size_t              hits;
+        size_t              misses;
+    };
+
+    struct Incremental {
+        Parser      * root;
+        char        * text;
+        size_t        len;
+        size_t        cap;
+        Parser_Memo   memo;
+    };
+
+    size_t
+    parser_memo_hash(Parser *node, size_t start, bool captured) {
+        uint64_t h = ((uint64_t)(uintptr_t)node >> 4) ^ ((uint64_t)start * 0x9E3779B97F4A7C15ull) ^ captured;
+        h ^= h >> 29;
+
+        return (size_t)h;
+    }
+
+    void
+    parser_memo_rehash(Parser_Memo *memo) {
+        size_t num_slots = 64;
+        while ( num_slots < memo->num_entries*2 + 2 ) {
+            num_slots *= 2;
+        }
+
+        if ( num_slots != memo->num_slots ) {
+            parser_dealloc(memo->slots);
+            memo->slots = (uint32_t *)parser_alloc_tagged(sizeof(uint32_t)*num_slots, PARSER_ALLOC_OTHER);
+            memo->num_slots = num_slots;
+        }
+
+        memset(memo->slots, 0, sizeof(uint32_t)*num_slots);
+
+        for ( size_t i = 0; i < memo->num_entries; ++i ) {
+            Parser_Memo_Entry *e = &memo->entries[i];
+            size_t slot = parser_memo_hash(e->node, e->start, e->captured) & (num_slots - 1);
+
+            while ( memo->slots[slot] ) {
+                slot = (slot + 1) & (num_slots - 1);
+            }
+
+            memo->slots[slot] = (uint32_t)(i + 1);
+        }
+    }
+
+    Parser_Memo_Entry *
+    parser_memo_find(Parser_Memo *memo, Parser *node, size_t start, bool captured) {
+        if ( !memo->num_slots ) {
+            return NULL;
+        }
+
+        for ( size_t i = memo->hint; i < memo->hint + 2 && i < memo->num_entries; ++i ) {
+            Parser_Memo_Entry *e = &memo->entries[i];
+
+            if ( e->node == node && e->start == start && e->captured == captured ) {
+                memo->hint = i + 1;
+                return e;
+            }
+        }
+
+        size_t slot = parser_memo_hash(node, start, captured) & (memo->num_slots - 1);
+
+        while ( memo->slots[slot] ) {
+            Parser_Memo_Entry *e = &memo->entries[memo->slots[slot] - 1];
+
+            if ( e->node == node && e->start == start && e->captured == captured ) {
+                memo->hint = memo->slots[slot];
+                return e;
+            }
+
+            slot = (slot + 1) & (memo->num_slots - 1);
+        }
+
+        return NULL;
+    }
+
+    void
+    parser_memo_add(Parser_Memo *memo, Parser_Memo_Entry entry) {
+        if ( memo->num_entries >= memo->cap ) {
+            size_t cap = (memo->cap < 64) ? 64 : memo->cap*2;
+            void *mem = parser_alloc_tagged(sizeof(Parser_Memo_Entry)*cap, PARSER_ALLOC_OTHER);
+            memcpy(mem, memo->entries, sizeof(Parser_Memo_Entry)*memo->num_entries);
+            parser_dealloc(memo->entries);
+
+            memo->entries = (Parser_Memo_Entry *)mem;
+            memo->cap     = cap;
+        }
+
+        memo->entries[memo->num_entries++] = entry;
+
+        if ( memo->num_entries*2 + 2 > memo->num_slots ) {
+            parser_memo_rehash(memo);
+            return;
+        }
+
+        size_t slot = parser_memo_hash(entry.node, entry.start, entry.captured) & (memo->num_slots - 1);
+        while ( memo->slots[slot] ) {
+            slot = (slot + 1) & (memo->num_slots - 1);
+        }
+
+        memo->slots[slot] = (uint32_t)memo->num_entries;
+    }
+
+    /* merkt sich das ergebnis von p je position, solange in einem Incremental geparst
+     * wird. lookahead ist die zahl der bytes, die p über das gemeldete hinaus
+     * höchstens ansieht. außerhalb von incremental_begin/edit wird p nur aufgerufen. */
+    Parser *
+    Memo(Parser *parser, int lookahead = 1) {
+        Parser *result = parser_create([](Parser *p, const Parser_State &state) {
+            Parser_Memo *memo = state.ctx ? state.ctx->memo : NULL;
+
+            if ( !memo || !state.success ) {
+                return parser_call(p->p, state);
+            }
+
+            bool captured = !(state.flags & PARSER_FLAG_NO_CAPTURE);
+            Parser_Memo_Entry *e = parser_memo_find(memo, p, state.index, captured);
+
+            if ( e ) {
+                memo->hits += 1;
+
+                Parser_State result = state;
+                result.success = e->success;
+                result.index   = e->end;
+                result.flags  |= e->flags;
+                result.msg     = e->msg;
+
+                if ( e->success ) {
+                    result.result = e->result;
+                }
+
+                parser_examined(state, e->examined);
+
+                return result;
+            }
+
+            memo->misses += 1;
+
+            size_t outer = state.ctx->examined;
+            state.ctx->examined = 0;
+
+            Parser_State result = parser_call(p->p, state);
+
+            size_t examined = state.ctx->examined;
+            state.ctx->examined = (outer > examined) ? outer : examined;
+
+            /* ein abbruch hängt von der tiefe ab, nicht vom text */
+            if ( !(result.flags & PARSER_FLAG_FATAL) ) {
+                Parser_Memo_Entry entry = {};
+                entry.node     = p;
+                entry.start    = state.index;
+                entry.end      = result.index;
+                entry.examined = examined;
+                entry.success  = result.success;
+                entry.captured = captured;
+                entry.flags    = result.flags & ~state.flags & PARSER_FLAG_CUT;
+                entry.msg      = result.msg;
+                entry.result   = result.result;
+
+                parser_memo_add(memo, entry);
+            }
+
+            return result;
+        }, PARSER_KIND_MEMO);
+
+        result->p   = parser;
+        result->num = (lookahead < 0) ? 0 : lookahead;
+
+        return result;
+    }
+
+    /* ---------------------------------------------------------------------------------- */
+
+    /* setzt zeichenketten aus dem alten text auf den neuen um. listen können von
+     * mehreren einträgen geteilt werden und werden nur einmal angefaßt. */
+    struct Parser_Rebase {
+        char            * old_text;
+        size_t            old_len;
+        char            * text;
+        size_t            offset;
+        size_t            removed;
+        ptrdiff_t         delta;
+
+        Parser_Result  ** visited;
+        size_t            num_visited;
+        size_t            cap;
+    };
+
+    bool
+    parser_rebase_visit(Parser_Rebase *rb, Parser_Result *elems) {
+        if ( (rb->num_visited + 1)*2 > rb->cap ) {
+            size_t cap = (rb->cap < 64) ? 64 : rb->cap*2;
+            Parser_Result **visited = (Parser_Result **)parser_alloc_tagged(sizeof(Parser_Result *)*cap, PARSER_ALLOC_OTHER);
+            memset(visited, 0, sizeof(Parser_Result *)*cap);
+
+            for ( size_t i = 0; i < rb->cap; ++i ) {
+                if ( !rb->visited[i] ) {
+                    continue;
+                }
+
+                size_t j = ((uintptr_t)rb->visited[i] >> 4) & (cap - 1);
+                while ( visited[j] ) {
+                    j = (j + 1) & (cap - 1);
+                }
+                visited[j] = rb->visited[i];
+            }
+
+            parser_dealloc(rb->visited);
+            rb->visited = visited;
+            rb->cap     = cap;
+        }
+
+        size_t i = ((uintptr_t)elems >> 4) & (rb->cap - 1);
+        while ( rb->visited[i] ) {
+            if ( rb->visited[i] == elems ) {
+                return false;
+            }
+
+            i = (i + 1) & (rb->cap - 1);
+        }
+
+        rb->visited[i] = elems;
+        rb->num_visited += 1;
+
+        return true;
+    }
+
+    void
+    parser_rebase_result(Parser_Rebase *rb, Parser_Result *r) {
+        if ( r->kind == PARSER_RESULT_STR && r->str.val ) {
+            char *s = r->str.val;
+
+            if ( s >= rb->old_text && s < rb->old_text + rb->offset ) {
+                r->str.val = rb->text + (s - rb->old_text);
+            } else if ( s >= rb->old_text + rb->offset + rb->removed && s <= rb->old_text + rb->old_len ) {
+                r->str.val = rb->text + (s - rb->old_text) + rb->delta;
+            }
+
+            return;
+        }
+
+        if ( r->kind == PARSER_RESULT_ARR && r->arr.val.elems ) {
+            if ( !parser_rebase_visit(rb, r->arr.val.elems) ) {
+                return;
+            }
+
+            for ( size_t i = 0; i < r->arr.val.num_elems; ++i ) {
+                parser_rebase_result(rb, &r->arr.val.elems[i]);
+            }
+        }
+    }
+
+    Parser_State
+    incremental_run(Incremental *inc) {
+        Parser_Context ctx = {};
+        ctx.memo = &inc->memo;
+
+        Parser_State state = {};
+
+        state.success = true;
+        state.val     = inc->text;
+        state.index   = 0;
+        state.ctx     = &ctx;
+        parser_limits_attach(&state, &ctx);
+
+        inc->memo.hits   = 0;
+        inc->memo.misses = 0;
+        inc->memo.hint   = 0;
+
+        Parser_State result = parser_call(inc->root, state);
+        result.ctx = NULL;
+
+        return result;
+    }
+
+    /* parst text vollständig und merkt sich dabei die ergebnisse aller Memo-knoten.
+     * text wird kopiert. */
+    Parser_State
+    incremental_begin(Incremental *inc, Parser *root, char *text) {
+        *inc = {};
+
+        inc->root = root;
+        inc->len  = strlen(text);
+        inc->cap  = inc->len + 1;
+        inc->text = (char *)parser_alloc_tagged(inc->cap, PARSER_ALLOC_OTHER);
+        memcpy(inc->text, text, inc->len + 1);
+
+        return incremental_run(inc);
+    }
+
+    /* ersetzt removed bytes ab offset durch inserted und parst erneut. ergebnisse des
+     * vorigen laufs zeigen danach in den neuen text. */
+    Parser_State
+    incremental_edit(Incremental *inc, size_t offset, size_t removed, char *inserted) {
+        offset  = (offset > inc->len) ? inc->len : offset;
+        removed = (removed > inc->len - offset) ? inc->len - offset : removed;
+
+        size_t inserted_len = strlen(inserted);
+        size_t len = inc->len - removed + inserted_len;
+
+        char *old_text = inc->text;
+        char *text = old_text;
+
+        if ( len + 1 > inc->cap ) {
+            inc->cap = (inc->cap*2 > len + 1) ? inc->cap*2 : len + 1;
+            text = (char *)parser_alloc_tagged(inc->cap, PARSER_ALLOC_OTHER);
+            memcpy(text, old_text, offset);
+        }
+
+        memmove(text + offset + inserted_len, old_text + offset + removed, inc->len - offset - removed + 1);
+        memcpy(text + offset, inserted, inserted_len);
+
+        Parser_Rebase rb = {};
+        rb.old_text = old_text;
+        rb.old_len  = inc->len;
+        rb.text     = text;
+        rb.offset   = offset;
+        rb.removed  = removed;
+        rb.delta    = (ptrdiff_t)inserted_len - (ptrdiff_t)removed;
+
+        /* was nur davor gelesen hat, bleibt stehen, was dahinter beginnt, wird
+         * verschoben, der rest verworfen */
+        Parser_Memo *memo = &inc->memo;
+        size_t kept = 0;
+
+        for ( size_t i = 0; i < memo->num_entries; ++i ) {
+            Parser_Memo_Entry e = memo->entries[i];
+            size_t lookahead = (size_t)e.node->num;
+
+            if ( e.examined + lookahead <= offset ) {
+                if ( text != old_text ) {
+                    parser_rebase_result(&rb, &e.result);
+                }
+            } else if ( e.start >= offset + removed ) {
+                e.start    += rb.delta;
+                e.end      += rb.delta;
+                e.examined += rb.delta;
+                parser_rebase_result(&rb, &e.result);
+            } else {
+                continue;
+            }
+
+            memo->entries[kept++] = e;
+        }
+
+        memo->num_entries = kept;
+        parser_memo_rehash(memo);
+
+        parser_dealloc(rb.visited);
+
+        if ( text != old_text ) {
+            parser_dealloc(old_text);
+        }
+
+        inc->text = text;
+        inc->len  = len;
+
+        return incremental_run(inc);
+    }
+
+    void
+    incremental_free(Incremental *inc) {
+        parser_dealloc(inc->text);
+        parser_dealloc(inc->memo.entries);
+        parser_dealloc(inc->memo.slots);
+
+        *inc = {};
+    }
+
+    namespace api {
+        using Urq::Incremental;
+        using Urq::Memo;
+        using Urq::incremental_begin;
+        using Urq::incremental_edit;
+        using Urq::incremental_free;
+    }
+}
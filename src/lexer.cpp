@@ -0,0 +1,843 @@
+#ifndef __PARSER_COMBINATOR_BASE__
+#include "combinator.cpp"
+#endif
+
+#ifndef __PARSER_LEXER__
+#define __PARSER_LEXER__
+
+/* zweistufiges parsen: ein lexer zerlegt die eingabe in einem durchgang in tokens, die
+ * kombinatoren Token und Token_Text arbeiten anschließend auf dieser liste. beim
+ * zurücksetzen wird dann nur noch ein index verglichen, die bytes werden nicht erneut
+ * gelesen.
+ *
+ * die regeln des lexers sind einfache reguläre ausdrücke:
+ *
+ *     abc       zeichen stehen für sich selbst
+ *     [a-z_]    zeichenklasse, [^...] negiert
+ *     .         jedes zeichen außer '\n'
+ *     \d \w \s  ziffern, wortzeichen, leerraum; \n \t \r und \x für sonderzeichen x
+ *     ( | )     gruppen und alternativen
+ *     * + ?     wiederholungen
+ *
+ * alle regeln werden zu einem gemeinsamen DFA zusammengefaßt. es gewinnt der längste
+ * treffer, bei gleicher länge die frühere regel. */
+
+namespace Urq {
+    enum Lexer_Rule_Flags {
+        LEXER_RULE_NONE = 0,
+        LEXER_RULE_SKIP = 1 << 0, /* treffer werden nicht in die tokenliste übernommen */
+    };
+
+    struct Lexer_Rule {
+        int32_t   kind;
+        char    * pattern;
+        uint32_t  flags;
+    };
+
+    struct Lexer_Token {
+        int32_t  kind;
+        uint32_t start;
+        uint32_t len;
+    };
+
+    struct Lexer_Token_List {
+        Lexer_Token * elems;
+        size_t        num_elems;
+        size_t        cap;
+    };
+
+    /* zustand 0 ist der tote zustand, zustand 1 der startzustand. */
+    struct Lexer {
+        uint8_t      classes[256]; /* byte -> äquivalenzklasse */
+        uint32_t     num_classes;
+        uint32_t     num_states;
+        int32_t    * next;         /* num_states * num_classes übergänge */
+        int32_t    * accept;       /* regel je zustand, -1 wenn keiner akzeptiert */
+
+        Lexer_Rule * rules;
+        size_t       num_rules;
+
+        char       * msg;          /* fehler beim übersetzen der regeln */
+    };
+
+    void
+    lexer_token_reserve(Lexer_Token_List *list, size_t cap) {
+        if ( cap <= list->cap ) {
+            return;
+        }
+
+        void *mem = parser_alloc_tagged(sizeof(Lexer_Token)*cap, PARSER_ALLOC_TOKENS);
+        memcpy(mem, list->elems, list->num_elems*sizeof(Lexer_Token));
+        parser_dealloc(list->elems);
+
+        list->elems = (Lexer_Token *)mem;
+        list->cap   = cap;
+    }
+
+    void
+    lexer_token_push(Lexer_Token_List *list, Lexer_Token token) {
+        if ( list->num_elems >= list->cap ) {
+            lexer_token_reserve(list, (list->cap < 64) ? 64 : list->cap*2);
+        }
+
+        list->elems[list->num_elems++] = token;
+    }
+
+    void
+    lexer_token_free(Lexer_Token_List *list) {
+        parser_dealloc(list->elems);
+
+        list->elems     = NULL;
+        list->num_elems = 0;
+        list->cap       = 0;
+    }
+
+    /* nfa nach thompson. jedes fragment hat genau einen anfang und ein leeres ende,
+     * dessen out beim verketten gesetzt wird. */
+    enum Lexer_Nfa_Kind {
+        LEXER_NFA_SET,    /* ein zeichen aus set */
+        LEXER_NFA_SPLIT,  /* epsilon nach out und out1, out1 < 0 für einfaches epsilon */
+        LEXER_NFA_ACCEPT,
+    };
+
+    struct Lexer_Nfa_State {
+        Lexer_Nfa_Kind kind;
+        int32_t        out;
+        int32_t        out1;
+        int32_t        rule;
+        uint32_t       set[8];
+    };
+
+    struct Lexer_Nfa {
+        Lexer_Nfa_State * elems;
+        size_t            num_elems;
+        size_t            cap;
+    };
+
+    struct Lexer_Frag {
+        int32_t start;
+        int32_t end;
+    };
+
+    struct Lexer_Compiler {
+        Lexer_Nfa   nfa;
+        char      * pattern;
+        char      * pos;
+        char      * msg;
+    };
+
+    int32_t
+    lexer_nfa_add(Lexer_Nfa *nfa, Lexer_Nfa_Kind kind, int32_t out, int32_t out1) {
+        if ( nfa->num_elems >= nfa->cap ) {
+            size_t cap = (nfa->cap < 32) ? 32 : nfa->cap*2;
+
+            void *mem = parser_alloc(sizeof(Lexer_Nfa_State)*cap);
+            memcpy(mem, nfa->elems, nfa->num_elems*sizeof(Lexer_Nfa_State));
+            parser_dealloc(nfa->elems);
+
+            nfa->elems = (Lexer_Nfa_State *)mem;
+            nfa->cap   = cap;
+        }
+
+        Lexer_Nfa_State *state = nfa->elems + nfa->num_elems;
+        memset(state, 0, sizeof(Lexer_Nfa_State));
+
+        state->kind = kind;
+        state->out  = out;
+        state->out1 = out1;
+        state->rule = -1;
+
+        return (int32_t)nfa->num_elems++;
+    }
+
+    void
+    lexer_set_add(uint32_t *set, uint8_t c) {
+        set[c >> 5] |= 1u << (c & 31);
+    }
+
+    bool
+    lexer_set_has(uint32_t *set, uint8_t c) {
+        bool result = (set[c >> 5] >> (c & 31)) & 1;
+
+        return result;
+    }
+
+    void
+    lexer_set_escape(uint32_t *set, char c) {
+        switch ( c ) {
+            case 'd': {
+                for ( int i = '0'; i <= '9'; ++i ) lexer_set_add(set, i);
+            } break;
+
+            case 'w': {
+                for ( int i = '0'; i <= '9'; ++i ) lexer_set_add(set, i);
+                for ( int i = 'a'; i <= 'z'; ++i ) lexer_set_add(set, i);
+                for ( int i = 'A'; i <= 'Z'; ++i ) lexer_set_add(set, i);
+                lexer_set_add(set, '_');
+            } break;
+
+            case 's': {
+                lexer_set_add(set, ' ');
+                lexer_set_add(set, '\t');
+                lexer_set_add(set, '\n');
+                lexer_set_add(set, '\r');
+                lexer_set_add(set, '\f');
+                lexer_set_add(set, '\v');
+            } break;
+
+            case 'n': lexer_set_add(set, '\n'); break;
+            case 't': lexer_set_add(set, '\t'); break;
+            case 'r': lexer_set_add(set, '\r'); break;
+
+            default: {
+                lexer_set_add(set, (uint8_t)c);
+            } break;
+        }
+    }
+
+    Lexer_Frag
+    lexer_frag_empty(Lexer_Compiler *c) {
+        int32_t e = lexer_nfa_add(&c->nfa, LEXER_NFA_SPLIT, -1, -1);
+        Lexer_Frag result = { e, e };
+
+        return result;
+    }
+
+    Lexer_Frag
+    lexer_frag_set(Lexer_Compiler *c, uint32_t *set) {
+        int32_t e = lexer_nfa_add(&c->nfa, LEXER_NFA_SPLIT, -1, -1);
+        int32_t s = lexer_nfa_add(&c->nfa, LEXER_NFA_SET, e, -1);
+
+        /* das nullbyte beendet die eingabe und wird nie gelesen */
+        memcpy(c->nfa.elems[s].set, set, sizeof(c->nfa.elems[s].set));
+        c->nfa.elems[s].set[0] &= ~1u;
+
+        Lexer_Frag result = { s, e };
+
+        return result;
+    }
+
+    Lexer_Frag lexer_compile_alt(Lexer_Compiler *c);
+
+    Lexer_Frag
+    lexer_compile_atom(Lexer_Compiler *c) {
+        uint32_t set[8] = {};
+        char ch = *c->pos++;
+
+        switch ( ch ) {
+            case '(': {
+                Lexer_Frag result = lexer_compile_alt(c);
+
+                if ( *c->pos != ')' ) {
+                    c->msg = "Lexer: ')' erwartet";
+                    return result;
+                }
+
+                c->pos++;
+
+                return result;
+            } break;
+
+            case '[': {
+                bool negate = false;
+                if ( *c->pos == '^' ) {
+                    negate = true;
+                    c->pos++;
+                }
+
+                bool first = true;
+                while ( *c->pos && (*c->pos != ']' || first) ) {
+                    first = false;
+                    uint8_t lo = (uint8_t)*c->pos++;
+
+                    if ( lo == '\\' && *c->pos ) {
+                        lexer_set_escape(set, *c->pos++);
+                        continue;
+                    }
+
+                    if ( c->pos[0] == '-' && c->pos[1] && c->pos[1] != ']' ) {
+                        uint8_t hi = (uint8_t)c->pos[1];
+                        c->pos += 2;
+
+                        for ( int i = lo; i <= hi; ++i ) {
+                            lexer_set_add(set, (uint8_t)i);
+                        }
+
+                        continue;
+                    }
+
+                    lexer_set_add(set, lo);
+                }
+
+                if ( *c->pos != ']' ) {
+                    c->msg = "Lexer: ']' erwartet";
+                    return lexer_frag_empty(c);
+                }
+
+                c->pos++;
+
+                if ( negate ) {
+                    for ( int i = 0; i < 8; ++i ) {
+                        set[i] = ~set[i];
+                    }
+                }
+            } break;
+
+            case '.': {
+                for ( int i = 0; i < 8; ++i ) {
+                    set[i] = ~0u;
+                }
+
+                set['\n' >> 5] &= ~(1u << ('\n' & 31));
+            } break;
+
+            case '\\': {
+                if ( !*c->pos ) {
+                    c->msg = "Lexer: unvollständige escape-sequenz";
+                    return lexer_frag_empty(c);
+                }
+
+                lexer_set_escape(set, *c->pos++);
+            } break;
+
+            case '*': case '+': case '?': case ')': case '|': {
+                c->msg = "Lexer: unerwartetes zeichen im ausdruck";
+                return lexer_frag_empty(c);
+            } break;
+
+            default: {
+                lexer_set_add(set, (uint8_t)ch);
+            } break;
+        }
+
+        return lexer_frag_set(c, set);
+    }
+
+    Lexer_Frag
+    lexer_compile_repeat(Lexer_Compiler *c) {
+        Lexer_Frag result = lexer_compile_atom(c);
+
+        while ( !c->msg && (*c->pos == '*' || *c->pos == '+' || *c->pos == '?') ) {
+            char op = *c->pos++;
+            int32_t e = lexer_nfa_add(&c->nfa, LEXER_NFA_SPLIT, -1, -1);
+            int32_t s = lexer_nfa_add(&c->nfa, LEXER_NFA_SPLIT, result.start, e);
+
+            if ( op == '?' ) {
+                c->nfa.elems[result.end].out = e;
+            } else {
+                c->nfa.elems[result.end].out = s;
+            }
+
+            result.start = (op == '+') ? result.start : s;
+            result.end   = e;
+        }
+
+        return result;
+    }
+
+    Lexer_Frag
+    lexer_compile_concat(Lexer_Compiler *c) {
+        Lexer_Frag result = lexer_frag_empty(c);
+
+        while ( !c->msg && *c->pos && *c->pos != '|' && *c->pos != ')' ) {
+            Lexer_Frag next = lexer_compile_repeat(c);
+
+            c->nfa.elems[result.end].out = next.start;
+            result.end = next.end;
+        }
+
+        return result;
+    }
+
+    Lexer_Frag
+    lexer_compile_alt(Lexer_Compiler *c) {
+        Lexer_Frag result = lexer_compile_concat(c);
+
+        while ( !c->msg && *c->pos == '|' ) {
+            c->pos++;
+
+            Lexer_Frag next = lexer_compile_concat(c);
+            int32_t e = lexer_nfa_add(&c->nfa, LEXER_NFA_SPLIT, -1, -1);
+            int32_t s = lexer_nfa_add(&c->nfa, LEXER_NFA_SPLIT, result.start, next.start);
+
+            c->nfa.elems[result.end].out = e;
+            c->nfa.elems[next.end].out   = e;
+
+            result.start = s;
+            result.end   = e;
+        }
+
+        return result;
+    }
+
+    /* eine menge von nfa-zuständen, die einen zustand des DFA bildet. enthält nur
+     * SET- und ACCEPT-zustände, aufsteigend sortiert. */
+    struct Lexer_Dfa_Key {
+        int32_t  * elems;
+        size_t     num_elems;
+        uint64_t   hash;
+    };
+
+    struct Lexer_Builder {
+        Lexer_Nfa       * nfa;
+
+        Lexer_Dfa_Key   * keys;
+        size_t            num_keys;
+        size_t            cap_keys;
+
+        int32_t         * next;
+        int32_t         * accept;
+
+        /* arbeitsspeicher für die epsilon-hülle */
+        int32_t         * stack;
+        int32_t         * set;
+        uint32_t        * mark;
+        uint32_t          generation;
+    };
+
+    void
+    lexer_closure_push(Lexer_Builder *b, int32_t s, size_t *num_stack) {
+        if ( s < 0 || b->mark[s] == b->generation ) {
+            return;
+        }
+
+        b->mark[s] = b->generation;
+        b->stack[(*num_stack)++] = s;
+    }
+
+    /* berechnet die epsilon-hülle der zustände in b->stack und liefert die relevanten
+     * zustände sortiert in b->set. */
+    size_t
+    lexer_closure(Lexer_Builder *b, size_t num_stack) {
+        size_t num_set = 0;
+
+        while ( num_stack > 0 ) {
+            int32_t s = b->stack[--num_stack];
+            Lexer_Nfa_State *state = b->nfa->elems + s;
+
+            if ( state->kind == LEXER_NFA_SPLIT ) {
+                lexer_closure_push(b, state->out, &num_stack);
+                lexer_closure_push(b, state->out1, &num_stack);
+            } else {
+                b->set[num_set++] = s;
+            }
+        }
+
+        /* die mengen sind klein, einfügen genügt */
+        for ( size_t i = 1; i < num_set; ++i ) {
+            int32_t v = b->set[i];
+            size_t j = i;
+
+            while ( j > 0 && b->set[j-1] > v ) {
+                b->set[j] = b->set[j-1];
+                j -= 1;
+            }
+
+            b->set[j] = v;
+        }
+
+        return num_set;
+    }
+
+    /* liefert den DFA-zustand für b->set und legt ihn bei bedarf an. */
+    int32_t
+    lexer_dfa_state(Lexer_Builder *b, size_t num_set, uint32_t num_classes) {
+        if ( num_set == 0 ) {
+            return 0;
+        }
+
+        uint64_t hash = 14695981039346656037ull;
+        for ( size_t i = 0; i < num_set; ++i ) {
+            hash = (hash ^ (uint64_t)b->set[i]) * 1099511628211ull;
+        }
+
+        for ( size_t i = 1; i < b->num_keys; ++i ) {
+            Lexer_Dfa_Key *key = b->keys + i;
+
+            if ( key->hash == hash && key->num_elems == num_set &&
+                    memcmp(key->elems, b->set, num_set*sizeof(int32_t)) == 0 )
+            {
+                return (int32_t)i;
+            }
+        }
+
+        if ( b->num_keys >= b->cap_keys ) {
+            size_t cap = b->cap_keys*2;
+
+            Lexer_Dfa_Key *keys = (Lexer_Dfa_Key *)parser_alloc(sizeof(Lexer_Dfa_Key)*cap);
+            memcpy(keys, b->keys, b->num_keys*sizeof(Lexer_Dfa_Key));
+            parser_dealloc(b->keys);
+
+            int32_t *next = (int32_t *)parser_alloc(sizeof(int32_t)*cap*num_classes);
+            memcpy(next, b->next, b->num_keys*num_classes*sizeof(int32_t));
+            parser_dealloc(b->next);
+
+            int32_t *accept = (int32_t *)parser_alloc(sizeof(int32_t)*cap);
+            memcpy(accept, b->accept, b->num_keys*sizeof(int32_t));
+            parser_dealloc(b->accept);
+
+            b->keys     = keys;
+            b->next     = next;
+            b->accept   = accept;
+            b->cap_keys = cap;
+        }
+
+        Lexer_Dfa_Key *key = b->keys + b->num_keys;
+        key->elems     = (int32_t *)parser_alloc(sizeof(int32_t)*num_set);
+        key->num_elems = num_set;
+        key->hash      = hash;
+        memcpy(key->elems, b->set, num_set*sizeof(int32_t));
+
+        int32_t rule = -1;
+        for ( size_t i = 0; i < num_set; ++i ) {
+            Lexer_Nfa_State *state = b->nfa->elems + b->set[i];
+
+            if ( state->kind == LEXER_NFA_ACCEPT && (rule < 0 || state->rule < rule) ) {
+                rule = state->rule;
+            }
+        }
+
+        b->accept[b->num_keys] = rule;
+
+        return (int32_t)b->num_keys++;
+    }
+
+    /* teilt die bytes in klassen, die von allen zeichenmengen gleich behandelt werden.
+     * die übergangstabelle braucht dann nur eine spalte je klasse. */
+    uint32_t
+    lexer_byte_classes(Lexer_Nfa *nfa, uint8_t *classes) {
+        uint32_t num_classes = 1;
+        memset(classes, 0, 256);
+
+        for ( size_t i = 0; i < nfa->num_elems; ++i ) {
+            Lexer_Nfa_State *state = nfa->elems + i;
+
+            if ( state->kind != LEXER_NFA_SET ) {
+                continue;
+            }
+
+            int16_t map[2][256];
+            memset(map, -1, sizeof(map));
+            uint32_t new_num = 0;
+
+            for ( int c = 0; c < 256; ++c ) {
+                int in = lexer_set_has(state->set, (uint8_t)c) ? 1 : 0;
+
+                if ( map[in][classes[c]] < 0 ) {
+                    map[in][classes[c]] = (int16_t)new_num++;
+                }
+
+                classes[c] = (uint8_t)map[in][classes[c]];
+            }
+
+            num_classes = new_num;
+        }
+
+        return num_classes;
+    }
+
+    /* übersetzt die regeln in einen gemeinsamen DFA. tabellen und regeln liegen in der
+     * aktiven grammatik. ungültige ausdrücke werden in msg vermerkt, run_tokens scheitert
+     * dann mit dieser meldung. */
+    Lexer *
+    lexer_create(std::initializer_list<Lexer_Rule> rules) {
+        Lexer *result = (Lexer *)grammar_alloc(sizeof(Lexer));
+        memset(result, 0, sizeof(Lexer));
+
+        result->num_rules = rules.size();
+        result->rules     = (Lexer_Rule *)grammar_alloc(sizeof(Lexer_Rule)*rules.size());
+
+        Lexer_Compiler c = {};
+        int32_t start = lexer_nfa_add(&c.nfa, LEXER_NFA_SPLIT, -1, -1);
+        int32_t last  = start;
+
+        size_t i = 0;
+        for ( Lexer_Rule rule : rules ) {
+            result->rules[i] = rule;
+
+            c.pattern = rule.pattern;
+            c.pos     = rule.pattern;
+
+            Lexer_Frag frag = lexer_compile_alt(&c);
+
+            if ( !c.msg && *c.pos ) {
+                c.msg = "Lexer: unerwartetes zeichen im ausdruck";
+            }
+
+            if ( c.msg ) {
+                break;
+            }
+
+            int32_t accept = lexer_nfa_add(&c.nfa, LEXER_NFA_ACCEPT, -1, -1);
+            c.nfa.elems[accept].rule = (int32_t)i;
+            c.nfa.elems[frag.end].out = accept;
+
+            /* alle regeln hängen an einer kette von epsilon-übergängen am start */
+            int32_t next = lexer_nfa_add(&c.nfa, LEXER_NFA_SPLIT, -1, -1);
+            c.nfa.elems[last].out  = frag.start;
+            c.nfa.elems[last].out1 = next;
+            last = next;
+
+            i += 1;
+        }
+
+        if ( c.msg ) {
+            result->msg = c.msg;
+            parser_dealloc(c.nfa.elems);
+
+            return result;
+        }
+
+        uint32_t num_classes = lexer_byte_classes(&c.nfa, result->classes);
+        result->num_classes = num_classes;
+
+        /* ein vertreter je klasse genügt für die übergänge */
+        uint8_t representative[256];
+        for ( int ch = 255; ch >= 0; --ch ) {
+            representative[result->classes[ch]] = (uint8_t)ch;
+        }
+
+        Lexer_Builder b = {};
+        b.nfa      = &c.nfa;
+        b.cap_keys = 16;
+        b.keys     = (Lexer_Dfa_Key *)parser_alloc(sizeof(Lexer_Dfa_Key)*b.cap_keys);
+        b.next     = (int32_t *)parser_alloc(sizeof(int32_t)*b.cap_keys*num_classes);
+        b.accept   = (int32_t *)parser_alloc(sizeof(int32_t)*b.cap_keys);
+        b.stack    = (int32_t *)parser_alloc(sizeof(int32_t)*c.nfa.num_elems);
+        b.set      = (int32_t *)parser_alloc(sizeof(int32_t)*c.nfa.num_elems);
+        b.mark     = (uint32_t *)parser_alloc(sizeof(uint32_t)*c.nfa.num_elems);
+        memset(b.mark, 0, sizeof(uint32_t)*c.nfa.num_elems);
+
+        /* der tote zustand */
+        b.keys[0]   = {};
+        b.accept[0] = -1;
+        b.num_keys  = 1;
+
+        b.generation += 1;
+        size_t num_stack = 0;
+        lexer_closure_push(&b, start, &num_stack);
+        lexer_dfa_state(&b, lexer_closure(&b, num_stack), num_classes);
+
+        for ( size_t s = 0; s < b.num_keys; ++s ) {
+            for ( uint32_t cls = 0; cls < num_classes; ++cls ) {
+                uint8_t ch = representative[cls];
+
+                b.generation += 1;
+                num_stack = 0;
+
+                Lexer_Dfa_Key *key = b.keys + s;
+                for ( size_t k = 0; k < key->num_elems; ++k ) {
+                    Lexer_Nfa_State *state = c.nfa.elems + key->elems[k];
+
+                    if ( state->kind == LEXER_NFA_SET && lexer_set_has(state->set, ch) ) {
+                        lexer_closure_push(&b, state->out, &num_stack);
+                    }
+                }
+
+                int32_t target = lexer_dfa_state(&b, lexer_closure(&b, num_stack), num_classes);
+                b.next[s*num_classes + cls] = target;
+            }
+        }
+
+        result->num_states = (uint32_t)b.num_keys;
+        result->next   = (int32_t *)grammar_alloc(sizeof(int32_t)*b.num_keys*num_classes);
+        result->accept = (int32_t *)grammar_alloc(sizeof(int32_t)*b.num_keys);
+        memcpy(result->next, b.next, sizeof(int32_t)*b.num_keys*num_classes);
+        memcpy(result->accept, b.accept, sizeof(int32_t)*b.num_keys);
+
+        for ( size_t s = 0; s < b.num_keys; ++s ) {
+            parser_dealloc(b.keys[s].elems);
+        }
+
+        parser_dealloc(b.keys);
+        parser_dealloc(b.next);
+        parser_dealloc(b.accept);
+        parser_dealloc(b.stack);
+        parser_dealloc(b.set);
+        parser_dealloc(b.mark);
+        parser_dealloc(c.nfa.elems);
+
+        return result;
+    }
+
+    /* zerlegt str in tokens. bei einem zeichen, mit dem keine regel beginnt, wird false
+     * geliefert und die position in error_index abgelegt. */
+    bool
+    lexer_run(Lexer *lexer, char *str, Lexer_Token_List *tokens, size_t *error_index) {
+        if ( lexer->msg ) {
+            *error_index = 0;
+            return false;
+        }
+
+        uint32_t  num_classes = lexer->num_classes;
+        int32_t * next        = lexer->next;
+        int32_t * accept      = lexer->accept;
+        uint8_t * classes     = lexer->classes;
+
+        size_t pos = 0;
+        while ( str[pos] ) {
+            int32_t s    = 1;
+            int32_t rule = -1;
+            size_t  end  = pos;
+
+            /* das nullbyte führt immer in den toten zustand */
+            for ( size_t i = pos; ; ) {
+                s = next[s*num_classes + classes[(uint8_t)str[i]]];
+                if ( s == 0 ) {
+                    break;
+                }
+
+                i += 1;
+
+                if ( accept[s] >= 0 ) {
+                    rule = accept[s];
+                    end  = i;
+                }
+            }
+
+            if ( rule < 0 ) {
+                *error_index = pos;
+                return false;
+            }
+
+            if ( !(lexer->rules[rule].flags & LEXER_RULE_SKIP) ) {
+                Lexer_Token token = { lexer->rules[rule].kind, (uint32_t)pos, (uint32_t)(end - pos) };
+                lexer_token_push(tokens, token);
+            }
+
+            pos = end;
+        }
+
+        return true;
+    }
+
+    Lexer_Token *
+    parser_token(const Parser_State *state) {
+        Lexer_Token_List *tokens = state->ctx ? state->ctx->tokens : NULL;
+
+        if ( !tokens || state->index >= tokens->num_elems ) {
+            return NULL;
+        }
+
+        return tokens->elems + state->index;
+    }
+
+    /* erkennt ein token der art kind. ergebnis ist der text des tokens. */
+    Parser *
+    Token(int32_t kind) {
+        Parser *p = parser_create([](Parser *p, const Parser_State &state) {
+            if ( !state.success ) {
+                return state;
+            }
+
+            Lexer_Token *token = parser_token(&state);
+
+            if ( !token ) {
+                return parser_update_error(state, "Token: unerwartet das ende erreicht");
+            }
+
+            if ( token->kind != p->num ) {
+                return parser_update_error(state, "Token: art %d erwartet, aber %d erhalten",
+                        p->num, token->kind);
+            }
+
+            return parser_update_state(state, state.index + 1,
+                    parser_result_str(state.val + token->start, token->len));
+        }, PARSER_KIND_TOKEN);
+
+        p->num = kind;
+
+        return p;
+    }
+
+    /* erkennt ein token der art kind mit genau dem text str, z.b. ein schlüsselwort. */
+    Parser *
+    Token_Text(int32_t kind, char *str) {
+        Parser *p = parser_create([](Parser *p, const Parser_State &state) {
+            if ( !state.success ) {
+                return state;
+            }
+
+            Lexer_Token *token = parser_token(&state);
+
+            if ( !token ) {
+                return parser_update_error(state, "Token_Text: unerwartet das ende erreicht");
+            }
+
+            if ( token->kind != p->num || token->len != p->val.str.len ||
+                    memcmp(state.val + token->start, p->str, token->len) != 0 )
+            {
+                return parser_update_error(state, "Token_Text: '%s' erwartet", p->str);
+            }
+
+            return parser_update_state(state, state.index + 1,
+                    parser_result_str(state.val + token->start, token->len));
+        }, PARSER_KIND_TOKEN_TEXT);
+
+        p->num = kind;
+        p->str = str;
+        p->val = parser_result_str(str, strlen(str));
+
+        return p;
+    }
+
+    /* zerlegt str mit dem lexer und führt p auf den tokens aus. index im ergebnis zählt
+     * tokens, ergebnisse verweisen weiterhin in str. p darf deshalb nur aus Token,
+     * Token_Text und kombinatoren darüber bestehen. zeichenparser wie Chr, Str, Capture,
+     * Lexeme, Regex, Utf8_* oder die zahlenparser scheitern endgültig mit einer meldung,
+     * eigene procs, die state.val lesen, muß der aufrufer selbst ausschließen. */
+    Parser_State
+    run_tokens(Parser *p, Lexer *lexer, char *str, uint32_t flags = PARSER_FLAG_NONE) {
+        Lexer_Token_List tokens = {};
+        Parser_Context ctx = {};
+        ctx.tokens = &tokens;
+
+        Parser_State state = {};
+
+        state.success = true;
+        state.val     = str;
+        state.index   = 0;
+        state.flags   = flags;
+
+        size_t error_index = 0;
+        if ( !lexer_run(lexer, str, &tokens, &error_index) ) {
+            lexer_token_free(&tokens);
+
+            if ( lexer->msg ) {
+                return parser_update_error(state, lexer->msg);
+            }
+
+            return parser_update_error(state, "Lexer: kein token paßt an position %zd",
+                    error_index);
+        }
+
+        state.ctx = &ctx;
+        parser_limits_attach(&state, &ctx);
+
+        Parser_State result = parser_call(p, state);
+        result.ctx = NULL;
+
+        lexer_token_free(&tokens);
+
+        return result;
+    }
+
+    namespace api {
+        using Urq::Lexer;
+        using Urq::Lexer_Rule;
+        using Urq::Lexer_Token;
+        using Urq::Lexer_Token_List;
+        using Urq::LEXER_RULE_NONE;
+        using Urq::LEXER_RULE_SKIP;
+
+        using Urq::Token;
+        using Urq::Token_Text;
+
+        using Urq::lexer_create;
+        using Urq::lexer_run;
+        using Urq::lexer_token_free;
+        using Urq::run_tokens;
+    }
+}
+
+#endif
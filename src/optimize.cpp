@@ -0,0 +1,542 @@
+#ifndef __PARSER_COMBINATOR_BASE__
+#include "combinator.cpp"
+#endif
+
+#ifndef __PARSER_OPTIMIZE__
+#define __PARSER_OPTIMIZE__
+
+/* optimierungslauf über einen fertigen parsergraphen. die knoten werden an ort und
+ * stelle umgeschrieben, alle verweise auf sie bleiben gültig und sehen das gleiche
+ * verhalten: gleiche ergebnisse, gleiche fehlermeldungen, gleiche indizes.
+ *
+ *   - Choice in Choice wird flachgeklopft, sofern im inneren zweig kein Cut/Commit
+ *     steckt, dessen geltungsbereich sich dadurch ändern würde
+ *   - benachbarte Chr-alternativen einer Choice werden zu einer zeichenmenge, besteht
+ *     die Choice nur daraus, wird sie selbst zur zeichenmenge
+ *   - Many/Many1 über Chr, zeichenmenge oder Digit liest die zeichen in einer schleife
+ *     statt je zeichen einen parser aufzurufen
+ *   - folgen von Chr in einem Seq_Of werden am stück verglichen, das ergebnis enthält
+ *     weiterhin je zeichen einen eintrag
+ *
+ * die ersetzten unterknoten werden danach nicht mehr aufgerufen und tauchen daher auch
+ * nicht mehr in profil, trace und ereignissen auf. */
+
+namespace Urq {
+    struct Parser_Optimize_Report {
+        size_t nodes;             /* besuchte knoten */
+        size_t choices_flattened; /* eingebettete Choice aufgelöst */
+        size_t chr_sets;          /* Chr-alternativen zu zeichenmengen zusammengefaßt */
+        size_t spans;             /* Many über zeichenklassen */
+        size_t chr_runs;          /* Seq_Of mit zusammengefaßten Chr-folgen */
+    };
+
+    /* je glied eines Seq_Of die länge der Chr-folge, die dort beginnt, und das zeichen */
+    struct Parser_Chr_Runs {
+        uint32_t * len;
+        char     * chars;
+    };
+
+    /* Chr('\0') bleibt außen vor, das nullbyte beendet die eingabe */
+    bool
+    parser_is_plain_chr(Parser *p) {
+        bool result = p && p->kind == PARSER_KIND_CHR && p->str[0] != '\0';
+
+        return result;
+    }
+
+    /* Chr und schon gebildete zeichenmengen liefern das gleiche ergebnis und die
+     * gleiche fehlermeldung und lassen sich daher vereinigen. Digit liefert str. */
+    bool
+    parser_chr_mergeable(Parser *p) {
+        bool result = parser_is_plain_chr(p) || (p && p->kind == PARSER_KIND_CHR_SET);
+
+        return result;
+    }
+
+    /* ein zeichen aus der menge, ergebnis wie bei Chr */
+    Parser *
+    parser_chr_set_create(Parser_Chr_Set *set) {
+        Parser *p = parser_create([](Parser *p, const Parser_State &state) {
+            if ( !state.success ) {
+                return state;
+            }
+
+            uint8_t c = (uint8_t)state.val[state.index];
+
+            if ( c && parser_chr_set_has((Parser_Chr_Set *)p->user_data, c) ) {
+                return parser_update_state(state, state.index + 1, parser_result_chr((char)c));
+            }
+
+            return parser_update_error(state, "chr: das gesuchte zeichen wurde nicht gefunden");
+        }, PARSER_KIND_CHR_SET);
+
+        Parser_Chr_Set *copy = (Parser_Chr_Set *)grammar_alloc(sizeof(Parser_Chr_Set));
+        *copy = *set;
+        p->user_data = copy;
+
+        return p;
+    }
+
+    /* liefert die zeichenmenge eines knotens, der genau ein zeichen liest */
+    bool
+    parser_chr_class(Parser *p, Parser_Chr_Set *out) {
+        *out = {};
+
+        if ( parser_is_plain_chr(p) ) {
+            parser_chr_set_add(out, (uint8_t)p->str[0]);
+            return true;
+        }
+
+        if ( p && p->kind == PARSER_KIND_CHR_SET ) {
+            *out = *(Parser_Chr_Set *)p->user_data;
+            return true;
+        }
+
+        if ( p && p->kind == PARSER_KIND_DIGIT ) {
+            for ( int c = '0'; c <= '9'; ++c ) {
+                parser_chr_set_add(out, (uint8_t)c);
+            }
+
+            out->result_str = true;
+            return true;
+        }
+
+        return false;
+    }
+
+    /* liest zeichen aus der menge in einer schleife, verhält sich wie Many bzw. Many1
+     * über den einzelnen zeichenparser. */
+    PARSER_PROC(parser_chr_span_proc) {
+        Parser_Chr_Set *set = (Parser_Chr_Set *)p->user_data;
+        bool capture = !(state.flags & PARSER_FLAG_NO_CAPTURE);
+
+        Parser_Result_Buffer results;
+        parser_result_buffer_init(&results, 0);
+        Parser_State new_state = state;
+        size_t num_results = 0;
+
+        parser_event_emit(&state, PARSER_EVENT_BEGIN_NODE, p, parser_result_none());
+
+        if ( state.success ) {
+            char *s = state.val + state.index;
+
+            while ( *s && parser_chr_set_has(set, (uint8_t)*s) ) {
+                Parser_Result r = set->result_str ? parser_result_str(s, 1) : parser_result_chr(*s);
+                new_state = parser_update_state(new_state, new_state.index + 1, r);
+                num_results += 1;
+
+                if ( capture ) {
+                    parser_result_buffer_push(&results, r);
+                }
+
+                s += 1;
+            }
+        }
+
+        if ( p->kind == PARSER_KIND_CHR_SPAN1 && num_results == 0 ) {
+            parser_result_buffer_free(&results);
+            parser_event_emit(&state, PARSER_EVENT_END_NODE, p, parser_result_none());
+            return parser_update_error(state, "many1: konnte keinen treffer erzielen");
+        }
+
+        parser_event_emit(&state, PARSER_EVENT_END_NODE, p, parser_result_none());
+
+        if ( !capture ) {
+            return parser_update_result(new_state, parser_result_none());
+        }
+
+        return parser_update_result(new_state, parser_result_arr(parser_result_buffer_list(&results)));
+    }
+
+    /* Seq_Of, dessen Chr-folgen am stück verglichen werden. paßt eine folge nicht,
+     * werden ihre glieder einzeln aufgerufen, damit fehlermeldung und index stimmen. */
+    PARSER_PROC(parser_seq_runs_proc) {
+        if ( !state.success ) {
+            return state;
+        }
+
+        Parser_Chr_Runs *runs = (Parser_Chr_Runs *)p->user_data;
+        bool capture = !(state.flags & PARSER_FLAG_NO_CAPTURE);
+
+        Parser_State new_state = state;
+        Parser_Result_Buffer results;
+        parser_result_buffer_init(&results, capture ? p->sequence.num_elems : 0);
+        parser_event_emit(&state, PARSER_EVENT_BEGIN_NODE, p, parser_result_none());
+
+        for ( size_t i = 0; i < p->sequence.num_elems; ) {
+            uint32_t len = runs->len[i];
+
+            /* über tokens prüft parser_call die einzelnen Chr und lehnt sie ab */
+            if ( len >= 2 && !(state.ctx && state.ctx->tokens) ) {
+                char *s = new_state.val + new_state.index;
+                char *expected = runs->chars + i;
+
+                uint32_t j = 0;
+                while ( j < len && s[j] == expected[j] ) {
+                    j += 1;
+                }
+
+                if ( j == len ) {
+                    for ( j = 0; j < len; ++j ) {
+                        new_state = parser_update_state(new_state, new_state.index + 1,
+                                parser_result_chr(expected[j]));
+
+                        if ( capture ) {
+                            parser_result_buffer_push(&results, new_state.result);
+                        }
+                    }
+
+                    i += len;
+                    continue;
+                }
+            }
+
+            new_state = parser_call(parser_entry(&p->sequence, i), new_state);
+
+            if ( !new_state.success ) {
+                parser_result_buffer_free(&results);
+                parser_event_emit(&state, PARSER_EVENT_END_NODE, p, parser_result_none());
+                return new_state;
+            }
+
+            if ( capture ) {
+                parser_result_buffer_push(&results, new_state.result);
+            }
+
+            i += 1;
+        }
+
+        parser_event_emit(&state, PARSER_EVENT_END_NODE, p, parser_result_none());
+
+        if ( !capture ) {
+            return parser_update_result(new_state, parser_result_none());
+        }
+
+        return parser_update_result(new_state, parser_result_arr(parser_result_buffer_list(&results)));
+    }
+
+    /* ---------------------------------------------------------------------------------- */
+
+    struct Parser_Optimizer {
+        Parser                 ** visited;  /* offene adressierung, NULL ist frei */
+        size_t                    cap;
+        size_t                    num;
+        Parser_Optimize_Report  * report;
+    };
+
+    bool
+    parser_optimizer_visit(Parser_Optimizer *o, Parser *p) {
+        if ( o->num*2 >= o->cap ) {
+            size_t cap = (o->cap < 64) ? 64 : o->cap*2;
+            Parser **visited = (Parser **)parser_alloc(sizeof(Parser *)*cap);
+            memset(visited, 0, sizeof(Parser *)*cap);
+
+            for ( size_t i = 0; i < o->cap; ++i ) {
+                Parser *q = o->visited[i];
+                if ( !q ) {
+                    continue;
+                }
+
+                size_t h = ((uintptr_t)q >> 4) & (cap - 1);
+                while ( visited[h] ) {
+                    h = (h + 1) & (cap - 1);
+                }
+                visited[h] = q;
+            }
+
+            parser_dealloc(o->visited);
+            o->visited = visited;
+            o->cap     = cap;
+        }
+
+        size_t h = ((uintptr_t)p >> 4) & (o->cap - 1);
+        while ( o->visited[h] ) {
+            if ( o->visited[h] == p ) {
+                return false;
+            }
+
+            h = (h + 1) & (o->cap - 1);
+        }
+
+        o->visited[h] = p;
+        o->num += 1;
+
+        return true;
+    }
+
+    /* ob ein Cut oder Commit unter p den umgebenden geltungsbereich erreichen kann.
+     * Choice und die wiederholungen öffnen einen eigenen bereich. Chain und eigene
+     * procs sind nicht einsehbar und gelten daher als möglicher cut. */
+    bool
+    parser_may_cut(Parser *p, int depth = 0) {
+        if ( !p ) {
+            return false;
+        }
+
+        if ( depth > 64 ) {
+            return true;
+        }
+
+        switch ( p->kind ) {
+            case PARSER_KIND_CUT:
+            case PARSER_KIND_COMMIT:
+            case PARSER_KIND_CHAIN:
+            case PARSER_KIND_SWITCH:
+            case PARSER_KIND_CUSTOM: {
+                return true;
+            } break;
+
+            case PARSER_KIND_CHOICE:
+            case PARSER_KIND_ADAPTIVE_CHOICE:
+            case PARSER_KIND_MANY:
+            case PARSER_KIND_MANY1:
+            case PARSER_KIND_SEP_BY:
+            case PARSER_KIND_SEP_BY1: {
+                return false;
+            } break;
+
+            default: break;
+        }
+
+        if ( parser_may_cut(p->p, depth + 1) ) {
+            return true;
+        }
+
+        for ( size_t i = 0; i < p->sequence.num_elems; ++i ) {
+            if ( parser_may_cut(p->sequence.elems[i], depth + 1) ) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /* eine eingebettete Choice darf aufgelöst werden, wenn keine ihrer alternativen
+     * einen cut bis zu ihr durchreicht */
+    bool
+    parser_choice_flattenable(Parser *p, Parser *alt) {
+        if ( !alt || alt == p || alt->kind != PARSER_KIND_CHOICE ) {
+            return false;
+        }
+
+        for ( size_t i = 0; i < alt->sequence.num_elems; ++i ) {
+            if ( parser_may_cut(alt->sequence.elems[i]) ) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void
+    parser_optimize_choice(Parser_Optimizer *o, Parser *p) {
+        /* eingebettete Choice auflösen */
+        bool nested = false;
+        for ( size_t i = 0; i < p->sequence.num_elems; ++i ) {
+            Parser *alt = p->sequence.elems[i];
+
+            if ( parser_choice_flattenable(p, alt) ) {
+                nested = true;
+            }
+        }
+
+        if ( nested ) {
+            Parser_List flat = {};
+
+            for ( size_t i = 0; i < p->sequence.num_elems; ++i ) {
+                Parser *alt = p->sequence.elems[i];
+
+                if ( parser_choice_flattenable(p, alt) ) {
+                    for ( size_t j = 0; j < alt->sequence.num_elems; ++j ) {
+                        parser_push(&flat, alt->sequence.elems[j]);
+                    }
+
+                    o->report->choices_flattened += 1;
+                    continue;
+                }
+
+                parser_push(&flat, alt);
+            }
+
+            p->sequence = flat;
+        }
+
+        /* benachbarte Chr zu zeichenmengen zusammenfassen */
+        Parser_List merged = {};
+        bool changed = false;
+
+        for ( size_t i = 0; i < p->sequence.num_elems; ) {
+            size_t j = i;
+            Parser_Chr_Set set = {};
+
+            while ( j < p->sequence.num_elems && parser_chr_mergeable(p->sequence.elems[j]) ) {
+                Parser_Chr_Set alt;
+                parser_chr_class(p->sequence.elems[j], &alt);
+
+                for ( int k = 0; k < 8; ++k ) {
+                    set.bits[k] |= alt.bits[k];
+                }
+
+                j += 1;
+            }
+
+            if ( j - i >= 2 ) {
+                parser_push(&merged, parser_chr_set_create(&set));
+                o->report->chr_sets += 1;
+                changed = true;
+                i = j;
+
+                continue;
+            }
+
+            parser_push(&merged, p->sequence.elems[i]);
+            i += 1;
+        }
+
+        if ( !changed ) {
+            return;
+        }
+
+        /* bleibt nur die menge übrig, wird die Choice selbst dazu */
+        if ( merged.num_elems == 1 && merged.elems[0]->kind == PARSER_KIND_CHR_SET ) {
+            Parser *set = merged.elems[0];
+
+            p->kind      = PARSER_KIND_CHR_SET;
+            p->proc      = set->proc;
+            p->user_data = set->user_data;
+            p->sequence  = {};
+
+            return;
+        }
+
+        p->sequence = merged;
+    }
+
+    void
+    parser_optimize_many(Parser_Optimizer *o, Parser *p) {
+        Parser_Chr_Set set;
+
+        if ( !parser_chr_class(p->p, &set) ) {
+            return;
+        }
+
+        Parser_Chr_Set *copy = (Parser_Chr_Set *)grammar_alloc(sizeof(Parser_Chr_Set));
+        *copy = set;
+
+        p->kind      = (p->kind == PARSER_KIND_MANY) ? PARSER_KIND_CHR_SPAN : PARSER_KIND_CHR_SPAN1;
+        p->proc      = parser_chr_span_proc;
+        p->user_data = copy;
+
+        o->report->spans += 1;
+    }
+
+    void
+    parser_optimize_seq(Parser_Optimizer *o, Parser *p) {
+        size_t n = p->sequence.num_elems;
+        bool found = false;
+
+        for ( size_t i = 0; i + 1 < n; ++i ) {
+            if ( parser_is_plain_chr(p->sequence.elems[i]) && parser_is_plain_chr(p->sequence.elems[i+1]) ) {
+                found = true;
+                break;
+            }
+        }
+
+        if ( !found ) {
+            return;
+        }
+
+        Parser_Chr_Runs *runs = (Parser_Chr_Runs *)grammar_alloc(sizeof(Parser_Chr_Runs));
+        runs->len   = (uint32_t *)grammar_alloc(sizeof(uint32_t)*n);
+        runs->chars = (char *)grammar_alloc(n);
+
+        uint32_t len = 0;
+        for ( size_t i = n; i-- > 0; ) {
+            Parser *q = p->sequence.elems[i];
+
+            if ( parser_is_plain_chr(q) ) {
+                len += 1;
+                runs->chars[i] = q->str[0];
+            } else {
+                len = 0;
+                runs->chars[i] = 0;
+            }
+
+            runs->len[i] = len;
+        }
+
+        p->proc      = parser_seq_runs_proc;
+        p->user_data = runs;
+
+        o->report->chr_runs += 1;
+    }
+
+    void
+    parser_optimize_node(Parser_Optimizer *o, Parser *p) {
+        if ( !p || !parser_optimizer_visit(o, p) ) {
+            return;
+        }
+
+        o->report->nodes += 1;
+
+        /* erst die kinder, damit z.b. Many eine schon zusammengefaßte Choice sieht */
+        parser_optimize_node(o, p->p);
+
+        for ( size_t i = 0; i < p->sequence.num_elems; ++i ) {
+            parser_optimize_node(o, p->sequence.elems[i]);
+        }
+
+        if ( p->kind == PARSER_KIND_EXPRESSION ) {
+            for ( int i = 0; i < p->num; ++i ) {
+                parser_optimize_node(o, p->ops[i].p);
+            }
+        }
+
+        switch ( p->kind ) {
+            case PARSER_KIND_CHOICE: {
+                parser_optimize_choice(o, p);
+            } break;
+
+            case PARSER_KIND_MANY:
+            case PARSER_KIND_MANY1: {
+                parser_optimize_many(o, p);
+            } break;
+
+            case PARSER_KIND_SEQ_OF: {
+                parser_optimize_seq(o, p);
+            } break;
+
+            default: break;
+        }
+    }
+
+    /* schreibt den graphen unter p um und liefert p zurück. was geändert wurde, steht
+     * anschließend in report. */
+    Parser *
+    optimize(Parser *p, Parser_Optimize_Report *report = NULL) {
+        Parser_Optimize_Report local = {};
+        Parser_Optimizer o = {};
+        o.report = report ? report : &local;
+
+        parser_optimize_node(&o, p);
+
+        parser_dealloc(o.visited);
+
+        return p;
+    }
+
+    void
+    parser_optimize_report_print(Parser_Optimize_Report *report, FILE *out = stdout) {
+        fprintf(out, "optimize: %zd knoten, %zd Choice aufgelöst, %zd zeichenmengen, "
+                "%zd Many als schleife, %zd Seq_Of mit Chr-folgen\n", report->nodes,
+                report->choices_flattened, report->chr_sets, report->spans, report->chr_runs);
+    }
+
+    namespace api {
+        using Urq::Parser_Optimize_Report;
+        using Urq::optimize;
+        using Urq::parser_optimize_report_print;
+    }
+}
+
+#endif
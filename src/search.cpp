@@ -0,0 +1,389 @@
+#ifndef __PARSER_COMBINATOR_BASE__
+#include "combinator.cpp"
+#endif
+
+/* suchmodus: findet die treffer von p an beliebiger stelle der eingabe statt nur am
+ * anfang. aus der grammatik wird vorab ein fester anfang (parser_literal_prefix) oder
+ * die menge der möglichen ersten bytes (parser_first_set) bestimmt. die eingabe wird
+ * dann mit memchr bzw. SSE2 nach kandidaten durchsucht und p nur dort aufgerufen.
+ * läßt sich nichts ableiten, weil p auch leer passen kann, wird p an jeder stelle
+ * versucht.
+ *
+ * treffer überlappen sich nicht, nach einem treffer geht es hinter seinem ende
+ * weiter. leere treffer werden nicht gemeldet. fehlversuche formatieren keine
+ * fehlermeldungen. */
+
+namespace Urq {
+    /* wird für jeden treffer aufgerufen, start ist sein anfang, state.index sein ende.
+     * liefert false, um die suche abzubrechen. */
+    #define PARSER_MATCH_PROC(name) bool name(char *str, size_t start, const Parser_State &state, void *user_data)
+    typedef PARSER_MATCH_PROC(Parser_Match_Proc);
+
+    enum Parser_Search_Kind {
+        PARSER_SEARCH_SCAN,     /* jede stelle ist ein kandidat */
+        PARSER_SEARCH_BYTE,     /* genau ein mögliches erstes byte */
+        PARSER_SEARCH_BYTES,    /* bis zu PARSER_SEARCH_MAX_BYTES erste bytes */
+        PARSER_SEARCH_RANGES,   /* bis zu PARSER_SEARCH_MAX_RANGES bereiche erster bytes */
+        PARSER_SEARCH_SET,      /* beliebige menge erster bytes */
+        PARSER_SEARCH_LITERAL,  /* fester anfang von mindestens zwei bytes */
+    };
+
+    #define PARSER_SEARCH_MAX_BYTES  4
+    #define PARSER_SEARCH_MAX_RANGES 2
+
+    struct Parser_Search {
+        Parser_Search_Kind kind;
+        Parser_Chr_Set     first;
+        uint8_t            bytes[PARSER_SEARCH_MAX_BYTES];
+        size_t             num_bytes;
+        uint8_t            range_from[PARSER_SEARCH_MAX_RANGES];
+        uint8_t            range_len[PARSER_SEARCH_MAX_RANGES];  /* bis - von */
+        size_t             num_ranges;
+        char               literal[64];
+        size_t             literal_len;
+    };
+
+    /* wählt den schärfsten filter, der sich aus p ableiten läßt */
+    void
+    parser_search_init(Parser_Search *search, Parser *p) {
+        *search = {};
+
+        bool complete = false;
+        search->literal_len = parser_literal_prefix(p, search->literal, sizeof(search->literal), &complete);
+
+        if ( search->literal_len >= 2 ) {
+            search->kind = PARSER_SEARCH_LITERAL;
+
+            return;
+        }
+
+        if ( !parser_first_set(p, &search->first) ) {
+            search->kind = PARSER_SEARCH_SCAN;
+
+            return;
+        }
+
+        /* das nullbyte beendet die eingabe und ist nie ein kandidat */
+        search->first.bits[0] &= ~1u;
+
+        size_t num_bytes  = 0;
+        size_t num_ranges = 0;
+        for ( int c = 1; c < 256; ++c ) {
+            if ( !parser_chr_set_has(&search->first, (uint8_t)c) ) {
+                continue;
+            }
+
+            if ( num_bytes < PARSER_SEARCH_MAX_BYTES ) {
+                search->bytes[num_bytes] = (uint8_t)c;
+            }
+
+            num_bytes += 1;
+
+            /* zusammenhängende bytes bilden einen bereich */
+            if ( !parser_chr_set_has(&search->first, (uint8_t)(c - 1)) ) {
+                if ( num_ranges < PARSER_SEARCH_MAX_RANGES ) {
+                    search->range_from[num_ranges] = (uint8_t)c;
+                }
+
+                num_ranges += 1;
+            }
+
+            if ( num_ranges <= PARSER_SEARCH_MAX_RANGES ) {
+                search->range_len[num_ranges - 1] = (uint8_t)(c - search->range_from[num_ranges - 1]);
+            }
+        }
+
+        if ( num_bytes == 1 ) {
+            search->kind = PARSER_SEARCH_BYTE;
+        } else if ( num_bytes <= PARSER_SEARCH_MAX_BYTES ) {
+            search->kind = PARSER_SEARCH_BYTES;
+        } else if ( num_ranges <= PARSER_SEARCH_MAX_RANGES ) {
+            search->kind = PARSER_SEARCH_RANGES;
+            search->num_ranges = num_ranges;
+        } else {
+            search->kind = PARSER_SEARCH_SET;
+        }
+
+        search->num_bytes = (num_bytes < PARSER_SEARCH_MAX_BYTES) ? num_bytes : PARSER_SEARCH_MAX_BYTES;
+    }
+
+    /* sucht den festen anfang in [s, end). mit SSE2 werden je 16 stellen auf einmal
+     * auf das erste und das letzte byte des anfangs geprüft, nur wo beide passen wird
+     * verglichen. */
+    char *
+    parser_search_literal(Parser_Search *search, char *s, char *end) {
+        char *lit = search->literal;
+        size_t len = search->literal_len;
+
+#if PARSER_SSE2
+        __m128i first = _mm_set1_epi8(lit[0]);
+        __m128i last  = _mm_set1_epi8(lit[len - 1]);
+
+        while ( (size_t)(end - s) >= len - 1 + 16 ) {
+            __m128i a = _mm_loadu_si128((__m128i *)s);
+            __m128i b = _mm_loadu_si128((__m128i *)(s + len - 1));
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+
+            while ( mask ) {
+                char *candidate = s + parser_ctz32(mask);
+
+                if ( memcmp(candidate + 1, lit + 1, len - 2) == 0 ) {
+                    return candidate;
+                }
+
+                mask &= mask - 1;
+            }
+
+            s += 16;
+        }
+#endif
+
+        while ( (size_t)(end - s) >= len ) {
+            char *candidate = (char *)memchr(s, lit[0], (end - s) - (len - 1));
+
+            if ( !candidate ) {
+                break;
+            }
+
+            if ( memcmp(candidate + 1, lit + 1, len - 1) == 0 ) {
+                return candidate;
+            }
+
+            s = candidate + 1;
+        }
+
+        return NULL;
+    }
+
+    /* sucht in [s, end) eines von bis zu vier bytes, mit SSE2 je 16 stellen auf einmal */
+    char *
+    parser_search_bytes(Parser_Search *search, char *s, char *end) {
+#if PARSER_SSE2
+        __m128i b[PARSER_SEARCH_MAX_BYTES];
+        for ( size_t i = 0; i < PARSER_SEARCH_MAX_BYTES; ++i ) {
+            /* fehlende bytes wiederholen das erste */
+            b[i] = _mm_set1_epi8((char)search->bytes[(i < search->num_bytes) ? i : 0]);
+        }
+
+        while ( end - s >= 16 ) {
+            __m128i v = _mm_loadu_si128((__m128i *)s);
+            __m128i hit = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(v, b[0]), _mm_cmpeq_epi8(v, b[1])),
+                    _mm_or_si128(_mm_cmpeq_epi8(v, b[2]), _mm_cmpeq_epi8(v, b[3])));
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(hit);
+
+            if ( mask ) {
+                return s + parser_ctz32(mask);
+            }
+
+            s += 16;
+        }
+#endif
+
+        for ( ; s < end; ++s ) {
+            for ( size_t i = 0; i < search->num_bytes; ++i ) {
+                if ( (uint8_t)*s == search->bytes[i] ) {
+                    return s;
+                }
+            }
+        }
+
+        return NULL;
+    }
+
+    /* sucht in [s, end) ein byte aus einem von bis zu zwei bereichen. mit SSE2 liegt ein
+     * byte im bereich, wenn (byte - von) vorzeichenlos höchstens (bis - von) ist. */
+    char *
+    parser_search_ranges(Parser_Search *search, char *s, char *end) {
+#if PARSER_SSE2
+        __m128i from[PARSER_SEARCH_MAX_RANGES];
+        __m128i len[PARSER_SEARCH_MAX_RANGES];
+        for ( size_t i = 0; i < PARSER_SEARCH_MAX_RANGES; ++i ) {
+            /* ein fehlender bereich wiederholt den ersten */
+            size_t r = (i < search->num_ranges) ? i : 0;
+            from[i] = _mm_set1_epi8((char)search->range_from[r]);
+            len[i]  = _mm_set1_epi8((char)search->range_len[r]);
+        }
+
+        while ( end - s >= 16 ) {
+            __m128i v = _mm_loadu_si128((__m128i *)s);
+            __m128i d0 = _mm_sub_epi8(v, from[0]);
+            __m128i d1 = _mm_sub_epi8(v, from[1]);
+            __m128i hit = _mm_or_si128(
+                    _mm_cmpeq_epi8(_mm_min_epu8(d0, len[0]), d0),
+                    _mm_cmpeq_epi8(_mm_min_epu8(d1, len[1]), d1));
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(hit);
+
+            if ( mask ) {
+                return s + parser_ctz32(mask);
+            }
+
+            s += 16;
+        }
+#endif
+
+        for ( ; s < end; ++s ) {
+            for ( size_t i = 0; i < search->num_ranges; ++i ) {
+                if ( (uint8_t)((uint8_t)*s - search->range_from[i]) <= search->range_len[i] ) {
+                    return s;
+                }
+            }
+        }
+
+        return NULL;
+    }
+
+    /* nächste stelle in [s, end), an der ein treffer beginnen kann, sonst NULL */
+    char *
+    parser_search_next(Parser_Search *search, char *s, char *end) {
+        if ( s >= end ) {
+            return NULL;
+        }
+
+        switch ( search->kind ) {
+            case PARSER_SEARCH_LITERAL: {
+                return parser_search_literal(search, s, end);
+            } break;
+
+            case PARSER_SEARCH_BYTE: {
+                return (char *)memchr(s, search->bytes[0], end - s);
+            } break;
+
+            case PARSER_SEARCH_BYTES: {
+                return parser_search_bytes(search, s, end);
+            } break;
+
+            case PARSER_SEARCH_RANGES: {
+                return parser_search_ranges(search, s, end);
+            } break;
+
+            case PARSER_SEARCH_SET: {
+                for ( ; s < end; ++s ) {
+                    if ( parser_chr_set_has(&search->first, (uint8_t)*s) ) {
+                        return s;
+                    }
+                }
+
+                return NULL;
+            } break;
+
+            default: {
+                return s;
+            } break;
+        }
+    }
+
+    /* ruft proc für jeden treffer von p in str auf und liefert die zahl der treffer.
+     * scheitert ein versuch endgültig (PARSER_FLAG_FATAL, etwa an einer grenze), endet
+     * die suche und *error erhält diesen zustand, seine meldung ist dann unformatiert.
+     * sonst ist error->success gesetzt. ohne error ist ein abbruch nicht vom ende der
+     * treffer zu unterscheiden, wer grenzen setzt, muß error also angeben. ein cut gilt
+     * nur für den versuch an seiner stelle, danach geht die suche weiter. */
+    size_t
+    find_all(Parser *p, char *str, Parser_Match_Proc *proc, void *user_data = NULL,
+            uint32_t flags = PARSER_FLAG_NONE, Parser_State *error = NULL) {
+        Parser_Search search;
+        parser_search_init(&search, p);
+
+        char *end = str + strlen(str);
+        char *s = str;
+        size_t result = 0;
+
+        Parser_Context ctx = {};
+        Parser_State state = {};
+        state.success = true;
+        state.val     = str;
+        state.flags   = flags | PARSER_FLAG_NO_MESSAGES;
+
+        if ( error ) {
+            *error = state;
+            error->flags = flags;
+        }
+
+        parser_limits_attach(&state, &ctx);
+
+        while ( (s = parser_search_next(&search, s, end)) != NULL ) {
+            state.index = s - str;
+            Parser_State match = parser_call(p, state);
+
+            if ( !match.success ) {
+                if ( match.flags & PARSER_FLAG_FATAL ) {
+                    if ( error ) {
+                        *error = match;
+                        error->ctx = NULL;
+                        parser_restore_flags(error, flags);
+                    }
+
+                    break;
+                }
+
+                s += 1;
+                continue;
+            }
+
+            if ( match.index == state.index ) {
+                s += 1;
+                continue;
+            }
+
+            result += 1;
+            parser_restore_flags(&match, flags);
+
+            if ( proc && !proc(str, state.index, match, user_data) ) {
+                break;
+            }
+
+            s = str + match.index;
+        }
+
+        return result;
+    }
+
+    /* der erste treffer von p in str. *start erhält seinen anfang. ohne treffer
+     * scheitert das ergebnis am ende der eingabe. */
+    Parser_State
+    find_first(Parser *p, char *str, size_t *start = NULL, uint32_t flags = PARSER_FLAG_NONE) {
+        struct Find_First {
+            Parser_State state;
+            size_t       start;
+        };
+
+        Find_First found = {};
+        Parser_State error = {};
+
+        size_t num_matches = find_all(p, str, [](char *str, size_t start, const Parser_State &state, void *user_data) {
+            Find_First *found = (Find_First *)user_data;
+            found->state = state;
+            found->state.ctx = NULL;
+            found->start = start;
+
+            return false;
+        }, &found, flags, &error);
+
+        if ( num_matches ) {
+            if ( start ) {
+                *start = found.start;
+            }
+
+            return found.state;
+        }
+
+        if ( !error.success ) {
+            return error;
+        }
+
+        Parser_State state = {};
+        state.success = true;
+        state.val     = str;
+        state.index   = strlen(str);
+        state.flags   = flags;
+
+        return parser_update_error(state, "find: kein treffer gefunden");
+    }
+
+    namespace api {
+        using Urq::Parser_Match_Proc;
+        using Urq::find_all;
+        using Urq::find_first;
+    }
+}
@@ -0,0 +1,785 @@
+#ifndef __PARSER_COMBINATOR_BASE__
+#include "combinator.cpp"
+#endif
+
+#include "lexer.cpp"
+#include "optimize.cpp"
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/* abbild einer fertigen grammatik. grammar_save schreibt den graphen unter einem parser
+ * samt allem, was beim anlegen berechnet wurde (sprungtabellen von Switch, zeichenmengen
+ * und Chr-folgen aus optimize, die gelernte reihenfolge von Adaptive_Choice, den DFA
+ * eines lexers), in eine datei. grammar_load liest sie wieder ein und biegt nur die
+ * zeiger um, statt die grammatik neu aufzubauen.
+ *
+ * die datei besteht aus drei teilen:
+ *
+ *     kopf          Grammar_Image_Header
+ *     knoten        knoten und alles, was zeiger enthält. zeiger stehen als offset vom
+ *                   anfang der datei darin. der teil wird in eigenen speicher gelesen
+ *                   und dort angepaßt, das ist billiger als jede seite einer privaten
+ *                   einblendung beim ersten schreiben zu kopieren.
+ *     daten         zeichenketten, zeichenmengen, DFA-tabellen und die liste der
+ *                   anzupassenden stellen. beginnt auf einer seitengrenze, wird mit mmap
+ *                   nur lesbar eingeblendet und im page cache zwischen prozessen geteilt.
+ *
+ * funktionszeiger (procs, Map, Chain, operatoren von Expression) stehen als abstand zu
+ * parser_create. ein abbild paßt daher nur zu genau dem programm, das es geschrieben
+ * hat; grammar_load prüft das an der lage einiger bekannter funktionen. eigene
+ * user_data und Succeed mit listen oder eigenen werten lassen sich nicht speichern. der
+ * cache von Chain_Cached wird leer gespeichert und füllt sich neu, er liegt deshalb im
+ * beschreibbaren teil. */
+
+namespace Urq {
+    #define GRAMMAR_IMAGE_VERSION 1
+    #define GRAMMAR_IMAGE_PAGE    4096
+
+    struct Grammar_Image_Header {
+        char     magic[8];
+        uint32_t version;
+        uint32_t parser_size;      /* hängt von PARSER_PROFILE und co. ab */
+        int64_t  code[4];          /* lage bekannter funktionen zu parser_create */
+        uint64_t size;
+        uint64_t data_offset;
+        uint64_t root;
+        uint64_t lexer;
+        uint64_t relocs;           /* stellen mit offsets innerhalb des abbilds */
+        uint64_t num_relocs;
+        uint64_t code_relocs;      /* stellen mit funktionszeigern */
+        uint64_t num_code_relocs;
+    };
+
+    /* eine eingelesene grammatik. root und lexer bleiben bis grammar_unload gültig. */
+    struct Grammar_Image {
+        char   * nodes;      /* knotenteil mit kopf, gehört dem prozeß */
+        size_t   nodes_size;
+        char   * data;       /* datenteil, nur lesbar */
+        size_t   data_size;
+        bool     mapped;
+
+        Parser * root;
+        Lexer  * lexer;
+
+        char   * msg;
+    };
+
+    enum Grammar_Section {
+        GRAMMAR_SECTION_NODES,
+        GRAMMAR_SECTION_DATA,
+    };
+
+    struct Grammar_Fixup {
+        uint64_t        slot;
+        uint64_t        target;
+        Grammar_Section section;
+    };
+
+    struct Grammar_Buffer {
+        char   * elems;
+        size_t   num_elems;
+        size_t   cap;
+    };
+
+    struct Grammar_Writer {
+        Grammar_Buffer   nodes;
+        Grammar_Buffer   data;
+
+        Grammar_Fixup  * fixups;
+        size_t           num_fixups;
+        size_t           cap_fixups;
+
+        uint64_t       * code;
+        size_t           num_code;
+        size_t           cap_code;
+
+        /* bereits vergebene knoten, offene adressierung, NULL ist frei */
+        Parser        ** keys;
+        uint64_t       * offsets;
+        size_t           cap;
+        size_t           num;
+
+        /* vergebene, aber noch nicht geschriebene knoten */
+        Parser        ** pending;
+        size_t           num_pending;
+        size_t           cap_pending;
+
+        char           * msg;
+    };
+
+    void
+    grammar_code_fingerprint(int64_t *code) {
+        uintptr_t anchor = (uintptr_t)&parser_create;
+
+        code[0] = (int64_t)((uintptr_t)Digit->proc - anchor);
+        code[1] = (int64_t)((uintptr_t)Letters->proc - anchor);
+        code[2] = (int64_t)((uintptr_t)&parser_chain_proc - anchor);
+        code[3] = (int64_t)((uintptr_t)&parser_chr_span_proc - anchor);
+    }
+
+    void *
+    grammar_grow(void *elems, size_t num, size_t *cap, size_t need, size_t size) {
+        if ( need <= *cap ) {
+            return elems;
+        }
+
+        size_t new_cap = (*cap < 64) ? 64 : *cap*2;
+        while ( new_cap < need ) {
+            new_cap *= 2;
+        }
+
+        void *result = parser_alloc(new_cap*size);
+        if ( num ) {
+            memcpy(result, elems, num*size);
+        }
+
+        parser_dealloc(elems);
+        *cap = new_cap;
+
+        return result;
+    }
+
+    /* reserviert size genullte bytes und liefert ihren offset im puffer */
+    uint64_t
+    grammar_buffer_reserve(Grammar_Buffer *buffer, size_t size, size_t align = 16) {
+        size_t offset = (buffer->num_elems + align - 1) & ~(align - 1);
+
+        buffer->elems = (char *)grammar_grow(buffer->elems, buffer->num_elems, &buffer->cap,
+                offset + size, 1);
+        memset(buffer->elems + buffer->num_elems, 0, offset + size - buffer->num_elems);
+        buffer->num_elems = offset + size;
+
+        return offset;
+    }
+
+    Grammar_Buffer *
+    grammar_writer_section(Grammar_Writer *w, Grammar_Section section) {
+        Grammar_Buffer *result = (section == GRAMMAR_SECTION_NODES) ? &w->nodes : &w->data;
+
+        return result;
+    }
+
+    uint64_t
+    grammar_writer_blob(Grammar_Writer *w, Grammar_Section section, void *src, size_t size,
+            size_t align = 16)
+    {
+        Grammar_Buffer *buffer = grammar_writer_section(w, section);
+        uint64_t result = grammar_buffer_reserve(buffer, size, align);
+
+        if ( size ) {
+            memcpy(buffer->elems + result, src, size);
+        }
+
+        return result;
+    }
+
+    /* die stelle slot im knotenteil verweist auf target */
+    void
+    grammar_writer_ptr(Grammar_Writer *w, uint64_t slot, Grammar_Section section, uint64_t target) {
+        w->fixups = (Grammar_Fixup *)grammar_grow(w->fixups, w->num_fixups, &w->cap_fixups,
+                w->num_fixups + 1, sizeof(Grammar_Fixup));
+        w->fixups[w->num_fixups++] = { slot, target, section };
+    }
+
+    void
+    grammar_writer_code(Grammar_Writer *w, uint64_t slot, uintptr_t fn) {
+        if ( !fn ) {
+            return;
+        }
+
+        int64_t delta = (int64_t)(fn - (uintptr_t)&parser_create);
+        memcpy(w->nodes.elems + slot, &delta, sizeof(delta));
+
+        w->code = (uint64_t *)grammar_grow(w->code, w->num_code, &w->cap_code, w->num_code + 1,
+                sizeof(uint64_t));
+        w->code[w->num_code++] = slot;
+    }
+
+    void
+    grammar_writer_string(Grammar_Writer *w, uint64_t slot, char *str, size_t len) {
+        if ( !str ) {
+            return;
+        }
+
+        uint64_t offset = grammar_buffer_reserve(&w->data, len + 1, 1);
+        memcpy(w->data.elems + offset, str, len);
+
+        grammar_writer_ptr(w, slot, GRAMMAR_SECTION_DATA, offset);
+    }
+
+    /* offset des knotens p im abbild. neue knoten werden vorgemerkt. */
+    uint64_t
+    grammar_writer_node(Grammar_Writer *w, Parser *p) {
+        if ( w->num*2 >= w->cap ) {
+            size_t cap = (w->cap < 64) ? 64 : w->cap*2;
+            Parser **keys = (Parser **)parser_alloc(sizeof(Parser *)*cap);
+            uint64_t *offsets = (uint64_t *)parser_alloc(sizeof(uint64_t)*cap);
+            memset(keys, 0, sizeof(Parser *)*cap);
+
+            for ( size_t i = 0; i < w->cap; ++i ) {
+                if ( !w->keys[i] ) {
+                    continue;
+                }
+
+                size_t h = ((uintptr_t)w->keys[i] >> 4) & (cap - 1);
+                while ( keys[h] ) {
+                    h = (h + 1) & (cap - 1);
+                }
+
+                keys[h]    = w->keys[i];
+                offsets[h] = w->offsets[i];
+            }
+
+            parser_dealloc(w->keys);
+            parser_dealloc(w->offsets);
+            w->keys    = keys;
+            w->offsets = offsets;
+            w->cap     = cap;
+        }
+
+        size_t h = ((uintptr_t)p >> 4) & (w->cap - 1);
+        while ( w->keys[h] ) {
+            if ( w->keys[h] == p ) {
+                return w->offsets[h];
+            }
+
+            h = (h + 1) & (w->cap - 1);
+        }
+
+        uint64_t result = grammar_buffer_reserve(&w->nodes, sizeof(Parser));
+
+        w->keys[h]    = p;
+        w->offsets[h] = result;
+        w->num       += 1;
+
+        w->pending = (Parser **)grammar_grow(w->pending, w->num_pending, &w->cap_pending,
+                w->num_pending + 1, sizeof(Parser *));
+        w->pending[w->num_pending++] = p;
+
+        return result;
+    }
+
+    void
+    grammar_writer_node_ref(Grammar_Writer *w, uint64_t slot, Parser *p) {
+        if ( !p ) {
+            return;
+        }
+
+        grammar_writer_ptr(w, slot, GRAMMAR_SECTION_NODES, grammar_writer_node(w, p));
+    }
+
+    void
+    grammar_write_table(Grammar_Writer *w, Parser *p, uint64_t slot) {
+        Parser_Jump_Table *t = p->table;
+        uint64_t offset = grammar_buffer_reserve(&w->nodes, sizeof(Parser_Jump_Table));
+        grammar_writer_ptr(w, slot, GRAMMAR_SECTION_NODES, offset);
+
+        /* der cache von Chain_Cached wird mit seinem festen, aber leeren speicher
+         * geschrieben und füllt sich im neuen prozeß wieder */
+        if ( p->kind != PARSER_KIND_SWITCH ) {
+            Parser_Chain_Cache *c = t->cache;
+
+            uint64_t cache = grammar_buffer_reserve(&w->nodes, sizeof(Parser_Chain_Cache));
+            grammar_writer_ptr(w, offset + offsetof(Parser_Jump_Table, cache), GRAMMAR_SECTION_NODES, cache);
+
+            Parser_Chain_Cache *copy = new (w->nodes.elems + cache) Parser_Chain_Cache();
+            copy->cap      = c->cap;
+            copy->limit    = c->limit;
+            copy->keys_cap = c->keys_cap;
+
+            uint64_t slots = grammar_buffer_reserve(&w->nodes, sizeof(Parser_Chain_Slot)*c->cap);
+            grammar_writer_ptr(w, cache + offsetof(Parser_Chain_Cache, slots), GRAMMAR_SECTION_NODES, slots);
+
+            for ( size_t i = 0; i < c->cap; ++i ) {
+                new (w->nodes.elems + slots + sizeof(Parser_Chain_Slot)*i) Parser_Chain_Slot();
+            }
+
+            uint64_t keys = grammar_buffer_reserve(&w->nodes, c->keys_cap);
+            grammar_writer_ptr(w, cache + offsetof(Parser_Chain_Cache, keys), GRAMMAR_SECTION_NODES, keys);
+
+            return;
+        }
+
+        Parser_Jump_Table copy = {};
+        copy.dense_min = t->dense_min;
+        copy.dense_len = t->dense_len;
+        copy.cap       = t->cap;
+        copy.num       = t->num;
+        memcpy(w->nodes.elems + offset, &copy, sizeof(copy));
+
+        grammar_writer_node_ref(w, offset + offsetof(Parser_Jump_Table, otherwise), t->otherwise);
+
+        if ( t->dense ) {
+            uint64_t dense = grammar_buffer_reserve(&w->nodes, sizeof(Parser *)*t->dense_len);
+            grammar_writer_ptr(w, offset + offsetof(Parser_Jump_Table, dense), GRAMMAR_SECTION_NODES, dense);
+
+            for ( size_t i = 0; i < t->dense_len; ++i ) {
+                grammar_writer_node_ref(w, dense + sizeof(Parser *)*i, t->dense[i]);
+            }
+        }
+
+        if ( t->entries ) {
+            uint64_t entries = grammar_buffer_reserve(&w->nodes, sizeof(Parser_Jump_Entry)*t->cap);
+            grammar_writer_ptr(w, offset + offsetof(Parser_Jump_Table, entries), GRAMMAR_SECTION_NODES, entries);
+
+            for ( size_t i = 0; i < t->cap; ++i ) {
+                Parser_Jump_Entry *e = t->entries + i;
+                uint64_t entry = entries + sizeof(Parser_Jump_Entry)*i;
+
+                Parser_Jump_Entry plain = {};
+                plain.key = e->key;
+                plain.len = e->len;
+                memcpy(w->nodes.elems + entry, &plain, sizeof(plain));
+
+                grammar_writer_string(w, entry + offsetof(Parser_Jump_Entry, str), e->str, e->len);
+                grammar_writer_node_ref(w, entry + offsetof(Parser_Jump_Entry, p), e->p);
+            }
+        }
+    }
+
+    /* zusätzliche daten eines knotens in user_data */
+    bool
+    grammar_write_user_data(Grammar_Writer *w, Parser *p, uint64_t slot) {
+        switch ( p->kind ) {
+            case PARSER_KIND_CHR_SET:
+            case PARSER_KIND_CHR_SPAN:
+            case PARSER_KIND_CHR_SPAN1: {
+                uint64_t offset = grammar_writer_blob(w, GRAMMAR_SECTION_DATA, p->user_data,
+                        sizeof(Parser_Chr_Set));
+                grammar_writer_ptr(w, slot, GRAMMAR_SECTION_DATA, offset);
+            } break;
+
+            case PARSER_KIND_SEQ_OF: {
+                /* Chr-folgen aus optimize */
+                Parser_Chr_Runs *runs = (Parser_Chr_Runs *)p->user_data;
+                size_t n = p->sequence.num_elems;
+
+                uint64_t offset = grammar_buffer_reserve(&w->nodes, sizeof(Parser_Chr_Runs));
+                grammar_writer_ptr(w, slot, GRAMMAR_SECTION_NODES, offset);
+
+                uint64_t len = grammar_writer_blob(w, GRAMMAR_SECTION_DATA, runs->len, sizeof(uint32_t)*n);
+                uint64_t chars = grammar_writer_blob(w, GRAMMAR_SECTION_DATA, runs->chars, n);
+                grammar_writer_ptr(w, offset + offsetof(Parser_Chr_Runs, len), GRAMMAR_SECTION_DATA, len);
+                grammar_writer_ptr(w, offset + offsetof(Parser_Chr_Runs, chars), GRAMMAR_SECTION_DATA, chars);
+            } break;
+
+            case PARSER_KIND_LEXEME: {
+                Parser_Trivia *trivia = (Parser_Trivia *)p->user_data;
+
+                uint64_t offset = grammar_buffer_reserve(&w->nodes, sizeof(Parser_Trivia));
+                grammar_writer_ptr(w, slot, GRAMMAR_SECTION_NODES, offset);
+
+                char *strs[] = { trivia->line_comment, trivia->block_begin, trivia->block_end };
+                for ( int i = 0; i < 3; ++i ) {
+                    grammar_writer_string(w, offset + sizeof(char *)*i, strs[i], strs[i] ? strlen(strs[i]) : 0);
+                }
+            } break;
+
+            case PARSER_KIND_ADAPTIVE_CHOICE: {
+                /* die gelernte reihenfolge bleibt erhalten */
+                Parser_Adaptive *a = (Parser_Adaptive *)p->user_data;
+
+                uint64_t offset = grammar_buffer_reserve(&w->nodes, sizeof(Parser_Adaptive));
+                grammar_writer_ptr(w, slot, GRAMMAR_SECTION_NODES, offset);
+
+                Parser_Adaptive *copy = new (w->nodes.elems + offset) Parser_Adaptive();
+                copy->order.store(a->order.load(std::memory_order_acquire), std::memory_order_relaxed);
+                for ( size_t i = 0; i < PARSER_ADAPTIVE_MAX; ++i ) {
+                    copy->hits[i].store(a->hits[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                }
+            } break;
+
+            default: {
+                w->msg = "grammar_save: eigene user_data kann nicht gespeichert werden";
+
+                return false;
+            } break;
+        }
+
+        return true;
+    }
+
+    bool
+    grammar_write_node(Grammar_Writer *w, Parser *p) {
+        uint64_t offset = grammar_writer_node(w, p);
+
+        Parser copy;
+        memset(&copy, 0, sizeof(Parser));
+
+        copy.kind = p->kind;
+        copy.num  = p->num;
+        copy.val  = p->val;
+        copy.sequence.num_elems = p->sequence.num_elems;
+        copy.sequence.cap       = p->sequence.num_elems;
+        memcpy(copy.n, p->n, sizeof(copy.n));
+
+        switch ( p->val.kind ) {
+            case PARSER_RESULT_ARR:
+            case PARSER_RESULT_CUSTOM: {
+                w->msg = "grammar_save: Succeed mit liste oder eigenem wert kann nicht gespeichert werden";
+
+                return false;
+            } break;
+
+            case PARSER_RESULT_STR: {
+                copy.val.str.val = NULL;
+            } break;
+
+            default: break;
+        }
+
+        memcpy(w->nodes.elems + offset, &copy, sizeof(Parser));
+
+        grammar_writer_string(w, offset + offsetof(Parser, name), p->name, p->name ? strlen(p->name) : 0);
+        grammar_writer_string(w, offset + offsetof(Parser, msg), p->msg, p->msg ? strlen(p->msg) : 0);
+
+        if ( p->str == p->n ) {
+            grammar_writer_ptr(w, offset + offsetof(Parser, str), GRAMMAR_SECTION_NODES,
+                    offset + offsetof(Parser, n));
+        } else {
+            grammar_writer_string(w, offset + offsetof(Parser, str), p->str, p->str ? strlen(p->str) : 0);
+        }
+
+        if ( p->val.kind == PARSER_RESULT_STR ) {
+            grammar_writer_string(w, offset + offsetof(Parser, val) + offsetof(Parser_Result, str.val),
+                    p->val.str.val, p->val.str.len);
+        }
+
+        grammar_writer_code(w, offset + offsetof(Parser, proc), (uintptr_t)p->proc);
+        grammar_writer_code(w, offset + offsetof(Parser, map_proc), (uintptr_t)p->map_proc);
+        grammar_writer_code(w, offset + offsetof(Parser, chain_proc), (uintptr_t)p->chain_proc);
+
+        grammar_writer_node_ref(w, offset + offsetof(Parser, p), p->p);
+
+        if ( p->sequence.num_elems ) {
+            uint64_t elems = grammar_buffer_reserve(&w->nodes, sizeof(Parser *)*p->sequence.num_elems);
+            grammar_writer_ptr(w, offset + offsetof(Parser, sequence) + offsetof(Parser_List, elems),
+                    GRAMMAR_SECTION_NODES, elems);
+
+            for ( size_t i = 0; i < p->sequence.num_elems; ++i ) {
+                grammar_writer_node_ref(w, elems + sizeof(Parser *)*i, p->sequence.elems[i]);
+            }
+        }
+
+        if ( p->kind == PARSER_KIND_EXPRESSION && p->num > 0 ) {
+            uint64_t ops = grammar_buffer_reserve(&w->nodes, sizeof(Parser_Op)*p->num);
+            grammar_writer_ptr(w, offset + offsetof(Parser, ops), GRAMMAR_SECTION_NODES, ops);
+
+            for ( int i = 0; i < p->num; ++i ) {
+                uint64_t op = ops + sizeof(Parser_Op)*i;
+
+                Parser_Op plain = p->ops[i];
+                plain.p     = NULL;
+                plain.build = NULL;
+                memcpy(w->nodes.elems + op, &plain, sizeof(plain));
+
+                grammar_writer_node_ref(w, op + offsetof(Parser_Op, p), p->ops[i].p);
+                grammar_writer_code(w, op + offsetof(Parser_Op, build), (uintptr_t)p->ops[i].build);
+            }
+        }
+
+        if ( p->table ) {
+            grammar_write_table(w, p, offset + offsetof(Parser, table));
+        }
+
+        if ( p->user_data && !grammar_write_user_data(w, p, offset + offsetof(Parser, user_data)) ) {
+            return false;
+        }
+
+        return true;
+    }
+
+    uint64_t
+    grammar_write_lexer(Grammar_Writer *w, Lexer *lexer) {
+        uint64_t offset = grammar_buffer_reserve(&w->nodes, sizeof(Lexer));
+
+        Lexer copy = {};
+        memcpy(copy.classes, lexer->classes, sizeof(copy.classes));
+        copy.num_classes = lexer->num_classes;
+        copy.num_states  = lexer->num_states;
+        copy.num_rules   = lexer->num_rules;
+        memcpy(w->nodes.elems + offset, &copy, sizeof(copy));
+
+        grammar_writer_string(w, offset + offsetof(Lexer, msg), lexer->msg, lexer->msg ? strlen(lexer->msg) : 0);
+
+        if ( lexer->next ) {
+            uint64_t next = grammar_writer_blob(w, GRAMMAR_SECTION_DATA, lexer->next,
+                    sizeof(int32_t)*lexer->num_states*lexer->num_classes);
+            uint64_t accept = grammar_writer_blob(w, GRAMMAR_SECTION_DATA, lexer->accept,
+                    sizeof(int32_t)*lexer->num_states);
+
+            grammar_writer_ptr(w, offset + offsetof(Lexer, next), GRAMMAR_SECTION_DATA, next);
+            grammar_writer_ptr(w, offset + offsetof(Lexer, accept), GRAMMAR_SECTION_DATA, accept);
+        }
+
+        uint64_t rules = grammar_buffer_reserve(&w->nodes, sizeof(Lexer_Rule)*lexer->num_rules);
+        grammar_writer_ptr(w, offset + offsetof(Lexer, rules), GRAMMAR_SECTION_NODES, rules);
+
+        for ( size_t i = 0; i < lexer->num_rules; ++i ) {
+            uint64_t rule = rules + sizeof(Lexer_Rule)*i;
+
+            Lexer_Rule plain = lexer->rules[i];
+            plain.pattern = NULL;
+            memcpy(w->nodes.elems + rule, &plain, sizeof(plain));
+
+            grammar_writer_string(w, rule + offsetof(Lexer_Rule, pattern), lexer->rules[i].pattern,
+                    strlen(lexer->rules[i].pattern));
+        }
+
+        return offset;
+    }
+
+    void
+    grammar_writer_free(Grammar_Writer *w) {
+        parser_dealloc(w->nodes.elems);
+        parser_dealloc(w->data.elems);
+        parser_dealloc(w->fixups);
+        parser_dealloc(w->code);
+        parser_dealloc(w->keys);
+        parser_dealloc(w->offsets);
+        parser_dealloc(w->pending);
+    }
+
+    /* schreibt den graphen unter p und optional den lexer nach path. bei einem fehler
+     * wird false geliefert und die meldung in msg abgelegt. */
+    bool
+    grammar_save(Parser *p, char *path, Lexer *lexer = NULL, char **msg = NULL) {
+        Grammar_Writer w = {};
+        grammar_buffer_reserve(&w.nodes, sizeof(Grammar_Image_Header), 64);
+
+        uint64_t root = grammar_writer_node(&w, p);
+
+        /* grammar_write_node merkt neue kinder vor, die liste wächst dabei */
+        for ( size_t i = 0; i < w.num_pending && !w.msg; ++i ) {
+            grammar_write_node(&w, w.pending[i]);
+        }
+
+        uint64_t lexer_offset = lexer ? grammar_write_lexer(&w, lexer) : 0;
+
+        if ( w.msg ) {
+            if ( msg ) {
+                *msg = w.msg;
+            }
+
+            grammar_writer_free(&w);
+
+            return false;
+        }
+
+        uint64_t data_offset = (w.nodes.num_elems + GRAMMAR_IMAGE_PAGE - 1) & ~(uint64_t)(GRAMMAR_IMAGE_PAGE - 1);
+
+        for ( size_t i = 0; i < w.num_fixups; ++i ) {
+            Grammar_Fixup *f = w.fixups + i;
+            uint64_t target = f->target + ((f->section == GRAMMAR_SECTION_DATA) ? data_offset : 0);
+
+            memcpy(w.nodes.elems + f->slot, &target, sizeof(target));
+        }
+
+        uint64_t relocs = grammar_buffer_reserve(&w.data, sizeof(uint64_t)*w.num_fixups, 8);
+        for ( size_t i = 0; i < w.num_fixups; ++i ) {
+            memcpy(w.data.elems + relocs + sizeof(uint64_t)*i, &w.fixups[i].slot, sizeof(uint64_t));
+        }
+
+        uint64_t code_relocs = grammar_writer_blob(&w, GRAMMAR_SECTION_DATA, w.code,
+                sizeof(uint64_t)*w.num_code, 8);
+
+        Grammar_Image_Header header = {};
+        memcpy(header.magic, "URQGRAM", 8);
+        header.version         = GRAMMAR_IMAGE_VERSION;
+        header.parser_size     = (uint32_t)sizeof(Parser);
+        header.size            = data_offset + w.data.num_elems;
+        header.data_offset     = data_offset;
+        header.root            = root;
+        header.lexer           = lexer_offset;
+        header.relocs          = data_offset + relocs;
+        header.num_relocs      = w.num_fixups;
+        header.code_relocs     = data_offset + code_relocs;
+        header.num_code_relocs = w.num_code;
+        grammar_code_fingerprint(header.code);
+        memcpy(w.nodes.elems, &header, sizeof(header));
+
+        bool result = false;
+        FILE *file = fopen(path, "wb");
+
+        if ( file ) {
+            static char padding[GRAMMAR_IMAGE_PAGE] = {};
+            size_t pad = data_offset - w.nodes.num_elems;
+
+            result = fwrite(w.nodes.elems, 1, w.nodes.num_elems, file) == w.nodes.num_elems &&
+                     fwrite(padding, 1, pad, file) == pad &&
+                     fwrite(w.data.elems, 1, w.data.num_elems, file) == w.data.num_elems;
+            result = (fclose(file) == 0) && result;
+        }
+
+        if ( !result && msg ) {
+            *msg = "grammar_save: die datei konnte nicht geschrieben werden";
+        }
+
+        grammar_writer_free(&w);
+
+        return result;
+    }
+
+    void
+    grammar_unload(Grammar_Image *image) {
+        if ( image->nodes ) {
+            parser_forget_nodes([](void *owner, void *mem) {
+                Grammar_Image *image = (Grammar_Image *)owner;
+
+                return (char *)mem >= image->nodes && (char *)mem < image->nodes + image->nodes_size;
+            }, image);
+        }
+
+        parser_dealloc(image->nodes);
+
+        if ( image->data ) {
+#if !defined(_WIN32)
+            if ( image->mapped ) {
+                munmap(image->data, image->data_size);
+            } else
+#endif
+            {
+                parser_dealloc(image->data);
+            }
+        }
+
+        char *msg = image->msg;
+        *image = {};
+        image->msg = msg;
+    }
+
+    bool
+    grammar_load_fail(Grammar_Image *image, FILE *file, char *msg) {
+        if ( file ) {
+            fclose(file);
+        }
+
+        grammar_unload(image);
+        image->msg = msg;
+
+        return false;
+    }
+
+    /* liest ein abbild von grammar_save ein. der knotenteil wird in eigenen speicher
+     * gelesen und angepaßt, der datenteil mit mmap nur lesbar eingeblendet. */
+    bool
+    grammar_load(Grammar_Image *image, char *path) {
+        *image = {};
+
+        FILE *file = fopen(path, "rb");
+        if ( !file ) {
+            return grammar_load_fail(image, NULL, "grammar_load: die datei konnte nicht geöffnet werden");
+        }
+
+        Grammar_Image_Header header;
+        fseek(file, 0, SEEK_END);
+        uint64_t size = (uint64_t)ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        if ( fread(&header, 1, sizeof(header), file) != sizeof(header) ||
+                memcmp(header.magic, "URQGRAM", 8) != 0 || header.version != GRAMMAR_IMAGE_VERSION ||
+                header.size != size || header.data_offset < sizeof(header) || header.data_offset > size ||
+                header.relocs < header.data_offset || header.code_relocs < header.data_offset ||
+                header.relocs + sizeof(uint64_t)*header.num_relocs > size ||
+                header.code_relocs + sizeof(uint64_t)*header.num_code_relocs > size ||
+                header.root < sizeof(header) || header.root >= header.data_offset ||
+                header.lexer >= header.data_offset )
+        {
+            return grammar_load_fail(image, file, "grammar_load: die datei ist kein abbild");
+        }
+
+        int64_t code[4];
+        grammar_code_fingerprint(code);
+
+        if ( header.parser_size != sizeof(Parser) || memcmp(code, header.code, sizeof(code)) != 0 ) {
+            return grammar_load_fail(image, file, "grammar_load: das abbild stammt von einem anderen programm");
+        }
+
+        size_t num_nodes = (size_t)header.data_offset;
+        size_t num_data  = (size_t)(size - header.data_offset);
+
+        image->nodes      = (char *)parser_alloc(num_nodes);
+        image->nodes_size = num_nodes;
+        fseek(file, 0, SEEK_SET);
+
+        if ( fread(image->nodes, 1, num_nodes, file) != num_nodes ) {
+            return grammar_load_fail(image, file, "grammar_load: die datei konnte nicht gelesen werden");
+        }
+
+        image->data_size = num_data;
+
+#if !defined(_WIN32)
+        if ( num_data && header.data_offset % (uint64_t)sysconf(_SC_PAGESIZE) == 0 ) {
+            void *data = mmap(NULL, num_data, PROT_READ, MAP_PRIVATE, fileno(file), (off_t)header.data_offset);
+
+            if ( data != MAP_FAILED ) {
+                image->data   = (char *)data;
+                image->mapped = true;
+            }
+        }
+#endif
+
+        if ( !image->data ) {
+            image->data = (char *)parser_alloc(num_data ? num_data : 1);
+
+            if ( fread(image->data, 1, num_data, file) != num_data ) {
+                return grammar_load_fail(image, file, "grammar_load: die datei konnte nicht gelesen werden");
+            }
+        }
+
+        fclose(file);
+
+        char *nodes = image->nodes;
+        char *data  = image->data - header.data_offset;
+        uint64_t *relocs      = (uint64_t *)(data + header.relocs);
+        uint64_t *code_relocs = (uint64_t *)(data + header.code_relocs);
+
+        for ( uint64_t i = 0; i < header.num_relocs; ++i ) {
+            uint64_t slot = relocs[i];
+            uint64_t target;
+
+            if ( slot < sizeof(header) || slot + sizeof(uint64_t) > header.data_offset ) {
+                return grammar_load_fail(image, NULL, "grammar_load: die datei ist kein abbild");
+            }
+
+            memcpy(&target, nodes + slot, sizeof(target));
+            if ( target >= size ) {
+                return grammar_load_fail(image, NULL, "grammar_load: die datei ist kein abbild");
+            }
+
+            char *ptr = (target < header.data_offset) ? nodes + target : data + target;
+            memcpy(nodes + slot, &ptr, sizeof(ptr));
+        }
+
+        for ( uint64_t i = 0; i < header.num_code_relocs; ++i ) {
+            uint64_t slot = code_relocs[i];
+            int64_t delta;
+
+            if ( slot < sizeof(header) || slot + sizeof(uint64_t) > header.data_offset ) {
+                return grammar_load_fail(image, NULL, "grammar_load: die datei ist kein abbild");
+            }
+
+            memcpy(&delta, nodes + slot, sizeof(delta));
+
+            uintptr_t fn = (uintptr_t)&parser_create + (uintptr_t)delta;
+            memcpy(nodes + slot, &fn, sizeof(fn));
+        }
+
+        image->root  = (Parser *)(nodes + header.root);
+        image->lexer = header.lexer ? (Lexer *)(nodes + header.lexer) : NULL;
+
+        return true;
+    }
+
+    namespace api {
+        using Urq::Grammar_Image;
+        using Urq::grammar_save;
+        using Urq::grammar_load;
+        using Urq::grammar_unload;
+    }
+}
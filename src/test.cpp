@@ -1,14 +1,93 @@
 #include <assert.h>
+#include <thread>
 
 #include "combinator.cpp"
+#include "binary.cpp"
+#include "lexer.cpp"
+#include "utf8.cpp"
+#include "optimize.cpp"
+#include "typed.cpp"
+#include "incremental.cpp"
+#include "snapshot.cpp"
+#include "search.cpp"
+
+size_t alloc_count = 0;
 
 ALLOCATOR(custom_alloc) {
+    alloc_count++;
     printf("%zd bytes reserviert\n", size);
     void *mem = malloc(size);
 
     return mem;
 }
 
+struct Event_Trace {
+    char buf[64];
+    size_t len;
+};
+
+void
+event_trace_put(void *user_data, char c) {
+    Event_Trace *trace = (Event_Trace *)user_data;
+
+    if ( trace->len + 1 < sizeof(trace->buf) ) {
+        trace->buf[trace->len++] = c;
+        trace->buf[trace->len] = '\0';
+    }
+}
+
+int chain_calls = 0;
+
+struct Typed_Expr {
+    char         op;
+    uint64_t     num;
+    Typed_Expr * a;
+    Typed_Expr * b;
+};
+
+int64_t
+typed_eval(Typed_Expr *e) {
+    switch ( e->op ) {
+        case '+': return typed_eval(e->a) + typed_eval(e->b);
+        case '-': return typed_eval(e->a) - typed_eval(e->b);
+        case '*': return typed_eval(e->a) * typed_eval(e->b);
+    }
+
+    return (int64_t)e->num;
+}
+
+Urq::Parser_Result
+arith_build(Urq::Parser_Result op, Urq::Parser_Result lhs, Urq::Parser_Result rhs, void *user_data) {
+    int64_t a = lhs.s64.val;
+    int64_t b = rhs.s64.val;
+
+    switch ( op.chr.val ) {
+        case '+': return Urq::parser_result_s64(a + b);
+        case '-': return Urq::parser_result_s64(lhs.kind == Urq::PARSER_RESULT_NONE ? -b : a - b);
+        case '*': return Urq::parser_result_s64(a * b);
+
+        case '^': {
+            int64_t r = 1;
+            for ( int64_t i = 0; i < b; ++i ) {
+                r *= a;
+            }
+
+            return Urq::parser_result_s64(r);
+        }
+
+        case '!': {
+            int64_t r = 1;
+            for ( int64_t i = 2; i <= a; ++i ) {
+                r *= i;
+            }
+
+            return Urq::parser_result_s64(r);
+        }
+    }
+
+    return Urq::parser_result_none();
+}
+
 void
 parser_test() {
     using namespace Urq::api;
@@ -50,6 +129,11 @@ parser_test() {
     result = run(parser, "123abc");
     assert(result.success && result.result.arr.len == 2);
 
+    parser = Many(Chr('a'));
+    result = run(parser, "aaaaaaaaaaaaaaaaaaaab");
+    assert(result.success && result.result.arr.len == 20 && result.index == 20);
+    assert(parser_result_entry(&result.result.arr.val, 19).chr.val == 'a');
+
     parser = Many1(Choice({
         Letters,
         Digits
@@ -87,6 +171,846 @@ parser_test() {
     result = run(parser, "[1,2,3,4,5]");
     assert(result.success && result.result.arr.len == 5);
 
+    Parser *sep_parser = Seq_Of({ comma_proc(Digits), Chr(';'), Sep_By(Chr('|'))(Digits) });
+    result = run(sep_parser, "1,2;3|4|5");
+    assert(result.success && result.index == 9);
+
+    size_t allocs_before = alloc_count;
+    result = recognize(parser, "[1,2,3,4,5]");
+    assert(result.success && result.index == 11 && alloc_count == allocs_before);
+    result = recognize(parser, "[1,2,3,4,5");
+    assert(!result.success && alloc_count == allocs_before);
+
+    /* auch folgen mit mehr als acht gliedern und tiefe ausdrücke */
+    Parser *long_seq = Seq_Of({ Chr('a'), Chr('b'), Chr('c'), Chr('d'), Chr('e'),
+            Chr('f'), Chr('g'), Chr('h'), Chr('i'), Digits });
+    Parser *long_runs = optimize(Seq_Of({ Chr('a'), Chr('b'), Chr('c'), Chr('d'), Chr('e'),
+            Chr('f'), Chr('g'), Chr('h'), Chr('i'), Digits }));
+    Parser *power = Expression(Digit, {
+        { Urq::PARSER_OP_INFIX, Chr('^'), 1, Urq::PARSER_ASSOC_RIGHT, NULL },
+    });
+    allocs_before = alloc_count;
+    result = recognize(long_seq, "abcdefghi42");
+    assert(result.success && result.index == 11);
+    result = recognize(long_runs, "abcdefghi42");
+    assert(result.success && result.index == 11);
+    result = recognize(power, "1^2^3^4^5^6^7^8^9^1^2");
+    assert(result.success && result.index == 21 && alloc_count == allocs_before);
+
+    /* ein früh scheiternder langer Seq_Of fordert nicht mehr an als ein einzelnes Chr */
+    Parser *single = Chr('z');
+    allocs_before = alloc_count;
+    result = run(single, "abx");
+    size_t single_allocs = alloc_count - allocs_before;
+    allocs_before = alloc_count;
+    result = run(long_seq, "abx");
+    assert(!result.success && alloc_count - allocs_before == single_allocs);
+
+    parser = Seq_Of({ Skip(Many(Chr(' '))), Letters });
+    result = run(parser, "   abc");
+    assert(result.success && result.result.arr.len == 2);
+    assert(parser_result_entry(&result.result.arr.val, 0).kind == Urq::PARSER_RESULT_NONE);
+
+    char *capture_input = "abc:123x";
+    parser = Capture(Seq_Of({ Letters, Chr(':'), Digits }));
+    result = run(parser, capture_input);
+    assert(result.success && result.result.kind == Urq::PARSER_RESULT_STR);
+    assert(result.result.str.val == capture_input && result.result.str.len == 7);
+
+    Event_Trace trace = {};
+    Parser_Event_Handler handler = {};
+    handler.begin_node = [](Parser *node, Parser_Kind kind, void *user_data) { event_trace_put(user_data, '('); };
+    handler.value      = [](Parser_Result result, void *user_data) { event_trace_put(user_data, 'v'); };
+    handler.end_node   = [](Parser *node, Parser_Kind kind, void *user_data) { event_trace_put(user_data, ')'); };
+    handler.user_data  = &trace;
+
+    parser = brckt_proc(comma_proc(Digits));
+    result = run_events(parser, "[1,2,3]", &handler);
+    assert(result.success && strcmp(trace.buf, "(v(vvv)v)") == 0);
+
+    trace = {};
+    parser = Choice({ Seq_Of({ Letters, Digits }), Letters });
+    result = run_events(parser, "abc!", &handler);
+    assert(result.success && strcmp(trace.buf, "v") == 0);
+
+    /* auch gescheiterte knoten schließen ihre klammer */
+    trace = {};
+    result = run_events(Seq_Of({ Chr('a'), Seq_Of({ Chr('b'), Chr('c') }) }), "abx", &handler);
+    assert(!result.success && strcmp(trace.buf, "(v(v))") == 0);
+    trace = {};
+    result = run_events(Seq_Of({ Chr('a'), Many1(Chr('b')) }), "ax", &handler);
+    assert(!result.success && strcmp(trace.buf, "(v())") == 0);
+    trace = {};
+    result = run_events(Seq_Of({ Chr('a'), Sep_By1(Chr(','))(Chr('b')) }), "ax", &handler);
+    assert(!result.success && strcmp(trace.buf, "(v())") == 0);
+    trace = {};
+    result = run_events(optimize(Seq_Of({ Chr('a'), Many1(Chr('b')) })), "ax", &handler);
+    assert(!result.success && strcmp(trace.buf, "(v())") == 0);
+
+    /* auch ohne capture liefert Float dem handler den umgewandelten wert */
+    Parser_Result float_value = {};
+    Parser_Event_Handler float_handler = {};
+    float_handler.value     = [](Parser_Result result, void *user_data) { *(Parser_Result *)user_data = result; };
+    float_handler.user_data = &float_value;
+    result = run_events(Float(), "2.5", &float_handler);
+    assert(result.success && float_value.kind == Urq::PARSER_RESULT_F64 && float_value.f64.val == 2.5);
+
+    Grammar grammar = {};
+    grammar_begin(&grammar);
+    parser = Seq_Of({ Chr('a'), Choice({ Chr('b'), Chr('c') }), Fail("immer %d", 1) });
+    grammar_end();
+    assert(grammar.num_nodes == 6 && grammar.bytes > 0 && grammar.reserved >= grammar.bytes);
+    result = run(parser, "ab");
+    assert(!result.success && strcmp(result.msg, "immer 1") == 0);
+    grammar_free(&grammar);
+    assert(grammar.blocks == NULL && grammar.num_nodes == 0);
+
+    /* speicher gehört dem, der ihn angelegt hat, nicht der gerade aktiven grammatik */
+    grammar_begin(&grammar);
+    Parser *grown = Seq_Of({ Chr('a') });
+    grammar_end();
+    for ( int i = 0; i < 8; ++i ) {
+        Urq::parser_push(&grown->sequence, Chr('a'));
+    }
+    Parser *heap_grown = Seq_Of({ Chr('b') });
+    assert(Urq::grammar_owner(heap_grown->sequence.elems) == NULL);
+    grammar_begin(&grammar);
+    for ( int i = 0; i < 8; ++i ) {
+        Urq::parser_push(&heap_grown->sequence, Chr('b'));
+    }
+    grammar_end();
+    assert(Urq::grammar_owner(heap_grown->sequence.elems) == &grammar);
+    result = run(grown, "aaaaaaaaa");
+    assert(result.success && result.index == 9);
+    grammar_free(&grammar);
+
+    /* eine aktive grammatik unter einer anderen verschwindet aus dem stapel */
+    Grammar outer = {};
+    Grammar inner = {};
+    grammar_begin(&outer);
+    grammar_begin(&inner);
+    Chr('x');
+    grammar_free(&outer);
+    assert(inner.prev == NULL && Urq::parser_grammar == &inner);
+    grammar_end();
+    assert(Urq::parser_grammar == NULL);
+    grammar_free(&inner);
+
+#ifdef PARSER_PROFILE
+    parser_profile_reset();
+    Parser *word = parser_name(Letters, "word");
+    parser = Many(Choice({ word, Chr(' ') }));
+    result = run(parser, "ab cd ef");
+    assert(result.success && word->profile.calls == 6 && word->profile.successes == 3);
+    assert(word->profile.bytes == 6 && word->profile.backtracks == 3);
+    parser_profile_dump();
+
+    /* knoten einer freigegebenen grammatik verschwinden aus dem profil */
+    Grammar profiled = {};
+    grammar_begin(&profiled);
+    Parser *profiled_word = parser_name(Many1(Letters), "freigegeben");
+    grammar_end();
+    result = run(profiled_word, "abc");
+    assert(result.success && profiled_word->profile.calls == 1);
+    grammar_free(&profiled);
+    parser_profile_dump();
+    parser_profile_reset();
+#endif
+
+#ifdef PARSER_ALLOC_STATS
+    Parser *digits_list = parser_name(Many(Chr('1')), "einsen");
+    result = run(digits_list, "111x");
+    assert(result.success && digits_list->alloc_stats.count[Urq::PARSER_ALLOC_RESULT_LIST] == 1);
+    assert(digits_list->alloc_stats.bytes[Urq::PARSER_ALLOC_RESULT_LIST] == 3*sizeof(Parser_Result));
+
+    /* knoten einer freigegebenen grammatik verschwinden aus der statistik */
+    Grammar counted = {};
+    grammar_begin(&counted);
+    Parser *counted_list = parser_name(Many(Chr('1')), "freigegeben");
+    grammar_end();
+    result = run(counted_list, "11");
+    assert(result.success && counted_list->alloc_stats.count[Urq::PARSER_ALLOC_RESULT_LIST] == 1);
+    grammar_free(&counted);
+    parser_alloc_stats_dump();
+    result = run(digits_list, "1");
+    assert(result.success);
+#endif
+
+#ifdef PARSER_TRACE
+    Parser_Trace trace_log = {};
+    parser_trace_begin(&trace_log);
+    parser = Choice({ Seq_Of({ Letters, Chr('!') }), Seq_Of({ Letters, Chr('?') }) });
+    result = run(parser, "abc?");
+    parser_trace_end();
+    assert(result.success && trace_log.num_records == 7);
+    assert(trace_log.records[1].flags & Urq::PARSER_TRACE_DISCARDED);
+    assert(!(trace_log.records[4].flags & Urq::PARSER_TRACE_DISCARDED));
+    parser_trace_write_csv(&trace_log, stdout);
+    parser_trace_write_heatmap(&trace_log, stdout);
+    parser_trace_free(&trace_log);
+
+    /* aufzeichnungen überleben die grammatik ihrer knoten */
+    Grammar traced = {};
+    grammar_begin(&traced);
+    parser = Choice({ Seq_Of({ Letters, Chr('!') }), parser_name(Many1(Letters), "freigegeben") });
+    grammar_end();
+    parser_trace_begin(&trace_log);
+    result = run(parser, "abc?");
+    parser_trace_end();
+    assert(result.success && trace_log.num_records == 7);
+    grammar_free(&traced);
+    parser_trace_write_csv(&trace_log, stdout);
+    parser_trace_write_heatmap(&trace_log, stdout);
+    assert(parser_trace_write_binary(&trace_log, "trace_test.bin"));
+    remove("trace_test.bin");
+    parser_trace_free(&trace_log);
+#endif
+
+    auto operand = Map(Digits, [](Parser_Result result, size_t index, void *user_data) {
+        return parser_result_s64(strtoll(result.str.val, NULL, 10));
+    });
+    parser = Expression(operand, {
+        { Urq::PARSER_OP_PREFIX,  Chr('-'), 3, Urq::PARSER_ASSOC_RIGHT, arith_build },
+        { Urq::PARSER_OP_INFIX,   Chr('+'), 1, Urq::PARSER_ASSOC_LEFT,  arith_build },
+        { Urq::PARSER_OP_INFIX,   Chr('-'), 1, Urq::PARSER_ASSOC_LEFT,  arith_build },
+        { Urq::PARSER_OP_INFIX,   Chr('*'), 2, Urq::PARSER_ASSOC_LEFT,  arith_build },
+        { Urq::PARSER_OP_INFIX,   Chr('^'), 4, Urq::PARSER_ASSOC_RIGHT, arith_build },
+        { Urq::PARSER_OP_POSTFIX, Chr('!'), 5, Urq::PARSER_ASSOC_LEFT,  arith_build },
+    });
+    result = run(parser, "1+2*3-4");
+    assert(result.success && result.index == 7 && result.result.s64.val == 3);
+    result = run(parser, "2^3^2");
+    assert(result.success && result.result.s64.val == 512);
+    result = run(parser, "-2^2+10-3!");
+    assert(result.success && result.result.s64.val == 0);
+    result = run(parser, "2*");
+    assert(!result.success);
+    result = recognize(parser, "1+2*3-4");
+    assert(result.success && result.index == 7);
+
+    Parser *define_form = Choice({
+        Seq_Of({ Str("(define"), Cut(), Whitespace, Letters, Chr(')') }),
+        Seq_Of({ Chr('('), Many(Choice({ Letters, Digits, Chr(' ') })), Chr(')') })
+    });
+    result = run(define_form, "(define 1)");
+    assert(!result.success);
+    result = run(define_form, "(define x)");
+    assert(result.success);
+    result = run(define_form, "(abc 1)");
+    assert(result.success);
+
+    parser = Choice({ define_form, Str("(define 1)") });
+    result = run(parser, "(define 1)");
+    assert(result.success && result.index == 10);
+
+    parser = Many(Seq_Of({ Commit(Chr('<')), Letters, Chr('>') }));
+    result = run(parser, "<a><b>");
+    assert(result.success && result.result.arr.len == 2);
+    result = run(parser, "<a><1>");
+    assert(!result.success);
+
+    enum { TOK_IDENT, TOK_NUM, TOK_LPAREN, TOK_RPAREN, TOK_WS };
+    Lexer *lexer = lexer_create({
+        { TOK_IDENT,  "[a-z_][a-z0-9_]*" },
+        { TOK_NUM,    "-?\\d+(\\.\\d+)?" },
+        { TOK_LPAREN, "\\(" },
+        { TOK_RPAREN, "\\)" },
+        { TOK_WS,     "\\s+|;[^\\n]*", LEXER_RULE_SKIP },
+    });
+
+    Lexer_Token_List tokens = {};
+    size_t error_index = 0;
+    assert(lexer_run(lexer, "(define x1 -2.5) ; kommentar\n(y)", &tokens, &error_index));
+    assert(tokens.num_elems == 8);
+    assert(tokens.elems[1].kind == TOK_IDENT && tokens.elems[1].start == 1 && tokens.elems[1].len == 6);
+    assert(tokens.elems[3].kind == TOK_NUM && tokens.elems[3].len == 4);
+    lexer_token_free(&tokens);
+
+    assert(!lexer_run(lexer, "(x #)", &tokens, &error_index));
+    assert(error_index == 3);
+    lexer_token_free(&tokens);
+
+    Parser *sexpr = Many(Choice({
+        Seq_Of({ Token(TOK_LPAREN), Token_Text(TOK_IDENT, "define"), Token(TOK_IDENT), Token(TOK_NUM), Token(TOK_RPAREN) }),
+        Seq_Of({ Token(TOK_LPAREN), Many(Choice({ Token(TOK_IDENT), Token(TOK_NUM) })), Token(TOK_RPAREN) }),
+    }));
+    result = run_tokens(sexpr, lexer, "(define x 1)\n(definex 2 y)");
+    assert(result.success && result.index == 10 && result.result.arr.len == 2);
+    assert(result.result.arr.val.elems[0].arr.val.elems[1].str.len == 6);
+
+    result = run_tokens(sexpr, lexer, "(x 1) (define y 2)", PARSER_FLAG_NO_CAPTURE | PARSER_FLAG_NO_MESSAGES);
+    assert(result.success && result.index == 9 && result.result.kind == Urq::PARSER_RESULT_NONE);
+
+    result = run_tokens(Token(TOK_NUM), lexer, "(x $)");
+    assert(!result.success);
+
+    /* zeichenparser lesen über tokens nicht einfach rohen text */
+    result = run_tokens(Choice({ Seq_Of({ Token(TOK_LPAREN), Chr('x') }), Many(Token(TOK_LPAREN)) }), lexer, "(x 1)");
+    assert(!result.success && (result.flags & PARSER_FLAG_FATAL) && strstr(result.msg, "Chr: liest zeichen"));
+    result = run_tokens(optimize(Seq_Of({ Token(TOK_LPAREN), Chr('x'), Chr(' ') })), lexer, "(x 1)");
+    assert(!result.success && strstr(result.msg, "tokens"));
+
+    lexer = lexer_create({ { TOK_IDENT, "(ab" } });
+    assert(lexer->msg);
+    result = run_tokens(Token(TOK_IDENT), lexer, "ab");
+    assert(!result.success);
+
+    Parser *nested_inner = Seq_Of({ Chr('('), Empty, Chr(')') });
+    Parser *nested = Choice({ nested_inner, Map(Capture(Many1(Letters)), [](Parser_Result result, size_t index, void *user_data) {
+        return parser_result_u64(result.str.len);
+    }) });
+    fill_empty(nested_inner, nested);
+
+    size_t nested_depth = 100000;
+    char *deep = (char *)malloc(2*nested_depth + 2);
+    for ( size_t i = 0; i < nested_depth; ++i ) {
+        deep[i] = '(';
+        deep[nested_depth + 1 + i] = ')';
+    }
+    deep[nested_depth] = 'x';
+    deep[2*nested_depth + 1] = '\0';
+
+    result = run(nested, "((abc))");
+    assert(result.success && result.index == 7);
+    assert(result.result.arr.val.elems[1].arr.val.elems[1].u64.val == 3);
+
+    /* schon ohne eigene grenze scheitert eine zu tiefe eingabe, statt den stack zu sprengen */
+    assert(Urq::parser_max_depth == PARSER_DEFAULT_MAX_DEPTH);
+    result = run(nested, deep);
+    assert(!result.success && (result.flags & PARSER_FLAG_FATAL) && (result.flags & PARSER_FLAG_LIMIT));
+    assert(strstr(result.msg, "verschachtelungstiefe"));
+
+    /* zu tiefe eingaben scheitern endgültig, auch wenn eine alternative passen würde */
+    Urq::parser_max_depth = 1000;
+    parser = Choice({ nested, Many(Chr('(')) });
+    result = run(parser, deep);
+    assert(!result.success && (result.flags & PARSER_FLAG_FATAL));
+    result = recognize(parser, deep);
+    assert(!result.success && (result.flags & PARSER_FLAG_FATAL));
+    result = run(parser, "((x))");
+    assert(result.success);
+    Urq::parser_max_depth = PARSER_DEFAULT_MAX_DEPTH;
+
+    /* grenzen für schritte, speicher und laufzeit brechen den lauf strukturiert ab */
+    Parser_Limits limits = {};
+    limits.max_steps = 1000;
+    result = run(nested, deep, &limits);
+    assert(!result.success && (result.flags & PARSER_FLAG_FATAL) && (result.flags & PARSER_FLAG_LIMIT));
+    assert(limits.exceeded == PARSER_LIMIT_STEPS && limits.steps > 1000);
+    result = run(nested, "((abc))", &limits);
+    assert(result.success && limits.exceeded == PARSER_LIMIT_NONE && limits.steps > 0 && limits.bytes > 0);
+
+    limits = {};
+    limits.max_bytes = 4096;
+    result = run(Many(Digit), "1234567890123456789012345678901234567890123456789012345678901234567890"
+            "1234567890123456789012345678901234567890123456789012345678901234567890"
+            "1234567890123456789012345678901234567890123456789012345678901234567890", &limits);
+    assert(!result.success && (result.flags & PARSER_FLAG_LIMIT) && limits.exceeded == PARSER_LIMIT_MEMORY);
+
+    limits = {};
+    limits.max_time_us = 1;
+    result = run(nested, deep, &limits);
+    assert(!result.success && (result.flags & PARSER_FLAG_LIMIT) && limits.exceeded == PARSER_LIMIT_TIME);
+
+    /* auch ein abbruch im trenner beendet Sep_By */
+    limits = {};
+    limits.max_steps = 2;
+    result = run(Sep_By(Chr(','))(Digit), "1,2", &limits);
+    assert(!result.success && (result.flags & PARSER_FLAG_LIMIT) && limits.exceeded == PARSER_LIMIT_STEPS);
+
+    /* ebenso im operator eines ausdrucks */
+    limits = {};
+    limits.max_steps = 2;
+    result = run(Expression(Digit, {
+        { Urq::PARSER_OP_INFIX, Chr('+'), 1, Urq::PARSER_ASSOC_LEFT, NULL },
+    }), "1+2", &limits);
+    assert(!result.success && (result.flags & PARSER_FLAG_LIMIT) && limits.exceeded == PARSER_LIMIT_STEPS);
+
+    result = run(Expression(Digit, {
+        { Urq::PARSER_OP_INFIX, Seq_Of({ Chr('+'), Cut(), Chr('+') }), 1, Urq::PARSER_ASSOC_LEFT, NULL },
+    }), "1+2");
+    assert(!result.success && result.index == 2);
+
+    /* prä- und postfixoperatoren ohne fortschritt gelten als nicht vorhanden */
+    result = run(Expression(Digit, {
+        { Urq::PARSER_OP_PREFIX, Many(Chr('-')), 2, Urq::PARSER_ASSOC_RIGHT, NULL },
+        { Urq::PARSER_OP_POSTFIX, Many(Chr('!')), 3, Urq::PARSER_ASSOC_LEFT, NULL },
+        { Urq::PARSER_OP_INFIX, Chr('+'), 1, Urq::PARSER_ASSOC_LEFT, NULL },
+    }), "1+2");
+    assert(result.success && result.index == 3);
+
+    limits = {};
+    limits.max_steps = 1;
+    auto typed_limited = typed::run(typed::From_Parser<uint64_t>(Many(Digit), [](Parser_Result r) {
+        return (uint64_t)r.arr.len;
+    }), "123");
+    assert(typed_limited.success);
+    Parser_Limits *prev_limits = parser_limits_begin(&limits);
+    typed_limited = typed::run(typed::From_Parser<uint64_t>(Many(Digit), [](Parser_Result r) {
+        return (uint64_t)r.arr.len;
+    }), "123");
+    parser_limits_end(prev_limits);
+    assert(!typed_limited.success && limits.exceeded == PARSER_LIMIT_STEPS);
+
+    limits = {};
+    Urq::parser_max_depth = 1000;
+    result = run(nested, deep, &limits);
+    assert(!result.success && (result.flags & PARSER_FLAG_LIMIT) && limits.exceeded == PARSER_LIMIT_DEPTH);
+    Urq::parser_max_depth = PARSER_DEFAULT_MAX_DEPTH;
+    assert(Urq::parser_limits == NULL);
+    free(deep);
+
+    /* grenzen gelten nur für läufe auf dem thread, der sie gesetzt hat */
+    limits = {};
+    limits.max_steps = 1;
+    prev_limits = parser_limits_begin(&limits);
+    Parser_State thread_result = {};
+    std::thread limits_thread([&]() { thread_result = run(Many(Digit), "123"); });
+    limits_thread.join();
+    parser_limits_end(prev_limits);
+    assert(thread_result.success && thread_result.index == 3 && limits.steps == 0 && limits.bytes == 0);
+
+    /* wiederholungen ohne fortschritt enden, gescheiterte versuche verbrauchen nichts */
+    result = run(Many(Many(Chr('x'))), "abc");
+    assert(result.success && result.index == 0 && result.result.arr.len == 1);
+    result = run(Sep_By(Many(Chr(',')))(Many(Digit)), "abc");
+    assert(result.success && result.index == 0);
+    parser = Many(Seq_Of({ Chr('a'), Chr('b') }));
+    result = run(parser, "abac");
+    assert(result.success && result.index == 2 && result.result.arr.len == 1);
+    result = run(Seq_Of({ parser, Chr('a'), Chr('c') }), "abac");
+    assert(result.success && result.index == 4);
+    result = run(Sep_By(Chr(','))(Digit), "1,2,x");
+    assert(result.success && result.index == 3 && result.result.arr.len == 2);
+
+    result = run(Unsigned(10), "12345678901234567890x");
+    assert(result.success && result.index == 20 && result.result.u64.val == 12345678901234567890ull);
+    result = run(Unsigned(10), "18446744073709551616");
+    assert(!result.success);
+    result = run(Unsigned(2), "1012");
+    assert(result.success && result.index == 3 && result.result.u64.val == 5);
+    result = run(Unsigned(10), "x");
+    assert(!result.success);
+
+    result = run(Integer(10), "-9223372036854775808");
+    assert(result.success && result.result.s64.val == INT64_MIN);
+    result = run(Integer(10), "9223372036854775808");
+    assert(!result.success);
+    result = run(Integer(16), "-ff,");
+    assert(result.success && result.index == 3 && result.result.s64.val == -255);
+    result = run(Integer(), "-");
+    assert(!result.success);
+
+    result = run(Float(), "3.25");
+    assert(result.success && result.result.kind == Urq::PARSER_RESULT_F64 && result.result.f64.val == 3.25);
+    result = run(Float(), "-1.5e3,");
+    assert(result.success && result.index == 6 && result.result.f64.val == -1500.0);
+    result = run(Float(), "0.1");
+    assert(result.success && result.result.f64.val == 0.1);
+    result = run(Float(), ".5e");
+    assert(result.success && result.index == 2 && result.result.f64.val == 0.5);
+    result = run(Float(), "123456789012345678901234.5e-3");
+    assert(result.success && result.result.f64.val == strtod("123456789012345678901234.5e-3", NULL));
+    result = run(Float(), "2.2250738585072014e-308");
+    assert(result.success && result.result.f64.val == 2.2250738585072014e-308);
+    result = run(Float(), "0x10");
+    assert(result.success && result.index == 1 && result.result.f64.val == 0.0);
+    result = run(Float(), "e5");
+    assert(!result.success);
+
+    Parser_Trivia lisp_trivia = { ";", "#|", "|#" };
+    parser = Seq_Of({ Lexeme(Chr('('), &lisp_trivia), Lexeme(Letters, &lisp_trivia), Lexeme(Chr(')'), &lisp_trivia) });
+    result = run(parser, "(  abc ; kommentar\n #| block\n |#                                 ) \t\n");
+    assert(result.success && result.result.arr.len == 3 && result.index == 69);
+    assert(result.result.arr.val.elems[1].str.len == 3);
+    result = run(parser, "(abc #| offen )");
+    assert(!result.success);
+
+    /* ohne ende gibt es keine blockkommentare */
+    Parser_Trivia half_trivia = { NULL, "#|", NULL };
+    result = run(Lexeme(Letters, &half_trivia), "abc #| x");
+    assert(result.success && result.index == 4);
+    result = run(parser, "( abc ;\n)  ");
+    assert(result.success && result.index == 11);
+
+    Grammar lexeme_grammar = {};
+    lexeme_grammar.trivia = &lisp_trivia;
+    grammar_begin(&lexeme_grammar);
+    parser = Many(Lexeme(Chr('x')));
+    grammar_end();
+    result = run(parser, "x ;1\nx\tx #|2|#x");
+    assert(result.success && result.result.arr.len == 4 && result.index == 15);
+    result = run(Many(Lexeme(Chr('x'))), "x x ;1\nx");
+    assert(result.success && result.result.arr.len == 2 && result.index == 4);
+    grammar_free(&lexeme_grammar);
+
+    size_t utf8_error = 0;
+    assert(utf8_validate("grüße, 世界 𝄞 and a long ascii tail ........................................"));
+    assert(!utf8_validate("ok \xC0\xAF", &utf8_error) && utf8_error == 3);
+    assert(!utf8_validate("\xED\xA0\x80", &utf8_error) && utf8_error == 0);
+    assert(!utf8_validate("abc\xE4\xB8", &utf8_error) && utf8_error == 3);
+
+    result = run(Utf8_Char, "ü");
+    assert(result.success && result.index == 2 && result.result.u64.val == 0xFC);
+    result = run(Utf8_Char, "\xFF");
+    assert(!result.success);
+
+    result = run(Utf8_Class(UTF8_LETTER), "straßenbahnübergänge_x");
+    assert(result.success && result.index == 23);
+    result = run(Utf8_Class(UTF8_DIGIT), "12٣4 ");
+    assert(result.success && result.index == 5);
+    result = run(Utf8_Class(UTF8_SPACE), " \xE3\x80\x80\t x");
+    assert(result.success && result.index == 6);
+
+    result = run(Utf8_Ident, "_größe1 = 2");
+    assert(result.success && result.result.str.len == 9);
+    result = run(Utf8_Ident, "переменная_с_очень_длинным_именем_123+");
+    assert(result.success && result.index == strlen("переменная_с_очень_длинным_именем_123"));
+    result = run(Utf8_Ident, "1abc");
+    assert(!result.success);
+
+    Parser_Optimize_Report report = {};
+    parser = optimize(Many1(Choice({ Choice({ Str("bb"), Chr('a') }), Chr('b'), Chr('c'), Digit })), &report);
+    assert(report.choices_flattened == 1 && report.chr_sets == 1 && report.spans == 0);
+    assert(parser->p->sequence.num_elems == 3);
+    result = run(parser, "abb7cbx");
+    assert(result.success && result.index == 6 && result.result.arr.len == 5);
+    assert(result.result.arr.val.elems[0].chr.val == 'a' && result.result.arr.val.elems[1].str.len == 2);
+    assert(result.result.arr.val.elems[2].str.val[0] == '7' && result.result.arr.val.elems[4].chr.val == 'b');
+    result = run(parser, "x");
+    assert(!result.success);
+
+    report = {};
+    parser = optimize(Seq_Of({ Chr('('), Many(Choice({ Chr('x'), Chr('y') })), Chr(')'), Chr(';') }), &report);
+    assert(report.chr_sets == 1 && report.spans == 1 && report.chr_runs == 1);
+    assert(parser->sequence.elems[1]->kind == Urq::PARSER_KIND_CHR_SPAN);
+    result = run(parser, "(xyyx);");
+    assert(result.success && result.index == 7 && result.result.arr.len == 4);
+    assert(result.result.arr.val.elems[1].arr.len == 4 && result.result.arr.val.elems[1].arr.val.elems[1].chr.val == 'y');
+    assert(result.result.arr.val.elems[3].chr.val == ';');
+    result = run(parser, "(xy),");
+    assert(!result.success && result.index == 4);
+    result = run(parser, "();");
+    assert(result.success && result.result.arr.val.elems[1].arr.len == 0);
+
+    report = {};
+    parser = optimize(Many1(Digit), &report);
+    assert(report.spans == 1);
+    result = run(parser, "42a");
+    assert(result.success && result.index == 2 && result.result.arr.val.elems[1].str.val[0] == '2');
+    result = run(parser, "a");
+    assert(!result.success && !strcmp(result.msg, "many1: konnte keinen treffer erzielen"));
+
+    /* ein Cut im inneren zweig bleibt an seine Choice gebunden */
+    report = {};
+    parser = optimize(Choice({ Choice({ Seq_Of({ Chr('a'), Cut(), Chr('b') }), Chr('a') }), Str("ac") }), &report);
+    assert(report.choices_flattened == 0);
+    result = run(parser, "ac");
+    assert(result.success && result.index == 2);
+
+    /* typ-kennung, danach je nach typ ein anderer rumpf */
+    Parser *message = Switch(Letters, {
+        { "num",  Lexeme(Seq_Of({ Whitespace, Unsigned() })) },
+        { "name", Seq_Of({ Whitespace, Letters }) },
+    });
+    result = run(message, "num 42");
+    assert(result.success && result.index == 6 && result.result.arr.val.elems[1].u64.val == 42);
+    result = run(message, "name abc");
+    assert(result.success && result.result.arr.val.elems[1].str.len == 3);
+    result = run(message, "nope 1");
+    assert(!result.success && result.index == 0);
+    result = run(Many(Lexeme(message)), "num 1 name x num 3");
+    assert(result.success && result.result.arr.len == 3);
+
+    parser = Switch(Choice({ Chr('1'), Chr('2'), Chr('3') }), { { '1', Chr('a') }, { '3', Chr('b') } }, Succeed(parser_result_none()));
+    assert(parser->table->dense && parser->table->dense_len == 3);
+    result = run(parser, "3b");
+    assert(result.success && result.index == 2 && result.result.chr.val == 'b');
+    result = run(parser, "2b");
+    assert(result.success && result.index == 1);
+    result = run(Switch(Unsigned(), { { 7, Chr('x') }, { 100000, Chr('y') } }), "100000y");
+    assert(result.success && result.index == 7);
+
+    /* die fortsetzung wird je wert nur einmal gebaut */
+    parser = Many(Chain_Cached(Digit, [](Parser_Result result, void *user_data) {
+        chain_calls += 1;
+        return Chr((char)('a' + result.str.val[0] - '0'));
+    }));
+    result = run(parser, "0a1b0a0a1b2c");
+    assert(result.success && result.index == 12 && chain_calls == 3);
+
+    /* der cache hat eine feste größe und wächst beim parsen nicht */
+    chain_calls = 0;
+    Grammar chain_grammar = {};
+    grammar_begin(&chain_grammar);
+    Parser *limited = Chain_Cached(Letters, [](Parser_Result result, void *user_data) {
+        chain_calls += 1;
+        return (Parser *)user_data;
+    }, 2);
+    limited->user_data = Chr(':');
+    grammar_end();
+    size_t chain_bytes = chain_grammar.bytes;
+    result = run(Many(Lexeme(limited)), "a: bb: ccc: a: bb: ccc:");
+    assert(result.success && result.result.arr.len == 6 && chain_calls == 4);
+    assert(limited->table->cache->num == 2 && chain_grammar.bytes == chain_bytes);
+    grammar_free(&chain_grammar);
+
+    parser = Raw_String("Hi");
+    result = run(Seq_Of({ Bit, Bit, Bit, Bit, parser }), "\x04\x86\x90");
+    assert(result.success && result.index == 20);
+    result = run(parser, "Ho");
+    assert(!result.success && result.index == 8);
+
+    /* nach einer änderung wird nur die betroffene zeile neu geparst */
+    Parser *line = Memo(Seq_Of({ Letters, Chr('='), Digits, Chr('\n') }));
+    Parser *document = Many(line);
+
+    char doc[256] = "";
+    for ( int i = 0; i < 20; ++i ) {
+        strcat(doc, "abc=12\n");
+    }
+
+    Incremental inc = {};
+    result = incremental_begin(&inc, document, doc);
+    assert(result.success && result.index == 140 && result.result.arr.len == 20);
+    assert(inc.memo.misses == 21);
+
+    result = incremental_edit(&inc, 7*5 + 4, 2, "3456");
+    assert(result.success && result.index == 142 && result.result.arr.len == 20);
+    assert(inc.memo.misses == 1 && inc.memo.hits == 20);
+    assert(result.result.arr.val.elems[5].arr.val.elems[2].str.len == 4);
+    assert(!strncmp(result.result.arr.val.elems[19].arr.val.elems[0].str.val, "abc=12", 6));
+
+    /* am ende angefügt: die letzte zeile hat dort das nullbyte gesehen */
+    result = incremental_edit(&inc, 142, 0, "x=9\n");
+    assert(result.success && result.result.arr.len == 21 && inc.memo.misses == 2);
+
+    /* eine zeile gelöscht, das ergebnis gleicht einem vollständigen lauf */
+    result = incremental_edit(&inc, 7, 7, "");
+    Parser_State fresh = run(document, inc.text);
+    assert(result.success == fresh.success && result.index == fresh.index);
+    assert(result.result.arr.len == fresh.result.arr.len && result.result.arr.len == 20);
+    assert(!strcmp(inc.text + result.index, ""));
+    assert(inc.memo.misses == 1);
+
+    result = incremental_edit(&inc, 0, 0, "=");
+    assert(result.success && result.index == 0 && result.result.arr.len == 0);
+    result = incremental_edit(&inc, 0, 1, "");
+    assert(result.success && result.result.arr.len == 20 && inc.memo.misses == 0);
+    incremental_free(&inc);
+
+    /* ein fehlschlag hat weiter gelesen, als seine fehlerstelle zeigt */
+    document = Many(Memo(Choice({ Str("abcdef"), Chr('x') })));
+    result = incremental_begin(&inc, document, "abcdeY");
+    assert(result.success && result.index == 0);
+    result = incremental_edit(&inc, 5, 1, "f");
+    fresh = run(document, inc.text);
+    assert(result.success && result.index == 6 && fresh.index == 6);
+    incremental_free(&inc);
+
+    /* reihenfolge nach treffern, nur für alternativen die sich ausschließen */
+    parser = Adaptive_Choice({ Str("let"), Str("if"), Str("while"), Unsigned() });
+    assert(parser->kind == Urq::PARSER_KIND_ADAPTIVE_CHOICE);
+    assert(Adaptive_Choice({ Str("ab"), Str("abc") })->kind == Urq::PARSER_KIND_CHOICE);
+    assert(Adaptive_Choice({ Seq_Of({ Chr('a'), Letters }), Str("ax") })->kind == Urq::PARSER_KIND_CHOICE);
+    assert(Adaptive_Choice({ Seq_Of({ Chr('a'), Chr('b') }), Str("ax") })->kind == Urq::PARSER_KIND_ADAPTIVE_CHOICE);
+
+    for ( int i = 0; i < PARSER_ADAPTIVE_PERIOD; ++i ) {
+        result = run(parser, (char *)((i % 4) ? "while" : "12"));
+        assert(result.success);
+    }
+
+    uint64_t order = ((Urq::Parser_Adaptive *)parser->user_data)->order.load();
+    assert(Urq::parser_adaptive_at(order, 0) == 2 && Urq::parser_adaptive_at(order, 1) == 3);
+
+    result = run(parser, "if");
+    assert(result.success && result.index == 2);
+    result = run(parser, "x");
+    assert(!result.success && !strcmp(result.msg, "Unsigned: keine ziffern gefunden"));
+    result = run(Many(Lexeme(parser)), "let 7 while x");
+    assert(result.success && result.index == 12 && result.result.arr.len == 3);
+    result = run(parser, "x");
+    assert(!result.success && !strcmp(result.msg, "Unsigned: keine ziffern gefunden"));
+
+    /* abbild einer grammatik samt sprungtabelle, zeichenmengen, trivia und lexer */
+    {
+        Parser_Trivia block_trivia = { NULL, "#|", "|#" };
+        Parser *value = Switch(Choice({ Chr('#'), Chr('$') }), {
+            { '#', Unsigned(16) },
+            { '$', Lexeme(Letters, &block_trivia) },
+        });
+        Parser *arith = Expression(operand, {
+            { Urq::PARSER_OP_INFIX, Chr('+'), 1, Urq::PARSER_ASSOC_LEFT, arith_build },
+            { Urq::PARSER_OP_INFIX, Chr('*'), 2, Urq::PARSER_ASSOC_LEFT, arith_build },
+        });
+        Parser *image_grammar = optimize(Seq_Of({
+            parser_name(Many(Choice({ Chr('a'), Chr('b') })), "ab"),
+            Many(Seq_Of({ Chr(' '), Adaptive_Choice({ Str("let"), Str("if") }), Chr(' '), Chr('='), Chr(' '), value, Chr(';') })),
+            arith,
+            Succeed(parser_result_str("ende", 4)),
+            Chain_Cached(Chr('!'), [](Parser_Result result, void *user_data) { return Digits; }),
+        }));
+        Lexer *image_lexer = lexer_create({ { TOK_IDENT, "[a-z]+" }, { TOK_WS, "\\s+", LEXER_RULE_SKIP } });
+
+        char *image_msg = NULL;
+        assert(grammar_save(image_grammar, "grammar_test.img", image_lexer, &image_msg));
+
+        Grammar_Image image = {};
+        assert(grammar_load(&image, "grammar_test.img"));
+        assert(image.root != image_grammar && image.lexer);
+
+        char *text = "abba let = #ff; if = $xy #|c|# ;1+2*3!42";
+        Parser_State expected = run(image_grammar, text);
+        result = run(image.root, text);
+        assert(expected.success && result.success && result.index == expected.index);
+        assert(parser_entry(&image.root->sequence, 4)->table->cache->num == 1);
+        result = run(image.root, text);
+        assert(result.success && result.result.arr.val.elems[4].str.len == 2);
+        assert(result.result.arr.val.elems[1].arr.len == 2 && result.result.arr.val.elems[2].s64.val == 7);
+        assert(result.result.arr.val.elems[1].arr.val.elems[0].arr.val.elems[5].u64.val == 255);
+        assert(!strcmp(result.result.arr.val.elems[3].str.val, "ende"));
+        assert(!strcmp(parser_entry(&image.root->sequence, 0)->name, "ab"));
+
+        expected = run(image_grammar, "ab let = #zz;");
+        result = run(image.root, "ab let = #zz;");
+        assert(!result.success && result.index == expected.index && !strcmp(result.msg, expected.msg));
+
+        result = run_tokens(Many(Token(TOK_IDENT)), image.lexer, "ab  cd");
+        assert(result.success && result.result.arr.len == 2);
+
+        grammar_unload(&image);
+        remove("grammar_test.img");
+
+        Parser *opaque = Chr('x');
+        opaque->user_data = &block_trivia;
+        assert(!grammar_save(Many(opaque), "grammar_test.img", NULL, &image_msg));
+        assert(strstr(image_msg, "user_data"));
+        assert(!grammar_load(&image, "grammar_test.img") && image.msg && !image.root);
+    }
+
+    {
+        /* suchmodus: die vorfilter müssen dieselben treffer liefern wie ein versuch an
+         * jeder stelle */
+        char *haystack = (char *)malloc(4096 + 1);
+        for ( size_t i = 0; i < 4096; ++i ) {
+            haystack[i] = "ab#x1 2cd:ab9"[(i*7 + i/13) % 13];
+        }
+        haystack[4096] = '\0';
+
+        Parser *needles[] = {
+            Seq_Of({ Str("ab"), Digits }),
+            Seq_Of({ Chr('#'), Letters }),
+            Choice({ Chr(':'), Chr('#') }),
+            Digits,
+            Seq_Of({ Letters, Chr(':') }),
+            Choice({ Digits, Letters }),
+            Many(Chr('x')),
+            Seq_Of({ Str("2cd:ab"), Digit }),
+        };
+
+        for ( Parser *needle : needles ) {
+            size_t expected_matches = 0;
+            size_t expected_last = 0;
+
+            for ( size_t i = 0; i < 4096; ) {
+                Parser_State at = {};
+                at.success = true;
+                at.val     = haystack;
+                at.index   = i;
+                at = Urq::parser_call(needle, at);
+
+                if ( at.success && at.index > i ) {
+                    expected_matches += 1;
+                    expected_last = i;
+                    i = at.index;
+                } else {
+                    i += 1;
+                }
+            }
+
+            size_t last = 0;
+            size_t num_matches = find_all(needle, haystack, [](char *str, size_t start, const Parser_State &state, void *user_data) {
+                *(size_t *)user_data = start;
+
+                return true;
+            }, &last);
+            assert(num_matches == expected_matches && last == expected_last);
+        }
+        free(haystack);
+
+        Urq::Parser_Search search;
+        Urq::parser_search_init(&search, needles[0]);
+        assert(search.kind == Urq::PARSER_SEARCH_LITERAL && search.literal_len == 2);
+        Urq::parser_search_init(&search, needles[3]);
+        assert(search.kind == Urq::PARSER_SEARCH_RANGES && search.num_ranges == 1);
+        Urq::parser_search_init(&search, needles[5]);
+        assert(search.kind == Urq::PARSER_SEARCH_SET);
+        Urq::parser_search_init(&search, needles[6]);
+        assert(search.kind == Urq::PARSER_SEARCH_SCAN);
+
+        size_t start = 0;
+        result = find_first(Seq_Of({ Str("id="), Digits }), "name=x id=42 id=7", &start);
+        assert(result.success && start == 7 && result.index == 12);
+        result = find_first(Seq_Of({ Chr('#'), Digits }), "kein treffer", &start);
+        assert(!result.success && result.index == 12 && strstr(result.msg, "kein treffer"));
+        Parser_State found = {};
+        assert(find_all(Many(Chr('x')), "axxbx", NULL, NULL, PARSER_FLAG_NONE, &found) == 2);
+        assert(found.success);
+
+        Parser_Limits limits = {};
+        limits.max_steps = 10;
+        Parser_State error = {};
+        Parser_Limits *prev = parser_limits_begin(&limits);
+        assert(find_all(Digits, "1 2 3 4 5 6 7 8 9 10 11 12 13", NULL, NULL, PARSER_FLAG_NONE, &error) == 10);
+        parser_limits_end(prev);
+        assert(!error.success && (error.flags & PARSER_FLAG_LIMIT) && limits.exceeded == PARSER_LIMIT_STEPS);
+    }
+
+    {
+        auto digits = typed::Many1(typed::Choice(typed::Chr('0'), typed::Chr('1'), typed::Chr('2'), typed::Chr('3')));
+        auto pair = typed::Seq_Of(typed::Unsigned(), typed::Chr(':'), typed::Str("ab"), digits);
+        auto typed_result = typed::run(pair, "42:ab0312x");
+        assert(typed_result.success && typed_result.index == 9);
+        assert(std::get<0>(typed_result.val) == 42 && std::get<1>(typed_result.val) == ':');
+        assert(std::get<2>(typed_result.val).len == 2 && std::get<3>(typed_result.val).num_elems == 4);
+        assert(std::get<3>(typed_result.val).elems[3] == '2');
+
+        typed_result = typed::run(pair, "42:ac");
+        assert(!typed_result.success && typed_result.index == 3);
+        assert(!strcmp(typed_result.msg, "str: die zeichenkette wurde nicht gefunden"));
+
+        auto list = typed::Sep_By(typed::Map<int>(typed::Unsigned(), [](uint64_t v) { return (int)v*2; }), typed::Chr(','));
+        auto list_result = typed::run(list, "1,2,30;");
+        assert(list_result.success && list_result.index == 6 && list_result.val.num_elems == 3);
+        assert(list_result.val.elems[2] == 60);
+        assert(!typed::run(list, "1,2,").success);
+
+        /* rekursive ausdrücke als ast, ohne Parser_Result und void* */
+        auto expr = typed::Empty<Typed_Expr *>();
+        auto number = typed::Lexeme(typed::Map<Typed_Expr *>(typed::Unsigned(), [](uint64_t v) {
+            return typed::make<Typed_Expr>('n', v, (Typed_Expr *)NULL, (Typed_Expr *)NULL);
+        }));
+        auto op = typed::Lexeme(typed::Choice(typed::Chr('+'), typed::Chr('-'), typed::Chr('*')));
+        auto binary = typed::Map<Typed_Expr *>(
+            typed::Between(typed::Lexeme(typed::Chr('(')), typed::Lexeme(typed::Chr(')')))(typed::Seq_Of(op, expr, expr)),
+            [](std::tuple<char, Typed_Expr *, Typed_Expr *> t) {
+                return typed::make<Typed_Expr>(std::get<0>(t), (uint64_t)0, std::get<1>(t), std::get<2>(t));
+            });
+        typed::fill_empty(expr, typed::Choice(number, binary));
+
+        auto expr_result = typed::run(expr, "(+ 1 (* (- 10 5) 3))");
+        assert(expr_result.success && typed_eval(expr_result.val) == 16);
+
+        parser_max_depth = 8;
+        expr_result = typed::run(expr, "(+ 1 (+ 1 (+ 1 (+ 1 (+ 1 (+ 1 (+ 1 (+ 1 (+ 1 1)))))))))");
+        assert(!expr_result.success && strstr(expr_result.msg, "verschachtelungstiefe"));
+        parser_max_depth = PARSER_DEFAULT_MAX_DEPTH;
+
+        auto ident = typed::From_Parser<typed::Text>(Utf8_Ident, [](Parser_Result r) { return typed::Text{ r.str.val, r.str.len }; });
+        auto ident_result = typed::run(typed::Many(typed::Lexeme(ident)), "größe x1 _y 2");
+        assert(ident_result.success && ident_result.val.num_elems == 3 && ident_result.val.elems[0].len == 7);
+    }
+
     parser = Regex("[a-z]+");
     result = run(parser, "abcasj");
     int x = 5;
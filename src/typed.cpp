@@ -0,0 +1,648 @@
+#ifndef __PARSER_COMBINATOR_BASE__
+#include "combinator.cpp"
+#endif
+
+#include <new>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+
+/* getypte parser. ein typed::Parser<T> liefert sein ergebnis direkt als T, ohne den
+ * umweg über Parser_Result: Seq_Of ergibt ein std::tuple, Many eine Span<T>, Map
+ * wandelt mit einer gewöhnlichen funktion um. werte werden in den ergebnisplatz des
+ * aufrufers geschrieben und weitergeschoben, nicht kopiert oder in void* verpackt.
+ *
+ * knoten liegen wie gewohnt im grammatikspeicher und werden nie zerstört, sie halten
+ * daher nur zeiger. werte, die länger als ein parse leben sollen (ast-knoten), legt
+ * make<T> über parser_alloc an, mit einem arena-allocator also ohne einzelne
+ * heapaufrufe. auch Span<T> wird über parser_alloc angelegt und gibt ihre elemente
+ * nicht frei. T muß default-konstruierbar und verschiebbar sein.
+ *
+ * fehlermeldungen sind unformatiert wie bei PARSER_FLAG_NO_MESSAGES, ereignisse,
+ * profil und Cut gibt es in dieser schicht nicht. bestehende parser lassen sich mit
+ * From_Parser einbinden. */
+
+namespace Urq {
+    namespace typed {
+        struct State {
+            char   * val;
+            size_t   index;
+            char   * msg;
+            bool     fatal;  /* tiefe oder grenze überschritten, keine alternativen mehr */
+        };
+
+        template<typename T>
+        struct Node {
+            bool (*proc)(Node<T> *node, State *state, T *out);
+        };
+
+        template<typename T>
+        struct Parser {
+            typedef T Value;
+
+            Node<T> * node;
+        };
+
+        template<typename T>
+        struct Span {
+            T      * elems;
+            size_t   num_elems;
+        };
+
+        struct Text {
+            char   * val;
+            size_t   len;
+        };
+
+        template<typename T>
+        struct Result {
+            bool     success;
+            size_t   index;
+            char   * msg;
+            T        val;
+        };
+
+        /* verhindert die ableitung von T aus einem funktionsparameter, damit lambdas
+         * ohne erfassung in funktionszeiger umgewandelt werden */
+        template<typename T>
+        struct Same {
+            typedef T type;
+        };
+
+        template<typename N>
+        N *
+        node_create() {
+            static_assert(std::is_trivially_destructible<N>::value,
+                    "knoten im grammatikspeicher werden nicht zerstört");
+
+            N *result = new (grammar_alloc(sizeof(N))) N();
+
+            return result;
+        }
+
+        /* legt einen wert über parser_alloc an, z.b. einen ast-knoten */
+        template<typename T, typename... Args>
+        T *
+        make(Args&&... args) {
+            T *result = new (parser_alloc_tagged(sizeof(T), PARSER_ALLOC_VALUES)) T{std::forward<Args>(args)...};
+
+            return result;
+        }
+
+        template<typename T>
+        bool
+        call(Node<T> *node, State *state, T *out) {
+            bool result = node->proc(node, state, out);
+
+            return result;
+        }
+
+        bool
+        fail(State *state, char *msg) {
+            state->msg = msg;
+
+            return false;
+        }
+
+        template<typename T>
+        void
+        span_push(Span<T> *span, size_t *cap, T &&val) {
+            if ( span->num_elems == *cap ) {
+                size_t new_cap = (*cap < 8) ? 8 : *cap*2;
+                T *elems = (T *)parser_alloc_tagged(sizeof(T)*new_cap, PARSER_ALLOC_RESULT_LIST);
+
+                for ( size_t i = 0; i < span->num_elems; ++i ) {
+                    new (&elems[i]) T(std::move(span->elems[i]));
+                    span->elems[i].~T();
+                }
+
+                if ( span->elems ) {
+                    parser_dealloc(span->elems);
+                }
+
+                span->elems = elems;
+                *cap = new_cap;
+            }
+
+            new (&span->elems[span->num_elems]) T(std::move(val));
+            span->num_elems += 1;
+        }
+
+        template<typename T>
+        void
+        span_free(Span<T> *span) {
+            for ( size_t i = 0; i < span->num_elems; ++i ) {
+                span->elems[i].~T();
+            }
+
+            if ( span->elems ) {
+                parser_dealloc(span->elems);
+            }
+
+            *span = {};
+        }
+
+        /* ------------------------------------------------------------------------------ */
+        /* blätter                                                                        */
+        /* ------------------------------------------------------------------------------ */
+
+        struct Chr_Node : Node<char> {
+            char c;
+        };
+
+        Parser<char>
+        Chr(char c) {
+            Chr_Node *n = node_create<Chr_Node>();
+            n->c = c;
+            n->proc = [](Node<char> *node, State *state, char *out) {
+                char c = ((Chr_Node *)node)->c;
+
+                if ( state->val[state->index] != c ) {
+                    return fail(state, "chr: das gesuchte zeichen wurde nicht gefunden");
+                }
+
+                state->index += 1;
+                *out = c;
+
+                return true;
+            };
+
+            return { n };
+        }
+
+        struct Str_Node : Node<Text> {
+            char   * str;
+            size_t   len;
+        };
+
+        Parser<Text>
+        Str(char *str) {
+            Str_Node *n = node_create<Str_Node>();
+            n->str = str;
+            n->len = strlen(str);
+            n->proc = [](Node<Text> *node, State *state, Text *out) {
+                Str_Node *n = (Str_Node *)node;
+                char *s = state->val + state->index;
+
+                if ( strncmp(s, n->str, n->len) != 0 ) {
+                    return fail(state, "str: die zeichenkette wurde nicht gefunden");
+                }
+
+                state->index += n->len;
+                *out = { s, n->len };
+
+                return true;
+            };
+
+            return { n };
+        }
+
+        struct Unsigned_Node : Node<uint64_t> {
+            uint32_t base;
+        };
+
+        Parser<uint64_t>
+        Unsigned(int base = 10) {
+            Unsigned_Node *n = node_create<Unsigned_Node>();
+            n->base = (base < 2 || base > 36) ? 0 : base;
+            n->proc = [](Node<uint64_t> *node, State *state, uint64_t *out) {
+                if ( ((Unsigned_Node *)node)->base == 0 ) {
+                    return fail(state, "Unsigned: die basis muß zwischen 2 und 36 liegen");
+                }
+
+                bool overflow = false;
+                size_t len = parser_scan_unsigned(state->val + state->index,
+                        ((Unsigned_Node *)node)->base, out, &overflow);
+
+                if ( len == 0 ) {
+                    return fail(state, "Unsigned: keine ziffern gefunden");
+                }
+
+                if ( overflow ) {
+                    return fail(state, "Unsigned: die zahl ist zu groß für 64 bit");
+                }
+
+                state->index += len;
+
+                return true;
+            };
+
+            return { n };
+        }
+
+        /* bindet einen ungetypten parser ein. convert wandelt sein ergebnis um. ein
+         * abbruch (PARSER_FLAG_FATAL) setzt fatal, ein cut gilt nur innerhalb von p. */
+        template<typename T>
+        struct From_Parser_Node : Node<T> {
+            Urq::Parser * p;
+            T (*convert)(Parser_Result result);
+        };
+
+        template<typename T>
+        Parser<T>
+        From_Parser(Urq::Parser *p, typename Same<T (*)(Parser_Result)>::type convert) {
+            From_Parser_Node<T> *n = node_create<From_Parser_Node<T>>();
+            n->p = p;
+            n->convert = convert;
+            n->proc = [](Node<T> *node, State *state, T *out) {
+                From_Parser_Node<T> *n = (From_Parser_Node<T> *)node;
+
+                Parser_Context ctx = {};
+                Parser_State in = {};
+                in.success = true;
+                in.val     = state->val;
+                in.index   = state->index;
+                in.flags   = PARSER_FLAG_NO_MESSAGES | PARSER_FLAG_NO_EVENTS;
+                parser_limits_attach(&in, &ctx);
+
+                Parser_State result = parser_call(n->p, in);
+
+                if ( !result.success ) {
+                    state->index = result.index;
+                    state->fatal = (result.flags & PARSER_FLAG_FATAL) != 0;
+
+                    return fail(state, result.msg);
+                }
+
+                state->index = result.index;
+                *out = n->convert(result.result);
+
+                return true;
+            };
+
+            return { n };
+        }
+
+        /* ------------------------------------------------------------------------------ */
+        /* kombinatoren                                                                   */
+        /* ------------------------------------------------------------------------------ */
+
+        template<typename T, typename U>
+        struct Map_Node : Node<U> {
+            Node<T> * p;
+            U (*map)(T val);
+        };
+
+        template<typename U, typename T>
+        Parser<U>
+        Map(Parser<T> p, typename Same<U (*)(T)>::type map) {
+            Map_Node<T, U> *n = node_create<Map_Node<T, U>>();
+            n->p = p.node;
+            n->map = map;
+            n->proc = [](Node<U> *node, State *state, U *out) {
+                Map_Node<T, U> *n = (Map_Node<T, U> *)node;
+                T val{};
+
+                if ( !call(n->p, state, &val) ) {
+                    return false;
+                }
+
+                *out = n->map(std::move(val));
+
+                return true;
+            };
+
+            return { n };
+        }
+
+        template<typename... T>
+        struct Seq_Of_Node : Node<std::tuple<T...>> {
+            std::tuple<Node<T> *...> sequence;
+        };
+
+        template<typename... T, size_t... I>
+        bool
+        seq_of_call(Seq_Of_Node<T...> *n, State *state, std::tuple<T...> *out, std::index_sequence<I...>) {
+            bool result = (call(std::get<I>(n->sequence), state, &std::get<I>(*out)) && ...);
+
+            return result;
+        }
+
+        /* die glieder schreiben direkt in ihr feld des tupels */
+        template<typename... T>
+        Parser<std::tuple<T...>>
+        Seq_Of(Parser<T>... sequence) {
+            Seq_Of_Node<T...> *n = node_create<Seq_Of_Node<T...>>();
+            n->sequence = std::make_tuple(sequence.node...);
+            n->proc = [](Node<std::tuple<T...>> *node, State *state, std::tuple<T...> *out) {
+                return seq_of_call((Seq_Of_Node<T...> *)node, state, out, std::index_sequence_for<T...>());
+            };
+
+            return { n };
+        }
+
+        template<typename T>
+        struct Choice_Node : Node<T> {
+            Node<T> ** alternatives;
+            size_t     num_alternatives;
+        };
+
+        /* wie bei Choice bleibt die meldung der letzten alternative stehen */
+        template<typename T, typename... R>
+        Parser<T>
+        Choice(Parser<T> first, Parser<R>... rest) {
+            static_assert((std::is_same<T, R>::value && ...), "Choice: alle alternativen brauchen den gleichen typ");
+
+            Choice_Node<T> *n = node_create<Choice_Node<T>>();
+            n->num_alternatives = 1 + sizeof...(R);
+            n->alternatives = (Node<T> **)grammar_alloc(sizeof(Node<T> *)*n->num_alternatives);
+
+            Node<T> *alternatives[] = { first.node, rest.node... };
+            for ( size_t i = 0; i < n->num_alternatives; ++i ) {
+                n->alternatives[i] = alternatives[i];
+            }
+
+            n->proc = [](Node<T> *node, State *state, T *out) {
+                Choice_Node<T> *n = (Choice_Node<T> *)node;
+                size_t start = state->index;
+                size_t error_index = start;
+
+                for ( size_t i = 0; i < n->num_alternatives; ++i ) {
+                    state->index = start;
+
+                    if ( call(n->alternatives[i], state, out) ) {
+                        return true;
+                    }
+
+                    error_index = state->index;
+
+                    if ( state->fatal ) {
+                        break;
+                    }
+                }
+
+                state->index = error_index;
+
+                return false;
+            };
+
+            return { n };
+        }
+
+        template<typename T>
+        struct Many_Node : Node<Span<T>> {
+            Node<T> * p;
+            size_t    min;
+        };
+
+        template<typename T>
+        bool
+        parser_many_proc(Node<Span<T>> *node, State *state, Span<T> *out) {
+            Many_Node<T> *n = (Many_Node<T> *)node;
+            size_t start = state->index;
+            size_t cap = 0;
+            *out = {};
+
+            for ( ;; ) {
+                size_t mark = state->index;
+                T val{};
+
+                if ( !call(n->p, state, &val) ) {
+                    if ( state->fatal ) {
+                        span_free(out);
+                        return false;
+                    }
+
+                    state->index = mark;
+                    break;
+                }
+
+                span_push(out, &cap, std::move(val));
+
+                /* ohne fortschritt würde die schleife nie enden */
+                if ( state->index == mark ) {
+                    break;
+                }
+            }
+
+            if ( out->num_elems < n->min ) {
+                span_free(out);
+                state->index = start;
+
+                return fail(state, "many1: konnte keinen treffer erzielen");
+            }
+
+            state->msg = NULL;
+
+            return true;
+        }
+
+        template<typename T>
+        Parser<Span<T>>
+        Many(Parser<T> p) {
+            Many_Node<T> *n = node_create<Many_Node<T>>();
+            n->p = p.node;
+            n->proc = parser_many_proc<T>;
+
+            return { n };
+        }
+
+        template<typename T>
+        Parser<Span<T>>
+        Many1(Parser<T> p) {
+            Many_Node<T> *n = node_create<Many_Node<T>>();
+            n->p = p.node;
+            n->min = 1;
+            n->proc = parser_many_proc<T>;
+
+            return { n };
+        }
+
+        template<typename T, typename S>
+        struct Sep_By_Node : Node<Span<T>> {
+            Node<T> * p;
+            Node<S> * sep;
+        };
+
+        /* null oder mehr p, getrennt durch sep. die trenner werden verworfen. */
+        template<typename T, typename S>
+        Parser<Span<T>>
+        Sep_By(Parser<T> p, Parser<S> sep) {
+            Sep_By_Node<T, S> *n = node_create<Sep_By_Node<T, S>>();
+            n->p = p.node;
+            n->sep = sep.node;
+            n->proc = [](Node<Span<T>> *node, State *state, Span<T> *out) {
+                Sep_By_Node<T, S> *n = (Sep_By_Node<T, S> *)node;
+                size_t cap = 0;
+                *out = {};
+
+                for ( ;; ) {
+                    size_t start = state->index;
+                    size_t mark  = start;
+                    T val{};
+
+                    if ( !call(n->p, state, &val) ) {
+                        if ( state->fatal ) {
+                            span_free(out);
+                            return false;
+                        }
+
+                        /* nach einem trenner muß ein element folgen */
+                        if ( out->num_elems > 0 ) {
+                            span_free(out);
+                            return false;
+                        }
+
+                        state->index = mark;
+                        break;
+                    }
+
+                    span_push(out, &cap, std::move(val));
+
+                    mark = state->index;
+                    S sep{};
+
+                    if ( !call(n->sep, state, &sep) ) {
+                        if ( state->fatal ) {
+                            span_free(out);
+                            return false;
+                        }
+
+                        state->index = mark;
+                        break;
+                    }
+
+                    /* ohne fortschritt würde die schleife nie enden */
+                    if ( state->index == start ) {
+                        break;
+                    }
+                }
+
+                state->msg = NULL;
+
+                return true;
+            };
+
+            return { n };
+        }
+
+        template<typename T>
+        struct Lexeme_Node : Node<T> {
+            Node<T>       * p;
+            Parser_Trivia * trivia;
+        };
+
+        /* wie Lexeme: p, danach leerraum und kommentare */
+        template<typename T>
+        Parser<T>
+        Lexeme(Parser<T> p, Parser_Trivia *trivia = NULL) {
+            Lexeme_Node<T> *n = node_create<Lexeme_Node<T>>();
+            n->p = p.node;
+
+            if ( !trivia && parser_grammar ) {
+                trivia = parser_grammar->trivia;
+            }
+
+            if ( trivia ) {
+                n->trivia = (Parser_Trivia *)grammar_alloc(sizeof(Parser_Trivia));
+                *n->trivia = *trivia;
+            }
+
+            n->proc = [](Node<T> *node, State *state, T *out) {
+                Lexeme_Node<T> *n = (Lexeme_Node<T> *)node;
+
+                if ( !call(n->p, state, out) ) {
+                    return false;
+                }
+
+                state->index = parser_skip_trivia(n->trivia, state->val + state->index) - state->val;
+
+                return true;
+            };
+
+            return { n };
+        }
+
+        template<typename A, typename T, typename B>
+        struct Between_Node : Node<T> {
+            Node<A> * left;
+            Node<T> * p;
+            Node<B> * right;
+        };
+
+        /* wie Between: Between(l, r)(p) liefert das ergebnis von p */
+        template<typename A, typename B>
+        auto
+        Between(Parser<A> left, Parser<B> right) {
+            auto result = [=](auto p) {
+                typedef typename decltype(p)::Value T;
+
+                Between_Node<A, T, B> *n = node_create<Between_Node<A, T, B>>();
+                n->left  = left.node;
+                n->p     = p.node;
+                n->right = right.node;
+                n->proc  = [](Node<T> *node, State *state, T *out) {
+                    Between_Node<A, T, B> *n = (Between_Node<A, T, B> *)node;
+                    A a{};
+                    B b{};
+
+                    bool result = call(n->left, state, &a) && call(n->p, state, out) &&
+                                  call(n->right, state, &b);
+
+                    return result;
+                };
+
+                return Parser<T>{ n };
+            };
+
+            return result;
+        }
+
+        template<typename T>
+        struct Empty_Node : Node<T> {
+            Node<T> * p;
+        };
+
+        /* platzhalter für rekursive grammatiken, wird mit fill_empty gesetzt. hier wird
+         * auch parser_max_depth geprüft. */
+        template<typename T>
+        Parser<T>
+        Empty() {
+            Empty_Node<T> *n = node_create<Empty_Node<T>>();
+            n->proc = [](Node<T> *node, State *state, T *out) {
+                Empty_Node<T> *n = (Empty_Node<T> *)node;
+
+                size_t max_depth = parser_max_depth;
+                if ( !max_depth ) {
+                    return call(n->p, state, out);
+                }
+
+                if ( parser_depth >= max_depth ) {
+                    state->fatal = true;
+                    return fail(state, "parser: maximale verschachtelungstiefe überschritten");
+                }
+
+                parser_depth += 1;
+                bool result = call(n->p, state, out);
+                parser_depth -= 1;
+
+                return result;
+            };
+
+            return { n };
+        }
+
+        template<typename T>
+        void
+        fill_empty(Parser<T> dest, Parser<T> src) {
+            ((Empty_Node<T> *)dest.node)->p = src.node;
+        }
+
+        template<typename T>
+        Result<T>
+        run(Parser<T> p, char *str) {
+            Result<T> result = {};
+            State state = { str, 0, NULL, false };
+
+            result.success = call(p.node, &state, &result.val);
+            result.index   = state.index;
+            result.msg     = result.success ? NULL : state.msg;
+
+            return result;
+        }
+    }
+
+    namespace api {
+        namespace typed = Urq::typed;
+    }
+}
@@ -0,0 +1,353 @@
+#ifndef __PARSER_COMBINATOR_BASE__
+#include "combinator.cpp"
+#endif
+
+#include "utf8_tables.cpp"
+
+/* zeichenklassen über utf-8. reine ascii-abschnitte werden mit SSE2 in blöcken von 32
+ * bytes geprüft, erst bei gesetztem hohen bit wird zeichenweise dekodiert. wie bei
+ * parser_skip_whitespace sind alle blöcke ausgerichtet und bleiben auf ihrer
+ * speicherseite. */
+
+namespace Urq {
+    enum Utf8_Property {
+        UTF8_LETTER,
+        UTF8_DIGIT,
+        UTF8_SPACE,
+        UTF8_IDENT_START,
+        UTF8_IDENT_CONTINUE,
+
+        UTF8_NUM_PROPERTIES,
+    };
+
+    /* ascii-zeichen, die im block am stück geprüft werden können */
+    enum Utf8_Ascii {
+        UTF8_ASCII_LETTER     = 1 << 0,
+        UTF8_ASCII_DIGIT      = 1 << 1,
+        UTF8_ASCII_UNDERSCORE = 1 << 2,
+        UTF8_ASCII_ANY        = 1 << 3, /* jedes ascii-zeichen außer dem nullbyte */
+    };
+
+    struct Utf8_Table {
+        uint32_t (*ranges)[2];
+        size_t    num_ranges;
+        uint32_t  ascii;       /* Utf8_Ascii, 0 wenn ascii über die tabelle geht */
+    };
+
+    Utf8_Table utf8_tables[UTF8_NUM_PROPERTIES] = {
+        { utf8_letter_ranges,         sizeof(utf8_letter_ranges)/sizeof(utf8_letter_ranges[0]),
+          UTF8_ASCII_LETTER },
+        { utf8_digit_ranges,          sizeof(utf8_digit_ranges)/sizeof(utf8_digit_ranges[0]),
+          UTF8_ASCII_DIGIT },
+        { utf8_space_ranges,          sizeof(utf8_space_ranges)/sizeof(utf8_space_ranges[0]),
+          0 },
+        { utf8_ident_start_ranges,    sizeof(utf8_ident_start_ranges)/sizeof(utf8_ident_start_ranges[0]),
+          UTF8_ASCII_LETTER | UTF8_ASCII_UNDERSCORE },
+        { utf8_ident_continue_ranges, sizeof(utf8_ident_continue_ranges)/sizeof(utf8_ident_continue_ranges[0]),
+          UTF8_ASCII_LETTER | UTF8_ASCII_DIGIT | UTF8_ASCII_UNDERSCORE },
+    };
+
+    /* dekodiert ein zeichen ab str. liefert die länge in bytes oder 0 bei ungültigem
+     * utf-8 (überlange formen, surrogate, über 0x10FFFF). das nullbyte beendet jede
+     * folge, dahinter wird nicht gelesen. */
+    uint32_t
+    utf8_decode(char *str, uint32_t *cp) {
+        uint8_t *s = (uint8_t *)str;
+
+        if ( s[0] < 0x80 ) {
+            *cp = s[0];
+            return 1;
+        }
+
+        if ( s[0] < 0xC2 ) {
+            return 0;
+        }
+
+        if ( s[0] < 0xE0 ) {
+            if ( (s[1] & 0xC0) != 0x80 ) {
+                return 0;
+            }
+
+            *cp = ((uint32_t)(s[0] & 0x1F) << 6) | (s[1] & 0x3F);
+            return 2;
+        }
+
+        if ( s[0] < 0xF0 ) {
+            if ( (s[1] & 0xC0) != 0x80 || (s[2] & 0xC0) != 0x80 ) {
+                return 0;
+            }
+
+            uint32_t result = ((uint32_t)(s[0] & 0x0F) << 12) | ((uint32_t)(s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+            if ( result < 0x800 || (result >= 0xD800 && result <= 0xDFFF) ) {
+                return 0;
+            }
+
+            *cp = result;
+            return 3;
+        }
+
+        if ( s[0] < 0xF5 ) {
+            if ( (s[1] & 0xC0) != 0x80 || (s[2] & 0xC0) != 0x80 || (s[3] & 0xC0) != 0x80 ) {
+                return 0;
+            }
+
+            uint32_t result = ((uint32_t)(s[0] & 0x07) << 18) | ((uint32_t)(s[1] & 0x3F) << 12) |
+                              ((uint32_t)(s[2] & 0x3F) << 6)  | (s[3] & 0x3F);
+            if ( result < 0x10000 || result > 0x10FFFF ) {
+                return 0;
+            }
+
+            *cp = result;
+            return 4;
+        }
+
+        return 0;
+    }
+
+    bool
+    utf8_ascii_match(uint32_t ascii, uint8_t c) {
+        if ( (ascii & UTF8_ASCII_ANY) && c != 0 && c < 0x80 ) {
+            return true;
+        }
+
+        if ( (ascii & UTF8_ASCII_LETTER) && ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') ) {
+            return true;
+        }
+
+        if ( (ascii & UTF8_ASCII_DIGIT) && c >= '0' && c <= '9' ) {
+            return true;
+        }
+
+        if ( (ascii & UTF8_ASCII_UNDERSCORE) && c == '_' ) {
+            return true;
+        }
+
+        return false;
+    }
+
+    bool
+    utf8_has_property(uint32_t cp, Utf8_Property property) {
+        Utf8_Table *table = &utf8_tables[property];
+
+        if ( cp < 0x80 && table->ascii ) {
+            return utf8_ascii_match(table->ascii, (uint8_t)cp);
+        }
+
+        size_t lo = 0;
+        size_t hi = table->num_ranges;
+
+        while ( lo < hi ) {
+            size_t mid = lo + (hi - lo) / 2;
+
+            if ( cp < table->ranges[mid][0] ) {
+                hi = mid;
+            } else if ( cp > table->ranges[mid][1] ) {
+                lo = mid + 1;
+            } else {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+#if PARSER_SSE2
+    __m128i
+    utf8_ascii_mask(__m128i v, uint32_t ascii) {
+        __m128i result = _mm_setzero_si128();
+
+        /* bytes ab 0x80 sind als vorzeichenbehaftete zahlen negativ und fallen aus allen
+         * bereichen heraus */
+        if ( ascii & UTF8_ASCII_ANY ) {
+            result = _mm_cmpgt_epi8(v, _mm_setzero_si128());
+        }
+
+        if ( ascii & UTF8_ASCII_LETTER ) {
+            __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+            result = _mm_or_si128(result, _mm_and_si128(
+                    _mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                    _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1))));
+        }
+
+        if ( ascii & UTF8_ASCII_DIGIT ) {
+            result = _mm_or_si128(result, _mm_and_si128(
+                    _mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                    _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1))));
+        }
+
+        if ( ascii & UTF8_ASCII_UNDERSCORE ) {
+            result = _mm_or_si128(result, _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+        }
+
+        return result;
+    }
+#endif
+
+    /* überspringt ascii-zeichen der klassen ascii und liefert das erste andere byte. */
+    PARSER_NO_SANITIZE char *
+    utf8_skip_ascii(char *s, uint32_t ascii) {
+        if ( !ascii ) {
+            return s;
+        }
+
+#if PARSER_SSE2
+        uintptr_t offset = (uintptr_t)s & 31;
+        char *block = s - offset;
+        uint32_t before = (offset == 0) ? 0 : (uint32_t)((1ull << offset) - 1);
+
+        for ( ;; ) {
+            __m128i lo = _mm_load_si128((__m128i *)block);
+            __m128i hi = _mm_load_si128((__m128i *)(block + 16));
+
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(utf8_ascii_mask(lo, ascii)) |
+                            ((uint32_t)_mm_movemask_epi8(utf8_ascii_mask(hi, ascii)) << 16) |
+                            before;
+
+            if ( mask != 0xFFFFFFFF ) {
+                return block + parser_ctz32(~mask);
+            }
+
+            block += 32;
+            before = 0;
+        }
+#else
+        while ( utf8_ascii_match(ascii, (uint8_t)*s) ) {
+            s++;
+        }
+
+        return s;
+#endif
+    }
+
+    /* prüft ob str durchgehend gültiges utf-8 ist. bei einem fehler wird false geliefert
+     * und die position des fehlerhaften bytes in error_index abgelegt. */
+    bool
+    utf8_validate(char *str, size_t *error_index = NULL) {
+        char *s = str;
+
+        for ( ;; ) {
+            s = utf8_skip_ascii(s, UTF8_ASCII_ANY);
+
+            if ( *s == '\0' ) {
+                return true;
+            }
+
+            uint32_t cp;
+            uint32_t len = utf8_decode(s, &cp);
+
+            if ( len == 0 ) {
+                if ( error_index ) {
+                    *error_index = s - str;
+                }
+
+                return false;
+            }
+
+            s += len;
+        }
+    }
+
+    /* liest zeichen mit property ab s und liefert das ende. */
+    char *
+    utf8_skip_property(char *s, Utf8_Property property) {
+        uint32_t ascii = utf8_tables[property].ascii;
+
+        for ( ;; ) {
+            s = utf8_skip_ascii(s, ascii);
+
+            uint32_t cp;
+            uint32_t len = utf8_decode(s, &cp);
+
+            if ( len == 0 || cp == 0 || !utf8_has_property(cp, property) ) {
+                return s;
+            }
+
+            s += len;
+        }
+    }
+
+    /* ein beliebiges, gültig kodiertes zeichen. ergebnis ist der codepoint als u64. */
+    Parser *Utf8_Char = parser_create([](Parser *p, const Parser_State &state) {
+        if ( !state.success ) {
+            return state;
+        }
+
+        uint32_t cp = 0;
+        uint32_t len = utf8_decode(state.val + state.index, &cp);
+
+        if ( len == 0 ) {
+            parser_examined(state, state.index + 4);
+            return parser_update_error(state, "Utf8_Char: ungültiges utf-8");
+        }
+
+        if ( cp == 0 ) {
+            return parser_update_error(state, "Utf8_Char: unerwartet das ende erreicht");
+        }
+
+        return parser_update_state(state, state.index + len, parser_result_u64(cp));
+    }, PARSER_KIND_UTF8_CHAR);
+
+    /* ein oder mehr zeichen mit der gegebenen eigenschaft, wie Letters für ascii. */
+    Parser *
+    Utf8_Class(Utf8_Property property) {
+        Parser *p = parser_create([](Parser *p, const Parser_State &state) {
+            if ( !state.success ) {
+                return state;
+            }
+
+            char *start = state.val + state.index;
+            char *s = utf8_skip_property(start, (Utf8_Property)p->num);
+
+            /* das zeichen, an dem die schleife endet, kann bis zu vier bytes lang sein */
+            parser_examined(state, (s + 4) - state.val);
+
+            if ( s == start ) {
+                return parser_update_error(state, "Utf8_Class: kein passendes zeichen gefunden");
+            }
+
+            return parser_update_state(state, s - state.val, parser_result_str(start, s - start));
+        }, PARSER_KIND_UTF8_CLASS);
+
+        p->num = property;
+
+        return p;
+    }
+
+    /* bezeichner nach unicode: ein XID_Start oder '_', dann beliebig viele XID_Continue. */
+    Parser *Utf8_Ident = parser_create([](Parser *p, const Parser_State &state) {
+        if ( !state.success ) {
+            return state;
+        }
+
+        char *start = state.val + state.index;
+
+        uint32_t cp = 0;
+        uint32_t len = utf8_decode(start, &cp);
+
+        if ( len == 0 || cp == 0 || !utf8_has_property(cp, UTF8_IDENT_START) ) {
+            parser_examined(state, state.index + 4);
+            return parser_update_error(state, "Utf8_Ident: kein bezeichner gefunden");
+        }
+
+        char *s = utf8_skip_property(start + len, UTF8_IDENT_CONTINUE);
+        parser_examined(state, (s + 4) - state.val);
+
+        return parser_update_state(state, s - state.val, parser_result_str(start, s - start));
+    }, PARSER_KIND_UTF8_IDENT);
+
+    namespace api {
+        using Urq::Utf8_Property;
+        using Urq::UTF8_LETTER;
+        using Urq::UTF8_DIGIT;
+        using Urq::UTF8_SPACE;
+        using Urq::UTF8_IDENT_START;
+        using Urq::UTF8_IDENT_CONTINUE;
+
+        using Urq::Utf8_Char;
+        using Urq::Utf8_Class;
+        using Urq::Utf8_Ident;
+
+        using Urq::utf8_decode;
+        using Urq::utf8_validate;
+    }
+}